@@ -0,0 +1,71 @@
+#include <benchmark/benchmark.h>
+#include "lexer.h"
+#include "parser.h"
+#include "ast.h"
+#include "codegen.h"
+#include "type_check.h"
+#include "llvm/IR/Instructions.h"
+#include <string>
+
+void initializeCodeGen(const std::string& moduleName, const std::string& sourceFile = "");
+CodeGen& getCodeGen();
+
+// N branches and loop bodies, each binding a few short-lived temporaries plus a redeclared
+// mutable: the shape slot reuse targets (one alloca per binding without it)
+static std::string makeScopedProgram(int blocks) {
+    std::string src = "mut acc = 0;\n";
+    for (int i = 0; i < blocks; ++i) {
+        std::string n = std::to_string(i);
+        src += "if (acc < " + n + ") { a = acc + " + n + "; b = a * 2; acc = b - a; } "
+               "else { c = acc - 1; acc = c; }\n";
+        src += "mut k = 0; while (k < 2) { t = k + acc; mut u = t; mut u = u + 1; acc = u; k = k + 1; }\n";
+    }
+    src += "print acc;\n";
+    return src;
+}
+
+static void compile(const std::string& source, bool reuse, bool optimize) {
+    initializeCodeGen("bench_module");
+    auto& cg = getCodeGen();
+    cg.setSlotReuse(reuse);
+    auto* mainFunc = llvm::Function::Create(
+        llvm::FunctionType::get(llvm::Type::getInt32Ty(cg.getContext()), false),
+        llvm::Function::ExternalLinkage, "main", &cg.getModule());
+    cg.getBuilder().SetInsertPoint(llvm::BasicBlock::Create(cg.getContext(), "entry", mainFunc));
+
+    Lexer lexer(source, "bench.k");
+    Parser parser(lexer);
+    auto program = parser.parseProgram();
+    typeCheck(program.get(), "bench.k");
+    program->codegen();
+    cg.getBuilder().CreateRet(llvm::ConstantInt::get(llvm::Type::getInt32Ty(cg.getContext()), 0));
+    if (optimize) cg.optimize(1);
+}
+
+// Args: {blocks, slot reuse on/off}. Counters report the unoptimized IR size.
+static void BM_CodegenScopedBindings(benchmark::State& state) {
+    const std::string source = makeScopedProgram(static_cast<int>(state.range(0)));
+    const bool reuse = state.range(1) != 0;
+    for (auto _ : state) compile(source, reuse, /*optimize=*/false);
+
+    size_t allocas = 0, instructions = 0;
+    for (auto& bb : *getCodeGen().getModule().getFunction("main")) {
+        for (auto& inst : bb) {
+            ++instructions;
+            if (llvm::isa<llvm::AllocaInst>(inst)) ++allocas;
+        }
+    }
+    state.counters["allocas"] = static_cast<double>(allocas);
+    state.counters["instructions"] = static_cast<double>(instructions);
+}
+BENCHMARK(BM_CodegenScopedBindings)->ArgsProduct({{100, 400}, {0, 1}})->Unit(benchmark::kMillisecond);
+
+// Same programs through -O1, where mem2reg/SROA cost scales with the number of allocas
+static void BM_CompileScopedBindingsO1(benchmark::State& state) {
+    const std::string source = makeScopedProgram(static_cast<int>(state.range(0)));
+    const bool reuse = state.range(1) != 0;
+    for (auto _ : state) compile(source, reuse, /*optimize=*/true);
+}
+BENCHMARK(BM_CompileScopedBindingsO1)->ArgsProduct({{100, 400}, {0, 1}})->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
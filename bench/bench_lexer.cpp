@@ -0,0 +1,136 @@
+#include <benchmark/benchmark.h>
+#include "lexer.h"
+#include "number_parse.h"
+#include <string>
+#include <vector>
+
+// Synthetic corpora, ~1 MiB each, shaped like our generated modules
+static std::string makeIdentifierCorpus() {
+    std::string src;
+    for (int i = 0; src.size() < (1u << 20); ++i) {
+        std::string n = std::to_string(i % 512);
+        src += "value_" + n + " = input_" + n + " + offset_" + n + " * scale_factor;\n";
+        src += "if (value_" + n + " > limit) { mut result = value_" + n + "; } else { }\n";
+    }
+    return src;
+}
+
+static std::string makeKeywordCorpus() {
+    std::string src;
+    while (src.size() < (1u << 20)) {
+        src += "export fn from import as default while return print mut if else\n";
+    }
+    return src;
+}
+
+// Mostly comments and indentation, with a few short statements
+static std::string makeCommentCorpus() {
+    std::string src;
+    for (int i = 0; src.size() < (1u << 20); ++i) {
+        src += "    // generated row " + std::to_string(i) + ": " + std::string(60, '-') + "\n";
+        src += "                                        \n";
+        if (i % 8 == 0) src += "x = 1;\n";
+    }
+    return src;
+}
+
+static std::string makeStringCorpus() {
+    std::string src;
+    while (src.size() < (1u << 20)) {
+        src += "print \"" + std::string(100, 'm') + "\";\n";
+        src += "print \"column\\t" + std::string(40, 'v') + "\\n\";\n";
+    }
+    return src;
+}
+
+// Constant tables: integer and fractional literals of mixed length
+static std::string makeNumberCorpus() {
+    std::string src;
+    for (int i = 0; src.size() < (1u << 20); ++i) {
+        src += "t = " + std::to_string(i) + " + " + std::to_string(i * 7919 % 100000) + "." +
+               std::to_string(i % 1000) + " * 0.0025 - 3.14159265358979 + 1048576;\n";
+    }
+    return src;
+}
+
+static void lexAll(benchmark::State& state, const std::string& corpus) {
+    size_t tokens = 0;
+    // Register once: every registration takes a fresh slice of the 32-bit location space
+    const auto& buffer = getSourceManager().addView("bench.k", corpus);
+    for (auto _ : state) {
+        Lexer lexer(buffer);
+        for (Token tok = lexer.getNextToken(); tok.type != TOK_EOF; tok = lexer.getNextToken()) {
+            benchmark::DoNotOptimize(tok.value.data());
+            ++tokens;
+        }
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * corpus.size()));
+    state.counters["tokens/s"] = benchmark::Counter(static_cast<double>(tokens), benchmark::Counter::kIsRate);
+}
+
+static void BM_LexIdentifiers(benchmark::State& state) {
+    static const std::string corpus = makeIdentifierCorpus();
+    lexAll(state, corpus);
+}
+BENCHMARK(BM_LexIdentifiers)->Unit(benchmark::kMillisecond);
+
+static void BM_LexKeywords(benchmark::State& state) {
+    static const std::string corpus = makeKeywordCorpus();
+    lexAll(state, corpus);
+}
+BENCHMARK(BM_LexKeywords)->Unit(benchmark::kMillisecond);
+
+static void BM_LexComments(benchmark::State& state) {
+    static const std::string corpus = makeCommentCorpus();
+    lexAll(state, corpus);
+}
+BENCHMARK(BM_LexComments)->Unit(benchmark::kMillisecond);
+
+static void BM_LexStrings(benchmark::State& state) {
+    static const std::string corpus = makeStringCorpus();
+    lexAll(state, corpus);
+}
+BENCHMARK(BM_LexStrings)->Unit(benchmark::kMillisecond);
+
+static void BM_LexNumbers(benchmark::State& state) {
+    static const std::string corpus = makeNumberCorpus();
+    lexAll(state, corpus);
+}
+BENCHMARK(BM_LexNumbers)->Unit(benchmark::kMillisecond);
+
+// Literal conversion alone, against the std::string + std::stod path the lexer used to take
+static const std::vector<std::string>& numberLiterals() {
+    static const std::vector<std::string> literals = [] {
+        std::vector<std::string> out;
+        for (int i = 0; i < 4096; ++i) {
+            out.push_back(std::to_string(i * 7919 % 100000) + "." + std::to_string(i % 1000));
+            out.push_back(std::to_string(i));
+        }
+        out.push_back("3.14159265358979");
+        return out;
+    }();
+    return literals;
+}
+
+static void BM_ParseDecimalLiteral(benchmark::State& state) {
+    for (auto _ : state) {
+        for (const auto& lit : numberLiterals()) {
+            benchmark::DoNotOptimize(parseDecimalLiteral(std::string_view(lit)));
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * numberLiterals().size()));
+}
+BENCHMARK(BM_ParseDecimalLiteral);
+
+static void BM_StringStod(benchmark::State& state) {
+    for (auto _ : state) {
+        for (const auto& lit : numberLiterals()) {
+            std::string copy(lit.data(), lit.size());
+            benchmark::DoNotOptimize(std::stod(copy));
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * numberLiterals().size()));
+}
+BENCHMARK(BM_StringStod);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,85 @@
+#include <benchmark/benchmark.h>
+#include "lexer.h"
+#include "parser.h"
+#include "module_cache.h"
+#include <string>
+
+// Expression-heavy corpora shaped like generated code, ~1 MiB each
+static std::string makeLongExpressionCorpus() {
+    std::string src;
+    static const char* ops[] = {" + ", " - ", " * ", " / ", " < ", " == "};
+    for (int i = 0; src.size() < (1u << 20); ++i) {
+        src += "r" + std::to_string(i % 64) + " = ";
+        for (int j = 0; j < 40; ++j) {
+            if (j) src += ops[(i + j) % 6];
+            src += (j % 3 == 0) ? "x" + std::to_string(j) : std::to_string(i + j);
+        }
+        src += ";\n";
+    }
+    return src;
+}
+
+static std::string makeNestedExpressionCorpus() {
+    std::string src;
+    for (int i = 0; src.size() < (1u << 20); ++i) {
+        std::string e = "a" + std::to_string(i % 16);
+        for (int j = 0; j < 12; ++j) e = "(" + e + " * " + std::to_string(j) + " + b - c / 2)";
+        src += "n = " + e + " > 0;\n";
+    }
+    return src;
+}
+
+static void parseAll(benchmark::State& state, const std::string& corpus) {
+    // Register once: every registration takes a fresh slice of the 32-bit location space
+    const auto& buffer = getSourceManager().addView("bench.k", corpus);
+    size_t statements = 0;
+    for (auto _ : state) {
+        Lexer lexer(buffer);
+        Parser parser(lexer);
+        auto program = parser.parseProgram();
+        statements += program->getStatements().size();
+        benchmark::DoNotOptimize(program.get());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * corpus.size()));
+    state.counters["stmts/s"] = benchmark::Counter(static_cast<double>(statements), benchmark::Counter::kIsRate);
+}
+
+static void BM_ParseLongExpressions(benchmark::State& state) {
+    static const std::string corpus = makeLongExpressionCorpus();
+    parseAll(state, corpus);
+}
+BENCHMARK(BM_ParseLongExpressions)->Unit(benchmark::kMillisecond);
+
+static void BM_ParseNestedExpressions(benchmark::State& state) {
+    static const std::string corpus = makeNestedExpressionCorpus();
+    parseAll(state, corpus);
+}
+BENCHMARK(BM_ParseNestedExpressions)->Unit(benchmark::kMillisecond);
+
+// The same corpora loaded from their module cache encoding (ModuleCache::load minus file I/O)
+static void loadAll(benchmark::State& state, const std::string& corpus) {
+    const auto& buffer = getSourceManager().addView("bench_cached.k", corpus);
+    Lexer lexer(buffer);
+    Parser parser(lexer);
+    const std::string entry = serializeModule(*parser.parseProgram(), buffer);
+    for (auto _ : state) {
+        auto program = deserializeModule(entry, buffer);
+        benchmark::DoNotOptimize(program.get());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * corpus.size()));
+    state.counters["entry bytes"] = static_cast<double>(entry.size());
+}
+
+static void BM_LoadCachedLongExpressions(benchmark::State& state) {
+    static const std::string corpus = makeLongExpressionCorpus();
+    loadAll(state, corpus);
+}
+BENCHMARK(BM_LoadCachedLongExpressions)->Unit(benchmark::kMillisecond);
+
+static void BM_LoadCachedNestedExpressions(benchmark::State& state) {
+    static const std::string corpus = makeNestedExpressionCorpus();
+    loadAll(state, corpus);
+}
+BENCHMARK(BM_LoadCachedNestedExpressions)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -1,267 +1,315 @@
 #pragma once
+#include <cassert>
+#include <cstdint>
 #include <memory>
+#include <string_view>
 #include <vector>
-#include <string>
 #include "lexer.h"
+#include "ast_context.h"
 
 namespace llvm {
     class Value;
 }
 
 // Variable assignment type classification
-enum class AssignmentType {
+enum class AssignmentType : uint8_t {
     DECLARATION,     // First binding: x = 42 or mut x = 42
     REASSIGNMENT,    // Subsequent assignment: x = 43 (only valid for mutable)
     SHADOWING        // New immutable binding with same name
 };
 
+// Concrete node classes; expressions first so ExprAST::classof is a range check
+enum class NodeKind : uint8_t {
+    Number, Variable, StringLiteral, Unary, Binary, Assignment, FunctionLiteral, FunctionCall,
+    Print, If, While, Block, Return, Import, Export, Program,
+    FirstExpr = Number, LastExpr = FunctionCall
+};
+
+// AIDEV-NOTE: Nodes are created in an ASTContext (see ast_context.h) and never deleted one
+// by one: children are plain pointers, lists are ASTSpans and names are interned views.
+// Small fields come first so they pack into the tail padding of the base classes.
+// Passes identify nodes by getKind() (isa/dyn_cast below, ASTVisitor in ast_visitor.h)
+// rather than RTTI.
 class ASTNode {
+    const NodeKind kind;
 public:
-    virtual ~ASTNode() = default;
+    explicit ASTNode(NodeKind kind) : kind(kind) {}
+    NodeKind getKind() const { return kind; }
     virtual llvm::Value* codegen() = 0;
+protected:
+    ~ASTNode() = default;
 };
 
+// Kind-checked downcasts in the style of llvm/Support/Casting.h; null in, false/null out
+template <typename T>
+bool isa(const ASTNode* node) { return node && T::classof(node); }
+template <typename T>
+T* dyn_cast(ASTNode* node) { return isa<T>(node) ? static_cast<T*>(node) : nullptr; }
+template <typename T>
+const T* dyn_cast(const ASTNode* node) { return isa<T>(node) ? static_cast<const T*>(node) : nullptr; }
+template <typename T>
+T* cast(ASTNode* node) {
+    assert(isa<T>(node) && "cast<T>() to the wrong node kind");
+    return static_cast<T*>(node);
+}
+
+// Static value category of an expression, recorded by typeCheck() (Number until checked)
+enum class StaticType : uint8_t { Number, String, Function };
+
 class ExprAST : public ASTNode {
+    StaticType static_type = StaticType::Number;
 public:
-    virtual ~ExprAST() = default;
+    explicit ExprAST(NodeKind kind) : ASTNode(kind) {}
+    static bool classof(const ASTNode* node) {
+        return node->getKind() >= NodeKind::FirstExpr && node->getKind() <= NodeKind::LastExpr;
+    }
+    void setStaticType(StaticType type) { static_type = type; }
+    StaticType getStaticType() const { return static_type; }
 };
 
 class NumberExprAST : public ExprAST {
+    SourceLoc literal_location; // location of number literal for diagnostics
     double val;
-    SourceLocation literal_location; // location of number literal for diagnostics
 public:
-    NumberExprAST(double val) : val(val), literal_location{} {}
-    NumberExprAST(double val, SourceLocation loc) : val(val), literal_location(std::move(loc)) {}
+    static bool classof(const ASTNode* node) { return node->getKind() == NodeKind::Number; }
+    NumberExprAST(double val) : ExprAST(NodeKind::Number), literal_location{}, val(val) {}
+    NumberExprAST(double val, SourceLoc loc) : ExprAST(NodeKind::Number), literal_location(loc), val(val) {}
     llvm::Value* codegen() override;
     double getValue() const { return val; }
-    const SourceLocation& getLiteralLocation() const { return literal_location; }
+    SourceLoc getLiteralLocation() const { return literal_location; }
 };
 
 class VariableExprAST : public ExprAST {
-    std::string name;
-    SourceLocation name_location{}; // location of identifier for diagnostics
+    SourceLoc name_location{}; // location of identifier for diagnostics
+    std::string_view name;
 public:
-    VariableExprAST(const std::string& name) : name(name) {}
-    VariableExprAST(const std::string& name, SourceLocation loc) : name(name), name_location(std::move(loc)) {}
+    static bool classof(const ASTNode* node) { return node->getKind() == NodeKind::Variable; }
+    VariableExprAST(std::string_view name) : ExprAST(NodeKind::Variable), name(name) {}
+    VariableExprAST(std::string_view name, SourceLoc loc) : ExprAST(NodeKind::Variable), name_location(loc), name(name) {}
     llvm::Value* codegen() override;
-    const std::string& getName() const { return name; }
-    const SourceLocation& getNameLocation() const { return name_location; }
+    std::string_view getName() const { return name; }
+    SourceLoc getNameLocation() const { return name_location; }
 };
 
 class StringLiteralAST : public ExprAST {
-    std::string value;
-    SourceLocation literal_location; // location of string literal for diagnostics
+    SourceLoc literal_location; // location of string literal for diagnostics
+    std::string_view value;
 public:
-    StringLiteralAST(const std::string& value) : value(value), literal_location{} {}
-    StringLiteralAST(const std::string& value, SourceLocation loc) : value(value), literal_location(std::move(loc)) {}
+    static bool classof(const ASTNode* node) { return node->getKind() == NodeKind::StringLiteral; }
+    StringLiteralAST(std::string_view value) : ExprAST(NodeKind::StringLiteral), literal_location{}, value(value) {}
+    StringLiteralAST(std::string_view value, SourceLoc loc) : ExprAST(NodeKind::StringLiteral), literal_location(loc), value(value) {}
     llvm::Value* codegen() override;
-    const std::string& getValue() const { return value; }
-    const SourceLocation& getLiteralLocation() const { return literal_location; }
+    std::string_view getValue() const { return value; }
+    SourceLoc getLiteralLocation() const { return literal_location; }
 };
 
 class UnaryExprAST : public ExprAST {
     char op;
-    std::unique_ptr<ExprAST> operand;
-    SourceLocation op_location; // location of operator for diagnostics
+    SourceLoc op_location; // location of operator for diagnostics
+    ExprAST* operand;
 public:
-    UnaryExprAST(char op, std::unique_ptr<ExprAST> operand)
-        : op(op), operand(std::move(operand)), op_location{} {}
-    UnaryExprAST(char op, std::unique_ptr<ExprAST> operand, SourceLocation loc)
-        : op(op), operand(std::move(operand)), op_location(std::move(loc)) {}
+    static bool classof(const ASTNode* node) { return node->getKind() == NodeKind::Unary; }
+    UnaryExprAST(char op, ExprAST* operand)
+        : ExprAST(NodeKind::Unary), op(op), op_location{}, operand(operand) {}
+    UnaryExprAST(char op, ExprAST* operand, SourceLoc loc)
+        : ExprAST(NodeKind::Unary), op(op), op_location(loc), operand(operand) {}
     llvm::Value* codegen() override;
     char getOperator() const { return op; }
-    ExprAST* getOperand() const { return operand.get(); }
-    const SourceLocation& getOperatorLocation() const { return op_location; }
+    ExprAST* getOperand() const { return operand; }
+    SourceLoc getOperatorLocation() const { return op_location; }
 };
 
 class BinaryExprAST : public ExprAST {
     char op;
-    std::unique_ptr<ExprAST> lhs, rhs;
-    SourceLocation op_location; // location of operator for diagnostics
+    SourceLoc op_location; // location of operator for diagnostics
+    ExprAST* lhs;
+    ExprAST* rhs;
 public:
-    BinaryExprAST(char op, std::unique_ptr<ExprAST> lhs, std::unique_ptr<ExprAST> rhs)
-        : op(op), lhs(std::move(lhs)), rhs(std::move(rhs)), op_location{} {}
-    BinaryExprAST(char op, std::unique_ptr<ExprAST> lhs, std::unique_ptr<ExprAST> rhs, SourceLocation loc)
-        : op(op), lhs(std::move(lhs)), rhs(std::move(rhs)), op_location(std::move(loc)) {}
+    static bool classof(const ASTNode* node) { return node->getKind() == NodeKind::Binary; }
+    BinaryExprAST(char op, ExprAST* lhs, ExprAST* rhs)
+        : ExprAST(NodeKind::Binary), op(op), op_location{}, lhs(lhs), rhs(rhs) {}
+    BinaryExprAST(char op, ExprAST* lhs, ExprAST* rhs, SourceLoc loc)
+        : ExprAST(NodeKind::Binary), op(op), op_location(loc), lhs(lhs), rhs(rhs) {}
     llvm::Value* codegen() override;
     char getOperator() const { return op; }
-    ExprAST* getLHS() const { return lhs.get(); }
-    ExprAST* getRHS() const { return rhs.get(); }
-    const SourceLocation& getOperatorLocation() const { return op_location; }
+    ExprAST* getLHS() const { return lhs; }
+    ExprAST* getRHS() const { return rhs; }
+    SourceLoc getOperatorLocation() const { return op_location; }
 };
 
 class AssignmentExprAST : public ExprAST {
-    std::string varName;
-    std::unique_ptr<ExprAST> value;
     bool is_mutable_declaration;
     AssignmentType assignment_type;
-    SourceLocation name_location; // location of variable name for diagnostics
+    SourceLoc name_location; // location of variable name for diagnostics
+    std::string_view varName;
+    ExprAST* value;
 public:
-    AssignmentExprAST(const std::string& varName, std::unique_ptr<ExprAST> value)
-        : varName(varName), value(std::move(value)), is_mutable_declaration(false), assignment_type(AssignmentType::DECLARATION), name_location{} {}
-    AssignmentExprAST(const std::string& varName, std::unique_ptr<ExprAST> value,
-                      SourceLocation loc)
-        : varName(varName), value(std::move(value)), is_mutable_declaration(false), assignment_type(AssignmentType::DECLARATION), name_location(std::move(loc)) {}
+    static bool classof(const ASTNode* node) { return node->getKind() == NodeKind::Assignment; }
+    AssignmentExprAST(std::string_view varName, ExprAST* value)
+        : ExprAST(NodeKind::Assignment), is_mutable_declaration(false), assignment_type(AssignmentType::DECLARATION), name_location{}, varName(varName), value(value) {}
+    AssignmentExprAST(std::string_view varName, ExprAST* value, SourceLoc loc)
+        : ExprAST(NodeKind::Assignment), is_mutable_declaration(false), assignment_type(AssignmentType::DECLARATION), name_location(loc), varName(varName), value(value) {}
     
-    AssignmentExprAST(const std::string& varName, std::unique_ptr<ExprAST> value, 
-                      bool is_mut, AssignmentType type)
-    : varName(varName), value(std::move(value)), is_mutable_declaration(is_mut), assignment_type(type), name_location{} {}
-    AssignmentExprAST(const std::string& varName, std::unique_ptr<ExprAST> value, 
-                      bool is_mut, AssignmentType type, SourceLocation loc)
-        : varName(varName), value(std::move(value)), is_mutable_declaration(is_mut), assignment_type(type), name_location(std::move(loc)) {}
+    AssignmentExprAST(std::string_view varName, ExprAST* value, bool is_mut, AssignmentType type)
+        : ExprAST(NodeKind::Assignment), is_mutable_declaration(is_mut), assignment_type(type), name_location{}, varName(varName), value(value) {}
+    AssignmentExprAST(std::string_view varName, ExprAST* value, bool is_mut, AssignmentType type,
+                      SourceLoc loc)
+        : ExprAST(NodeKind::Assignment), is_mutable_declaration(is_mut), assignment_type(type), name_location(loc), varName(varName), value(value) {}
     
     llvm::Value* codegen() override;
-    const std::string& getVarName() const { return varName; }
-    ExprAST* getValue() const { return value.get(); }
+    std::string_view getVarName() const { return varName; }
+    ExprAST* getValue() const { return value; }
     bool isMutableDeclaration() const { return is_mutable_declaration; }
     AssignmentType getAssignmentType() const { return assignment_type; }
-    const SourceLocation& getNameLocation() const { return name_location; }
+    SourceLoc getNameLocation() const { return name_location; }
 };
 
 class PrintStmtAST : public ASTNode {
-    std::unique_ptr<ExprAST> formatExpr;
-    std::vector<std::unique_ptr<ExprAST>> args;
-    SourceLocation print_location; // location of 'print' keyword for diagnostics
+    SourceLoc print_location; // location of 'print' keyword for diagnostics
+    ExprAST* formatExpr;
+    ASTSpan<ExprAST*> args;
 public:
-    PrintStmtAST(std::unique_ptr<ExprAST> formatExpr) : formatExpr(std::move(formatExpr)), print_location{} {}
-    PrintStmtAST(std::unique_ptr<ExprAST> formatExpr, std::vector<std::unique_ptr<ExprAST>> args) 
-        : formatExpr(std::move(formatExpr)), args(std::move(args)), print_location{} {}
-    PrintStmtAST(std::unique_ptr<ExprAST> formatExpr, SourceLocation loc)
-        : formatExpr(std::move(formatExpr)), print_location(std::move(loc)) {}
-    PrintStmtAST(std::unique_ptr<ExprAST> formatExpr, std::vector<std::unique_ptr<ExprAST>> args, SourceLocation loc) 
-        : formatExpr(std::move(formatExpr)), args(std::move(args)), print_location(std::move(loc)) {}
+    static bool classof(const ASTNode* node) { return node->getKind() == NodeKind::Print; }
+    PrintStmtAST(ExprAST* formatExpr) : ASTNode(NodeKind::Print), print_location{}, formatExpr(formatExpr) {}
+    PrintStmtAST(ExprAST* formatExpr, ASTSpan<ExprAST*> args)
+        : ASTNode(NodeKind::Print), print_location{}, formatExpr(formatExpr), args(args) {}
+    PrintStmtAST(ExprAST* formatExpr, SourceLoc loc)
+        : ASTNode(NodeKind::Print), print_location(loc), formatExpr(formatExpr) {}
+    PrintStmtAST(ExprAST* formatExpr, ASTSpan<ExprAST*> args, SourceLoc loc)
+        : ASTNode(NodeKind::Print), print_location(loc), formatExpr(formatExpr), args(args) {}
     llvm::Value* codegen() override;
-    ExprAST* getFormatExpr() const { return formatExpr.get(); }
-    const std::vector<std::unique_ptr<ExprAST>>& getArgs() const { return args; }
-    const SourceLocation& getPrintLocation() const { return print_location; }
+    ExprAST* getFormatExpr() const { return formatExpr; }
+    ASTSpan<ExprAST*> getArgs() const { return args; }
+    SourceLoc getPrintLocation() const { return print_location; }
     
     // Backward compatibility
-    ExprAST* getExpr() const { return formatExpr.get(); }
+    ExprAST* getExpr() const { return formatExpr; }
 };
 
 class IfStmtAST : public ASTNode {
-    std::unique_ptr<ExprAST> condition;
-    std::unique_ptr<ASTNode> thenStmt;
-    std::unique_ptr<ASTNode> elseStmt;
-    SourceLocation if_location; // location of 'if' keyword for diagnostics
+    SourceLoc if_location; // location of 'if' keyword for diagnostics
+    ExprAST* condition;
+    ASTNode* thenStmt;
+    ASTNode* elseStmt;
 public:
-    IfStmtAST(std::unique_ptr<ExprAST> condition, 
-              std::unique_ptr<ASTNode> thenStmt,
-              std::unique_ptr<ASTNode> elseStmt)
-        : condition(std::move(condition)), 
-          thenStmt(std::move(thenStmt)), 
-          elseStmt(std::move(elseStmt)), if_location{} {}
-    IfStmtAST(std::unique_ptr<ExprAST> condition, 
-              std::unique_ptr<ASTNode> thenStmt,
-              std::unique_ptr<ASTNode> elseStmt,
-              SourceLocation loc)
-        : condition(std::move(condition)), 
-          thenStmt(std::move(thenStmt)), 
-          elseStmt(std::move(elseStmt)), if_location(std::move(loc)) {}
+    static bool classof(const ASTNode* node) { return node->getKind() == NodeKind::If; }
+    IfStmtAST(ExprAST* condition, ASTNode* thenStmt, ASTNode* elseStmt)
+        : ASTNode(NodeKind::If), if_location{}, condition(condition), thenStmt(thenStmt), elseStmt(elseStmt) {}
+    IfStmtAST(ExprAST* condition, ASTNode* thenStmt, ASTNode* elseStmt, SourceLoc loc)
+        : ASTNode(NodeKind::If), if_location(loc), condition(condition), thenStmt(thenStmt), elseStmt(elseStmt) {}
     llvm::Value* codegen() override;
-    ExprAST* getCondition() const { return condition.get(); }
-    ASTNode* getThenStmt() const { return thenStmt.get(); }
-    ASTNode* getElseStmt() const { return elseStmt.get(); }
-    const SourceLocation& getIfLocation() const { return if_location; }
+    ExprAST* getCondition() const { return condition; }
+    ASTNode* getThenStmt() const { return thenStmt; }
+    ASTNode* getElseStmt() const { return elseStmt; }
+    SourceLoc getIfLocation() const { return if_location; }
 };
 
 class WhileStmtAST : public ASTNode {
-    std::unique_ptr<ExprAST> condition;
-    std::unique_ptr<ASTNode> body;
-    SourceLocation while_location; // location of 'while' keyword for diagnostics
+    SourceLoc while_location; // location of 'while' keyword for diagnostics
+    ExprAST* condition;
+    ASTNode* body;
 public:
-    WhileStmtAST(std::unique_ptr<ExprAST> condition, 
-                 std::unique_ptr<ASTNode> body)
-        : condition(std::move(condition)), 
-          body(std::move(body)), while_location{} {}
-    WhileStmtAST(std::unique_ptr<ExprAST> condition, 
-                 std::unique_ptr<ASTNode> body,
-                 SourceLocation loc)
-        : condition(std::move(condition)), 
-          body(std::move(body)), while_location(std::move(loc)) {}
+    static bool classof(const ASTNode* node) { return node->getKind() == NodeKind::While; }
+    WhileStmtAST(ExprAST* condition, ASTNode* body)
+        : ASTNode(NodeKind::While), while_location{}, condition(condition), body(body) {}
+    WhileStmtAST(ExprAST* condition, ASTNode* body, SourceLoc loc)
+        : ASTNode(NodeKind::While), while_location(loc), condition(condition), body(body) {}
     llvm::Value* codegen() override;
-    ExprAST* getCondition() const { return condition.get(); }
-    ASTNode* getBody() const { return body.get(); }
-    const SourceLocation& getWhileLocation() const { return while_location; }
+    ExprAST* getCondition() const { return condition; }
+    ASTNode* getBody() const { return body; }
+    SourceLoc getWhileLocation() const { return while_location; }
 };
 
 class BlockAST : public ASTNode {
-    std::vector<std::unique_ptr<ASTNode>> statements;
+    ASTSpan<ASTNode*> statements;
 public:
-    BlockAST(std::vector<std::unique_ptr<ASTNode>> statements)
-        : statements(std::move(statements)) {}
+    static bool classof(const ASTNode* node) { return node->getKind() == NodeKind::Block; }
+    BlockAST(ASTSpan<ASTNode*> statements) : ASTNode(NodeKind::Block), statements(statements) {}
     llvm::Value* codegen() override;
-    const std::vector<std::unique_ptr<ASTNode>>& getStatements() const { return statements; }
+    ASTSpan<ASTNode*> getStatements() const { return statements; }
 };
 
-enum class ImportType { Named, Namespace, Default };
+enum class ImportType : uint8_t { Named, Namespace, Default };
 
 struct ImportedSymbol {
-    std::string name;
-    std::string alias;
+    std::string_view name;
+    std::string_view alias;
 };
 
 class ImportStmtAST : public ASTNode {
-    std::string moduleName;
     ImportType importType;
-    std::vector<ImportedSymbol> symbols;
-    std::string alias;
-    SourceLocation location;
+    SourceLoc location;
+    std::string_view moduleName;
+    std::string_view alias;
+    ASTSpan<ImportedSymbol> symbols;
 public:
-    ImportStmtAST(std::string moduleName, ImportType importType, std::vector<ImportedSymbol> symbols, std::string alias, SourceLocation loc)
-        : moduleName(std::move(moduleName)), importType(importType), symbols(std::move(symbols)), alias(std::move(alias)), location(std::move(loc)) {}
+    static bool classof(const ASTNode* node) { return node->getKind() == NodeKind::Import; }
+    ImportStmtAST(std::string_view moduleName, ImportType importType, ASTSpan<ImportedSymbol> symbols,
+                  std::string_view alias, SourceLoc loc)
+        : ASTNode(NodeKind::Import), importType(importType), location(loc), moduleName(moduleName), alias(alias), symbols(symbols) {}
     
     llvm::Value* codegen() override { return nullptr; }
     
-    const std::string& getModuleName() const { return moduleName; }
+    std::string_view getModuleName() const { return moduleName; }
     ImportType getImportType() const { return importType; }
-    const std::vector<ImportedSymbol>& getSymbols() const { return symbols; }
-    const std::string& getAlias() const { return alias; }
-    const SourceLocation& getLocation() const { return location; }
+    ASTSpan<ImportedSymbol> getSymbols() const { return symbols; }
+    std::string_view getAlias() const { return alias; }
+    SourceLoc getLocation() const { return location; }
 };
 
-enum class ExportType { Named, Function, Default, Assignment };
+enum class ExportType : uint8_t { Named, Function, Default, Assignment };
 
 struct ExportedSymbol {
-    std::string name;
-    std::string alias;
+    std::string_view name;
+    std::string_view alias;
 };
 
 class ExportStmtAST : public ASTNode {
     ExportType exportType;
-    std::vector<ExportedSymbol> symbols;
-    std::unique_ptr<ASTNode> declaration;
-    SourceLocation location;
+    SourceLoc location;
+    ASTSpan<ExportedSymbol> symbols;
+    ASTNode* declaration;
 public:
-    ExportStmtAST(ExportType exportType, std::vector<ExportedSymbol> symbols, std::unique_ptr<ASTNode> declaration, SourceLocation loc)
-        : exportType(exportType), symbols(std::move(symbols)), declaration(std::move(declaration)), location(std::move(loc)) {}
+    static bool classof(const ASTNode* node) { return node->getKind() == NodeKind::Export; }
+    ExportStmtAST(ExportType exportType, ASTSpan<ExportedSymbol> symbols, ASTNode* declaration, SourceLoc loc)
+        : ASTNode(NodeKind::Export), exportType(exportType), location(loc), symbols(symbols), declaration(declaration) {}
     
     llvm::Value* codegen() override;
     
     ExportType getExportType() const { return exportType; }
-    const std::vector<ExportedSymbol>& getSymbols() const { return symbols; }
-    ASTNode* getDeclaration() const { return declaration.get(); }
-    const SourceLocation& getLocation() const { return location; }
+    ASTSpan<ExportedSymbol> getSymbols() const { return symbols; }
+    ASTNode* getDeclaration() const { return declaration; }
+    SourceLoc getLocation() const { return location; }
 };
 
-class ProgramAST : public ASTNode {
-    std::vector<std::unique_ptr<ImportStmtAST>> imports;
-    std::vector<std::unique_ptr<ExportStmtAST>> exports;
-    std::vector<std::unique_ptr<ASTNode>> statements;
+// The root is the one node outside the arena: it owns the ASTContext holding the tree
+class ProgramAST final : public ASTNode {
+    std::unique_ptr<ASTContext> context;
+    ASTSpan<ImportStmtAST*> imports;
+    ASTSpan<ExportStmtAST*> exports;
+    ASTSpan<ASTNode*> statements;
 public:
-    ProgramAST(std::vector<std::unique_ptr<ASTNode>> statements)
-        : statements(std::move(statements)) {}
-    ProgramAST(std::vector<std::unique_ptr<ImportStmtAST>> imports,
-               std::vector<std::unique_ptr<ExportStmtAST>> exports,
-               std::vector<std::unique_ptr<ASTNode>> statements)
-        : imports(std::move(imports)), exports(std::move(exports)), statements(std::move(statements)) {}
+    static bool classof(const ASTNode* node) { return node->getKind() == NodeKind::Program; }
+    ProgramAST(std::unique_ptr<ASTContext> context, ASTSpan<ASTNode*> statements)
+        : ASTNode(NodeKind::Program), context(std::move(context)), statements(statements) {}
+    ProgramAST(std::unique_ptr<ASTContext> context,
+               ASTSpan<ImportStmtAST*> imports,
+               ASTSpan<ExportStmtAST*> exports,
+               ASTSpan<ASTNode*> statements)
+        : ASTNode(NodeKind::Program), context(std::move(context)), imports(imports), exports(exports), statements(statements) {}
+    ~ProgramAST() = default;
     llvm::Value* codegen() override;
     
-    const std::vector<std::unique_ptr<ImportStmtAST>>& getImports() const { return imports; }
-    const std::vector<std::unique_ptr<ExportStmtAST>>& getExports() const { return exports; }
-    const std::vector<std::unique_ptr<ASTNode>>& getStatements() const { return statements; }
+    ASTContext& getContext() const { return *context; }
+    ASTSpan<ImportStmtAST*> getImports() const { return imports; }
+    ASTSpan<ExportStmtAST*> getExports() const { return exports; }
+    ASTSpan<ASTNode*> getStatements() const { return statements; }
 
-    std::vector<std::unique_ptr<ImportStmtAST>> releaseImports() { return std::move(imports); }
-    std::vector<std::unique_ptr<ExportStmtAST>> releaseExports() { return std::move(exports); }
-    std::vector<std::unique_ptr<ASTNode>> releaseStatements() { return std::move(statements); }
+    // Hand the arena (and with it every node) to another owner; this program becomes empty
+    std::unique_ptr<ASTContext> releaseContext() {
+        imports = {};
+        exports = {};
+        statements = {};
+        return std::move(context);
+    }
 };
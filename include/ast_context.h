@@ -0,0 +1,89 @@
+#pragma once
+#include "identifier_table.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Fixed-size view of an arena-allocated array (AST child lists)
+template <typename T>
+class ASTSpan {
+    T* items = nullptr;
+    uint32_t count = 0;
+public:
+    ASTSpan() = default;
+    ASTSpan(T* items, uint32_t count) : items(items), count(count) {}
+    T* begin() const { return items; }
+    T* end() const { return items + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T& operator[](size_t i) const { return items[i]; }
+    T& front() const { return items[0]; }
+    T& back() const { return items[count - 1]; }
+};
+
+// AIDEV-NOTE: AST arena. Every node, child list and name of a parse lives in a few
+// bump-allocated slabs owned by one ASTContext, so building a tree does no per-node malloc
+// and tearing it down frees only the slabs. Nodes are never destroyed individually, which
+// create() enforces by requiring trivially destructible types (raw child pointers, ASTSpan
+// lists, interned string_view names). Names are interned: equal spellings share one copy.
+class ASTContext {
+public:
+    ASTContext();
+    ~ASTContext();
+    ASTContext(const ASTContext&) = delete;
+    ASTContext& operator=(const ASTContext&) = delete;
+
+    void* allocate(size_t size, size_t align) {
+        auto p = (reinterpret_cast<uintptr_t>(cursor) + align - 1) & ~(uintptr_t(align) - 1);
+        if (cursor && p + size <= reinterpret_cast<uintptr_t>(limit)) {
+            cursor = reinterpret_cast<char*>(p + size);
+            bytesAllocated += size;
+            return reinterpret_cast<void*>(p);
+        }
+        return allocateSlow(size, align);
+    }
+
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+        static_assert(std::is_trivially_destructible_v<T>,
+                      "arena-allocated AST types are never destroyed");
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Copy a list built on the side into the arena
+    template <typename T>
+    ASTSpan<T> copySpan(const T* items, size_t count) {
+        static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>,
+                      "arena-allocated AST types are never destroyed");
+        if (count == 0) return {};
+        T* out = static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+        std::uninitialized_copy(items, items + count, out);
+        return ASTSpan<T>(out, static_cast<uint32_t>(count));
+    }
+    template <typename T>
+    ASTSpan<T> copySpan(const std::vector<T>& items) { return copySpan(items.data(), items.size()); }
+
+    // Canonical arena copy of name; the empty string is returned as is
+    std::string_view intern(std::string_view name);
+
+    // Take over other's slabs (e.g. when module trees are merged into one program)
+    void absorb(ASTContext& other);
+
+    size_t getBytesAllocated() const { return bytesAllocated; }
+    size_t getSlabCount() const { return slabs.size(); }
+
+private:
+    std::vector<std::unique_ptr<char[]>> slabs;
+    char* cursor = nullptr;
+    char* limit = nullptr;
+    size_t nextSlabSize = 4096;
+    size_t bytesAllocated = 0;
+    IdentifierTable names;
+
+    void* allocateSlow(size_t size, size_t align);
+};
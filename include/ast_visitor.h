@@ -0,0 +1,135 @@
+#pragma once
+#include "ast.h"
+#include "function_ast.h"
+
+// AIDEV-NOTE: CRTP visitors dispatching on ASTNode::getKind() with one switch.
+//
+// ASTVisitor<Derived, RetTy>: visit(node) calls Derived::visit<Kind>(node). Unhandled kinds
+// fall back to visitExpr (expressions), then visitNode, which returns RetTy{}.
+//
+// RecursiveASTVisitor<Derived>: traverse(node) walks the tree in source order. For each node
+// it calls Derived::visit<Kind>(node) and, if that returns true, traverses the children.
+// Returning false prunes the subtree (e.g. a pass that must not enter nested fn literals).
+// Children are traversed through Derived::traverse, so a pass can wrap it (scope tracking).
+
+#define AST_NODE_KINDS(X)                      \
+    X(Number, NumberExprAST)                   \
+    X(Variable, VariableExprAST)               \
+    X(StringLiteral, StringLiteralAST)         \
+    X(Unary, UnaryExprAST)                     \
+    X(Binary, BinaryExprAST)                   \
+    X(Assignment, AssignmentExprAST)           \
+    X(FunctionLiteral, FunctionLiteralAST)     \
+    X(FunctionCall, FunctionCallAST)           \
+    X(Print, PrintStmtAST)                     \
+    X(If, IfStmtAST)                           \
+    X(While, WhileStmtAST)                     \
+    X(Block, BlockAST)                         \
+    X(Return, ReturnStmtAST)                   \
+    X(Import, ImportStmtAST)                   \
+    X(Export, ExportStmtAST)                   \
+    X(Program, ProgramAST)
+
+template <typename Derived, typename RetTy = void>
+class ASTVisitor {
+    Derived& derived() { return static_cast<Derived&>(*this); }
+public:
+    RetTy visit(ASTNode* node) {
+        switch (node->getKind()) {
+#define AST_DISPATCH(Kind, Class) \
+        case NodeKind::Kind: return derived().visit##Kind(static_cast<Class*>(node));
+        AST_NODE_KINDS(AST_DISPATCH)
+#undef AST_DISPATCH
+        }
+        return RetTy();
+    }
+
+#define AST_EXPR_FALLBACK(Kind, Class) \
+    RetTy visit##Kind(Class* node) { return derived().visitExpr(node); }
+    AST_EXPR_FALLBACK(Number, NumberExprAST)
+    AST_EXPR_FALLBACK(Variable, VariableExprAST)
+    AST_EXPR_FALLBACK(StringLiteral, StringLiteralAST)
+    AST_EXPR_FALLBACK(Unary, UnaryExprAST)
+    AST_EXPR_FALLBACK(Binary, BinaryExprAST)
+    AST_EXPR_FALLBACK(Assignment, AssignmentExprAST)
+    AST_EXPR_FALLBACK(FunctionLiteral, FunctionLiteralAST)
+    AST_EXPR_FALLBACK(FunctionCall, FunctionCallAST)
+#undef AST_EXPR_FALLBACK
+#define AST_STMT_FALLBACK(Kind, Class) \
+    RetTy visit##Kind(Class* node) { return derived().visitNode(node); }
+    AST_STMT_FALLBACK(Print, PrintStmtAST)
+    AST_STMT_FALLBACK(If, IfStmtAST)
+    AST_STMT_FALLBACK(While, WhileStmtAST)
+    AST_STMT_FALLBACK(Block, BlockAST)
+    AST_STMT_FALLBACK(Return, ReturnStmtAST)
+    AST_STMT_FALLBACK(Import, ImportStmtAST)
+    AST_STMT_FALLBACK(Export, ExportStmtAST)
+    AST_STMT_FALLBACK(Program, ProgramAST)
+#undef AST_STMT_FALLBACK
+
+    RetTy visitExpr(ExprAST* node) { return derived().visitNode(node); }
+    RetTy visitNode(ASTNode*) { return RetTy(); }
+};
+
+template <typename Derived>
+class RecursiveASTVisitor {
+    Derived& derived() { return static_cast<Derived&>(*this); }
+public:
+    void traverse(ASTNode* node) {
+        if (!node) return;
+        switch (node->getKind()) {
+#define AST_DISPATCH(Kind, Class)                                        \
+        case NodeKind::Kind: {                                           \
+            auto* n = static_cast<Class*>(node);                         \
+            if (derived().visit##Kind(n)) derived().traverseChildren(n); \
+            return;                                                      \
+        }
+        AST_NODE_KINDS(AST_DISPATCH)
+#undef AST_DISPATCH
+        }
+    }
+
+    // Every visit hook continues into the children unless overridden
+#define AST_DEFAULT_VISIT(Kind, Class) \
+    bool visit##Kind(Class*) { return true; }
+    AST_NODE_KINDS(AST_DEFAULT_VISIT)
+#undef AST_DEFAULT_VISIT
+
+    void traverseChildren(NumberExprAST*) {}
+    void traverseChildren(VariableExprAST*) {}
+    void traverseChildren(StringLiteralAST*) {}
+    void traverseChildren(UnaryExprAST* n) { derived().traverse(n->getOperand()); }
+    void traverseChildren(BinaryExprAST* n) {
+        derived().traverse(n->getLHS());
+        derived().traverse(n->getRHS());
+    }
+    void traverseChildren(AssignmentExprAST* n) { derived().traverse(n->getValue()); }
+    void traverseChildren(FunctionLiteralAST* n) { derived().traverse(n->getBody()); }
+    void traverseChildren(FunctionCallAST* n) {
+        derived().traverse(n->getCallee());
+        for (auto* arg : n->getArgs()) derived().traverse(arg);
+    }
+    void traverseChildren(PrintStmtAST* n) {
+        derived().traverse(n->getFormatExpr());
+        for (auto* arg : n->getArgs()) derived().traverse(arg);
+    }
+    void traverseChildren(IfStmtAST* n) {
+        derived().traverse(n->getCondition());
+        derived().traverse(n->getThenStmt());
+        derived().traverse(n->getElseStmt());
+    }
+    void traverseChildren(WhileStmtAST* n) {
+        derived().traverse(n->getCondition());
+        derived().traverse(n->getBody());
+    }
+    void traverseChildren(BlockAST* n) {
+        for (auto* stmt : n->getStatements()) derived().traverse(stmt);
+    }
+    void traverseChildren(ReturnStmtAST* n) { derived().traverse(n->getValue()); }
+    void traverseChildren(ImportStmtAST*) {}
+    void traverseChildren(ExportStmtAST* n) { derived().traverse(n->getDeclaration()); }
+    void traverseChildren(ProgramAST* n) {
+        for (auto* exp : n->getExports()) derived().traverse(exp);
+        for (auto* stmt : n->getStatements()) derived().traverse(stmt);
+    }
+};
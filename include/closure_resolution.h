@@ -0,0 +1,10 @@
+#pragma once
+#include "ast.h"
+
+// AIDEV-NOTE: Closure resolution, one walk per parse (run by Parser::parseProgram). Every fn
+// literal records its free variables: names read in its own body (nested literals excluded)
+// that are not parameters, mut() captures or declared in the body, in first-use order, which
+// is also their env slot order. A literal bound by `name = fn ...` (without 'mut') whose body
+// reads name records it as its self name. Type checking and codegen read these annotations
+// instead of re-walking function bodies.
+void resolveClosures(ASTNode* root, ASTContext& context);
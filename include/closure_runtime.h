@@ -0,0 +1,21 @@
+#pragma once
+#include "codegen.h"
+#include "ast.h"
+
+// AIDEV-NOTE: Closure memory runtime. Envs, closure bundles and mutable capture cells are
+// bump-allocated from a chunked arena instead of malloc. The runtime is emitted as IR into
+// the module being compiled (linkonce_odr, so separately compiled modules share one arena),
+// which keeps lli, --run and native executables free of an extra library to link.
+//
+//   ptr  __arith_arena_alloc(i64 size)   bump allocation, 8-byte aligned
+//   ptr  __arith_arena_mark()            current allocation point
+//   void __arith_arena_release(ptr mark) free everything allocated after mark
+llvm::Function* getArenaAlloc(CodeGen& cg);
+llvm::Function* getArenaMark(CodeGen& cg);
+llvm::Function* getArenaRelease(CodeGen& cg);
+
+// True if a while loop creates closures and none of them can be reachable once the
+// iteration that created them ends, so the loop may release the arena per iteration.
+// Conservative: any call to a function not defined inside the loop, any return, and any
+// store of a possibly-function value into a variable visible before the loop disqualify it.
+bool loopClosuresAreIterationLocal(ExprAST* condition, ASTNode* body, CodeGen& cg);
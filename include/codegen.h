@@ -4,64 +4,75 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Value.h"
 #include "lexer.h"
+#include "scoped_symbol_table.h"
 #include <map>
 #include <memory>
 #include <vector>
 #include <string>
+#include <string_view>
+
+namespace llvm {
+    class TargetMachine;
+}
 
 class CodeGen {
 private:
     std::unique_ptr<llvm::LLVMContext> context;
     std::unique_ptr<llvm::Module> module;
     std::unique_ptr<llvm::IRBuilder<>> builder;
-        // Enhanced symbol representation with mutability & scope tracking
-        struct Symbol {
-                std::string name;
-            llvm::AllocaInst* allocaInst;
-                bool is_mutable;
-                bool is_initialized;
-                SourceLocation declaration_site;
-                int scope_level;
-
-                Symbol() = default;
-            Symbol(const std::string& n,
-                   llvm::AllocaInst* a,
-                             bool mut = false,
-                             bool init = true,
-                             SourceLocation loc = {},
-                             int scope = 0)
-                : name(n), allocaInst(a), is_mutable(mut), is_initialized(init),
-                            declaration_site(loc), scope_level(scope) {}
-        };
+    // Enhanced symbol representation with mutability tracking
+    struct Symbol {
+        llvm::Value* storage = nullptr;  // entry-block alloca, or a closure's shared capture cell
+        bool is_mutable = false;
+        bool is_initialized = false;
+        // storage is a getClosureType() slot rather than a double
+        bool is_closure_slot = false;
+        // storage is an alloca handed out by acquireSlot(); released when the binding dies
+        bool owns_slot = false;
+        SourceLoc declaration_site;
+        // Set when an immutable binding is known to hold a specific fn literal, so calls
+        // through it can be direct. knownEnv is the env value if statically available
+        // (null constant for capture-free functions), otherwise nullptr = load from bundle.
+        llvm::Function* knownFunction = nullptr;
+        llvm::Value* knownEnv = nullptr;
 
-        // Stack of scopes (innermost at back)
-        std::vector<std::map<std::string, Symbol>> scopes;
-    std::string sourceFileName;
+        Symbol() = default;
+        Symbol(llvm::Value* a, bool mut = false, bool init = true, SourceLoc loc = {})
+            : storage(a), is_mutable(mut), is_initialized(init), declaration_site(loc) {}
+    };
 
-    // AIDEV-NOTE: Mutable capture sync stack — one entry per function being generated.
-    // Each entry is a list of {local_alloca, shared_heap_ptr} pairs. When a return
-    // is emitted, emitMutCaptureSyncs() stores local values back to heap storage so
-    // the shared state persists across closure calls.
+    ScopedSymbolTable<Symbol> symbols;
 
-    // AIDEV-NOTE: Self-referential function support — set to the variable name being assigned
-    // to when generating a recursive function literal. FunctionLiteralAST::codegen() reads
-    // this to reconstruct the closure self-bundle inside the inner function body.
-    std::string pendingSelfRefVar;
+    // AIDEV-NOTE: Slot allocator. A binding's alloca is dead once its scope exits or a
+    // same-scope redeclaration shadows it (no name can reach it again), so it goes back to a
+    // per-function, per-type free list and the next declaration reuses it. Every declaration
+    // stores before any read, so distinct live ranges never observe each other's values.
+    std::map<std::pair<llvm::Function*, llvm::Type*>, std::vector<llvm::AllocaInst*>> freeSlots;
+    bool reuseSlots = true;
+    llvm::AllocaInst* acquireSlot(llvm::Function* function, llvm::Type* type, std::string_view name);
+    void releaseSlot(const Symbol& sym);
+    std::string sourceFileName;
+    // Host target machine, created lazily; gives the optimizer a real cost model
+    std::unique_ptr<llvm::TargetMachine> targetMachine;
+    std::string targetTriple;
+    std::string targetCPU = "generic";
+    std::string targetFeatures;
 
-public:
-    struct MutCaptureSync {
-        llvm::AllocaInst* localAlloca;  // mutable local double alloca inside closure
-        llvm::Value*      sharedPtr;    // pointer to shared heap double
-    };
-private:
-    std::vector<std::vector<MutCaptureSync>> mutCaptureSyncStack;
+    void emitFile(const std::string& filename, bool assembly);
 
 public:
     CodeGen(const std::string& moduleName, const std::string& sourceFile = "");
+    ~CodeGen();
     
     llvm::LLVMContext& getContext() { return *context; }
     llvm::Module& getModule() { return *module; }
     llvm::IRBuilder<>& getBuilder() { return *builder; }
+    // Hand the finished module and its context to a consumer such as the JIT
+    std::unique_ptr<llvm::Module> takeModule() { return std::move(module); }
+    std::unique_ptr<llvm::LLVMContext> takeContext() { return std::move(context); }
+    // Emit into next from now on and hand back the module emitted so far. next must belong
+    // to this context; used to compile each source module separately (module_compiler.h).
+    std::unique_ptr<llvm::Module> swapModule(std::unique_ptr<llvm::Module> next);
 
     // Scope management
     void enterScope();
@@ -69,48 +80,73 @@ public:
 
     // Variable APIs (enhanced)
     // Back-compat: createVariable declares an immutable variable in the current scope
-    llvm::AllocaInst* createVariable(const std::string& name);
+    llvm::AllocaInst* createVariable(std::string_view name);
     // Declare variable with explicit mutability and location
-    llvm::AllocaInst* declareVariable(const std::string& name, bool is_mutable,
-                                      const SourceLocation& loc = SourceLocation{});
-    // Lookup variable alloca from innermost scope outward
-    llvm::AllocaInst* getVariable(const std::string& name);
+    llvm::AllocaInst* declareVariable(std::string_view name, bool is_mutable,
+                                      SourceLoc loc = {});
+    // Declare a Function-typed variable backed by a { fn, env, bundle } closure slot
+    llvm::AllocaInst* declareClosureVariable(std::string_view name, bool is_mutable,
+                                             SourceLoc loc = {});
+    // Bind name in the current scope to existing storage (e.g. a mutable capture cell)
+    void bindVariable(std::string_view name, llvm::Value* storage, bool is_mutable,
+                      SourceLoc loc = {});
+    // Toggle alloca reuse across non-overlapping bindings (on by default; benchmarks compare)
+    void setSlotReuse(bool enabled) { reuseSlots = enabled; }
+    // Lookup variable storage from innermost scope outward
+    llvm::Value* getVariable(std::string_view name);
+    // Load a variable's value as a double (closure slots yield their encoded bundle);
+    // nullptr if the name is not in scope
+    llvm::Value* emitVariableLoad(std::string_view name, std::string_view valueName = {});
+    bool isClosureSlot(std::string_view name) const {
+        auto* s = lookupNearestSymbol(name); return s && s->is_closure_slot;
+    }
+    // { ptr fn, ptr env, ptr bundle }
+    llvm::StructType* getClosureType();
     // Back-compat setter: sets/overwrites symbol in current scope as immutable
-    void setVariable(const std::string& name, llvm::AllocaInst* alloca);
+    void setVariable(std::string_view name, llvm::Value* storage);
 
     // Symbol/introspection helpers
-    bool canReassign(const std::string& name) const; // true if found and mutable
-    bool canShadow(const std::string& name) const;   // always true (language allows)
+    bool canReassign(std::string_view name) const; // true if found and mutable
+    bool canShadow(std::string_view name) const;   // always true (language allows)
     // Lookup helpers
-    const Symbol* lookupNearestSymbol(const std::string& name) const;
-    const Symbol* lookupCurrentSymbol(const std::string& name) const;
+    const Symbol* lookupNearestSymbol(std::string_view name) const;
+    const Symbol* lookupCurrentSymbol(std::string_view name) const;
 
     // Convenience helpers for current scope to avoid exposing Symbol outside
-    bool hasCurrentSymbol(const std::string& name) const;
-    bool isCurrentSymbolMutable(const std::string& name) const;
-    llvm::AllocaInst* getCurrentAlloca(const std::string& name) const;
+    bool hasCurrentSymbol(std::string_view name) const;
+    bool isCurrentSymbolMutable(std::string_view name) const;
+    llvm::Value* getCurrentAlloca(std::string_view name) const;
     // Nearest-scope convenience helpers
-    bool hasNearestSymbol(const std::string& name) const { return lookupNearestSymbol(name) != nullptr; }
-    bool isNearestSymbolMutable(const std::string& name) const {
+    bool hasNearestSymbol(std::string_view name) const { return lookupNearestSymbol(name) != nullptr; }
+    bool isNearestSymbolMutable(std::string_view name) const {
         auto* s = lookupNearestSymbol(name); return s ? s->is_mutable : false;
     }
-    llvm::AllocaInst* getNearestAlloca(const std::string& name) const {
-        auto* s = lookupNearestSymbol(name); return s ? s->allocaInst : nullptr;
+    llvm::Value* getNearestAlloca(std::string_view name) const {
+        auto* s = lookupNearestSymbol(name); return s ? s->storage : nullptr;
+    }
+
+    // Statically-known function bindings (see Symbol::knownFunction)
+    void setKnownFunction(std::string_view name, llvm::Function* fn, llvm::Value* env);
+    llvm::Function* getNearestKnownFunction(std::string_view name) const {
+        auto* s = lookupNearestSymbol(name); return s ? s->knownFunction : nullptr;
+    }
+    llvm::Value* getNearestKnownEnv(std::string_view name) const {
+        auto* s = lookupNearestSymbol(name); return s ? s->knownEnv : nullptr;
     }
     
     llvm::Function* getPrintfDeclaration();
-    
-    // Mutable capture sync stack management
-    void pushMutCaptureSyncs(std::vector<MutCaptureSync> syncs);
-    void popMutCaptureSyncs();
-    void emitMutCaptureSyncs();  // emit stores: local alloca → shared heap, top of stack
-
-    // Self-referential function support (for recursive functions)
-    void setPendingSelfRefVar(const std::string& name) { pendingSelfRefVar = name; }
-    void clearPendingSelfRefVar() { pendingSelfRefVar.clear(); }
-    const std::string& getPendingSelfRefVar() const { return pendingSelfRefVar; }
 
     void printModule();
+    // Run the new-PassManager default pipeline (0-3, like clang -O<n>) over the module
+    void optimize(unsigned optLevel);
+    // Run the LTO pipeline (1-3) over a module linked from separately optimized ones
+    void optimizeLinked(unsigned optLevel);
+    // Select CPU ("native" = host CPU) and feature string (e.g. "+avx2") before the
+    // target machine is first used by optimize() or the file writers
+    void setTargetCPU(const std::string& cpu, const std::string& features = "");
+    // Also stamps the current module with the target's triple and data layout
+    llvm::TargetMachine* getTargetMachine();
     void writeObjectFile(const std::string& filename);
+    void writeAssemblyFile(const std::string& filename);
     void setSourceFileName(const std::string& filename);
 };
\ No newline at end of file
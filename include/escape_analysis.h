@@ -0,0 +1,9 @@
+#pragma once
+#include "ast.h"
+
+// AIDEV-NOTE: Closure escape analysis. A fn literal is non-escaping when it is bound to a fresh
+// immutable name (or invoked in place) and that name is only ever called directly from the
+// same function or passed to a known function whose parameter is only called: never returned,
+// stored, printed or referenced by a nested fn literal. Codegen then places its env, bundle
+// and mutable capture cells in entry-block allocas of the creating function.
+void markNonEscapingClosures(ProgramAST* program);
@@ -8,21 +8,22 @@
 // Forward declarations for LLVM types
 namespace llvm {
     class Function;
+    class Value;
 }
 
 // FunctionParameter: a named parameter with optional mutability
 struct FunctionParameter {
-    std::string name;
+    std::string_view name;
     bool is_mutable;
-    SourceLocation location;
+    SourceLoc location;
 };
 
 // CapturedVariable: a variable explicitly captured by a closure
-// AIDEV-NOTE: only mutable captures use mut() clause; immutable captures are auto-detected at codegen
+// AIDEV-NOTE: only mutable captures use mut() clause; immutable captures are auto-detected (resolveClosures)
 struct CapturedVariable {
-    std::string name;
+    std::string_view name;
     bool is_mutable_capture;  // true if declared via mut(var) clause
-    SourceLocation location;
+    SourceLoc location;
 };
 
 // ClosureContext: runtime capture storage for a closure instance
@@ -40,66 +41,89 @@ struct FunctionValue {
 
 // FunctionLiteralAST: fn(params) => expr  OR  fn(params) mut(vars) { stmts }
 class FunctionLiteralAST : public ExprAST {
-    std::vector<FunctionParameter> params;
-    std::vector<CapturedVariable> captures;
-    std::unique_ptr<ASTNode> body;
     bool is_expression_function;  // true for => form, false for { block } form
-    SourceLocation fn_location;
+    // Set by markNonEscapingClosures(): closure storage may live on the creator's stack
+    bool non_escaping = false;
+    bool has_env = false;         // set by codegen: its closures carry an env
+    SourceLoc fn_location;
+    ASTSpan<FunctionParameter> params;
+    ASTSpan<CapturedVariable> captures;
+    ASTNode* body;
+    // Set by resolveClosures() (closure_resolution.h)
+    std::string_view self_name;           // binding the body refers to recursively, if any
+    ASTSpan<std::string_view> free_vars;
+    // Filled in by codegen: the emitted __fn_N
+    llvm::Function* generated_function = nullptr;
+    llvm::Value* env_value = nullptr;  // env pointer, valid in the function that created it
 public:
-    FunctionLiteralAST(std::vector<FunctionParameter> params,
-                       std::vector<CapturedVariable> captures,
-                       std::unique_ptr<ASTNode> body,
+    static bool classof(const ASTNode* node) { return node->getKind() == NodeKind::FunctionLiteral; }
+    FunctionLiteralAST(ASTSpan<FunctionParameter> params,
+                       ASTSpan<CapturedVariable> captures,
+                       ASTNode* body,
                        bool is_expression_function,
-                       SourceLocation loc)
-        : params(std::move(params)), captures(std::move(captures)),
-          body(std::move(body)), is_expression_function(is_expression_function),
-          fn_location(std::move(loc)) {}
+                       SourceLoc loc)
+        : ExprAST(NodeKind::FunctionLiteral), is_expression_function(is_expression_function), fn_location(loc),
+          params(params), captures(captures), body(body) {}
 
     llvm::Value* codegen() override;
 
-    const std::vector<FunctionParameter>& getParams() const { return params; }
-    const std::vector<CapturedVariable>& getCaptures() const { return captures; }
-    ASTNode* getBody() const { return body.get(); }
+    ASTSpan<FunctionParameter> getParams() const { return params; }
+    ASTSpan<CapturedVariable> getCaptures() const { return captures; }
+    ASTNode* getBody() const { return body; }
     bool isExpressionFunction() const { return is_expression_function; }
-    const SourceLocation& getFnLocation() const { return fn_location; }
+    SourceLoc getFnLocation() const { return fn_location; }
+    llvm::Function* getGeneratedFunction() const { return generated_function; }
+    bool hasEnv() const { return has_env; }
+    ASTSpan<std::string_view> getFreeVars() const { return free_vars; }
+    void setFreeVars(ASTSpan<std::string_view> names) { free_vars = names; }
+    std::string_view getSelfName() const { return self_name; }
+    void setSelfName(std::string_view name) { self_name = name; }
+    bool isSelfReferential() const { return !self_name.empty(); }
+    void setNonEscaping(bool value) { non_escaping = value; }
+    bool isNonEscaping() const { return non_escaping; }
+    llvm::Value* getEnvValue() const { return env_value; }
 };
 
 // FunctionCallAST: callee(arg1, arg2, ...)
 class FunctionCallAST : public ExprAST {
-    std::unique_ptr<ExprAST> callee;
-    std::vector<std::unique_ptr<ExprAST>> args;
-    SourceLocation call_location;
+    SourceLoc call_location;
+    ExprAST* callee;
+    ASTSpan<ExprAST*> args;
 public:
-    FunctionCallAST(std::unique_ptr<ExprAST> callee,
-                    std::vector<std::unique_ptr<ExprAST>> args,
-                    SourceLocation loc)
-        : callee(std::move(callee)), args(std::move(args)),
-          call_location(std::move(loc)) {}
+    static bool classof(const ASTNode* node) { return node->getKind() == NodeKind::FunctionCall; }
+    FunctionCallAST(ExprAST* callee, ASTSpan<ExprAST*> args, SourceLoc loc)
+        : ExprAST(NodeKind::FunctionCall), call_location(loc), callee(callee), args(args) {}
 
     llvm::Value* codegen() override;
 
-    ExprAST* getCallee() const { return callee.get(); }
-    const std::vector<std::unique_ptr<ExprAST>>& getArgs() const { return args; }
-    const SourceLocation& getCallLocation() const { return call_location; }
+    ExprAST* getCallee() const { return callee; }
+    ASTSpan<ExprAST*> getArgs() const { return args; }
+    SourceLoc getCallLocation() const { return call_location; }
 };
 
-// Returns true if varName appears as a free variable reference in fn's direct body
-// (not a parameter name, not an explicit capture name, not locally declared in body).
-// Does NOT recurse into nested FunctionLiteralAST nodes.
-bool functionBodyReferencesVar(const FunctionLiteralAST* fn, const std::string& varName);
+// AIDEV-NOTE: Typed closure values. Variables whose static type is Function live in
+// CodeGen::getClosureType() slots { ptr fn, ptr env, ptr bundle } instead of a double, so
+// calls read fn/env straight from registers. The bundle pointer is kept for uses that need
+// the uniform double encoding (arguments, returns, captures, mutable cells).
+// Codegen expr (static type Function) as a closure struct
+llvm::Value* codegenClosureValue(ExprAST* expr);
+// Closure struct -> double-encoded bundle pointer, and back
+llvm::Value* boxClosure(llvm::Value* closure);
+llvm::Value* unboxClosure(llvm::Value* boxed);
 
 // ReturnStmtAST: return; or return expr;
 // AIDEV-NOTE: value is nullptr for bare return (void); checked at type-check in US-008
 class ReturnStmtAST : public ASTNode {
-    std::unique_ptr<ExprAST> value;  // nullptr for bare return
-    SourceLocation return_location;
+    SourceLoc return_location;
+    ExprAST* value;  // nullptr for bare return
 public:
-    ReturnStmtAST(std::unique_ptr<ExprAST> value, SourceLocation loc)
-        : value(std::move(value)), return_location(std::move(loc)) {}
+    static bool classof(const ASTNode* node) { return node->getKind() == NodeKind::Return; }
+    ReturnStmtAST(ExprAST* value, SourceLoc loc)
+        : ASTNode(NodeKind::Return), return_location(loc), value(value) {}
 
     llvm::Value* codegen() override;
 
-    ExprAST* getValue() const { return value.get(); }
+    ExprAST* getValue() const { return value; }
     bool hasValue() const { return value != nullptr; }
-    const SourceLocation& getReturnLocation() const { return return_location; }
+    SourceLoc getReturnLocation() const { return return_location; }
 };
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// 64-bit FNV-1a on every target; tables narrow it only when masking into their slot array.
+// Also used by other name-keyed tables (scoped_symbol_table.h)
+uint64_t hashIdentifier(std::string_view name);
+
+// AIDEV-NOTE: Identifier interning. Every spelling maps to one canonical string_view (its
+// first occurrence, which must outlive the table, e.g. a SourceManager buffer), so equal
+// names from different tokens share the same data pointer and later passes can compare
+// or hash them by pointer. Open addressing over a power-of-two slot array; no copies.
+class IdentifierTable {
+public:
+    IdentifierTable();
+
+    // Canonical view for name, inserting it if new
+    std::string_view intern(std::string_view name);
+    // Canonical view for name, or an empty view if it was never interned
+    std::string_view lookup(std::string_view name) const;
+    size_t size() const { return count; }
+
+private:
+    struct Slot {
+        uint64_t hash = 0;
+        std::string_view name;  // empty = free
+    };
+    std::vector<Slot> slots;
+    size_t count = 0;
+
+    void grow();
+};
@@ -0,0 +1,7 @@
+#pragma once
+#include "codegen.h"
+
+// Execute the module built by cg in-process with ORC LLJIT and call its i32 main().
+// Takes ownership of the module and context, so cg cannot be used for codegen afterwards.
+// lazy = true compiles each function on first call (LLLazyJIT) instead of the whole module up front.
+int runWithJIT(CodeGen& cg, bool lazy = false);
@@ -1,18 +1,12 @@
 #pragma once
 #include <string>
+#include <string_view>
+#include <deque>
 #include <memory>
-
-// Source location and range (1-based indices)
-struct SourceLocation {
-    std::string file;
-    int line = 1;
-    int column = 1;
-};
-
-struct SourceRange {
-    SourceLocation start;
-    SourceLocation end; // exclusive end
-};
+#include "source_location.h"
+#include "source_manager.h"
+#include "identifier_table.h"
+#include "simd_scan.h"
 
 enum TokenType {
     TOK_EOF = -1,
@@ -51,39 +45,54 @@ enum TokenType {
     TOK_DEFAULT = -21
 };
 
+// value is a slice of the lexer's input (the source text of the token; the body of a
+// string literal), or of lexer-owned storage for string literals with escapes. Identifier
+// values are interned: equal names share one data pointer. It stays valid as long as both
+// the input buffer and the Lexer are alive.
 struct Token {
     TokenType type;
-    std::string value;
+    std::string_view value;
     double numValue;
     SourceRange range;
     
-    Token(TokenType t, const std::string& v = "", double n = 0.0, SourceRange r = {}) 
+    Token(TokenType t, std::string_view v = {}, double n = 0.0, SourceRange r = {})
         : type(t), value(v), numValue(n), range(std::move(r)) {}
 };
 
+// AIDEV-NOTE: The lexer does not copy a buffer's text; the buffer (see source_manager.h)
+// stays alive for as long as tokens are in use. Token
+// locations are packed SourceLocs; line/column are only derived for diagnostics.
 class Lexer {
 private:
-    std::string input;
+    std::string_view input;
     std::string filename;
+    SourceLoc base;  // location of input[0]
+    std::deque<std::string> decodedStrings;  // string literals that contained escapes
+    IdentifierTable identifiers;             // identifier token values are interned here
     size_t pos;
     char currentChar;
-    int line = 1;
-    int column = 1; // 1-based
+    const simd_scan::Scanners& scan = simd_scan::activeScanners();
     
     void advance();
+    void advanceBy(size_t n);
     void skipWhitespace();
     void skipComment();
     double readNumber();
-    std::string readIdentifier();
-    std::string readString();
-    Token handleKeywordOrIdentifier(const std::string& identifier, const SourceRange& range);
-    Token handleOperator(char ch, const SourceLocation& startLoc);
+    std::string_view readIdentifier();
+    std::string_view readString();
+    Token handleKeywordOrIdentifier(std::string_view identifier, const SourceRange& range);
+    Token handleOperator(char ch, SourceLoc startLoc);
     
-    inline SourceLocation currentLocation() const { return SourceLocation{filename, line, column}; }
+    inline SourceLoc currentLocation() const { return base.offsetBy(static_cast<uint32_t>(pos)); }
     
 public:
-    Lexer(const std::string& input, std::string filename = "<stdin>");
+    // Lex a SourceManager buffer
+    explicit Lexer(const SourceManager::Buffer& buffer);
+    // Lex a copy of text, registered with getSourceManager() as a buffer named filename, so
+    // diagnostics stay valid after the caller's string is gone
+    Lexer(std::string_view input, std::string filename = "<stdin>");
     Token getNextToken();
     bool isAtEnd() const { return pos >= input.length(); }
     const std::string& getFilename() const { return filename; }
+    const IdentifierTable& getIdentifierTable() const { return identifiers; }
 };
@@ -0,0 +1,40 @@
+#pragma once
+#include "ast.h"
+#include "source_manager.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// AIDEV-NOTE: Persistent module cache. Each parsed module is stored in the cache directory
+// as a compact binary AST in a file named after the hash of the source text, so an unchanged
+// file (e.g. a shared library module) is loaded instead of re-lexed and re-parsed, whatever
+// path it was imported from. The header records the format version, the compiler version,
+// the source's size and hash and a checksum of the encoded tree, all checked on load; any
+// mismatch or damage is a miss.
+// Locations are stored relative to the source buffer and rebased on load, so diagnostics
+// still point into the real file. The compiler version includes a hash of the parser, closure
+// resolution and encoder sources (CMakeLists.txt), so rebuilt compilers ignore older entries;
+// bumping kModuleCacheFormat when the encoding changes remains a backstop.
+class ModuleCache {
+public:
+    explicit ModuleCache(std::string directory) : directory(std::move(directory)) {}
+
+    // Tree cached for source's exact contents, or nullptr on a miss or an invalid entry
+    std::unique_ptr<ProgramAST> load(const SourceManager::Buffer& source) const;
+    // Save program, parsed from source, for later runs; best effort, failures are ignored.
+    // Safe to call from several threads and processes at once.
+    void store(const SourceManager::Buffer& source, ProgramAST& program) const;
+
+    const std::string& getDirectory() const { return directory; }
+
+private:
+    std::string directory;
+
+    std::string entryPath(uint64_t sourceHash) const;
+};
+
+// The encoding used by ModuleCache, exposed for tests and benchmarks
+std::string serializeModule(ProgramAST& program, const SourceManager::Buffer& source);
+// nullptr if data is not a valid entry for source
+std::unique_ptr<ProgramAST> deserializeModule(std::string_view data, const SourceManager::Buffer& source);
@@ -0,0 +1,63 @@
+#pragma once
+#include "module_resolver.h"
+#include "type_check.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Module.h"
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+class CodeGen;
+
+// AIDEV-NOTE: Separate compilation. Each imported module is type-checked and emitted into an
+// llvm::Module of its own (in CodeGen's context) and optimized alone, so no single function
+// holds the whole program; link() then merges them into the entry module. A module's top-level
+// code becomes an external init function that main calls, in dependency order, before the entry
+// module's own code. Only exported names cross modules: init ends by copying each one into an
+// external global "<module>.<name>", which importers bind as an immutable variable, and a
+// capture-free exported fn is also made external as "<module>.<name>.fn" so importers call it
+// directly. After linking, only main stays external and the LTO pipeline optimizes across
+// the old boundaries. Modules are still emitted one at a time: CodeGen is a process-wide instance.
+class ModuleCompiler {
+public:
+    ModuleCompiler(CodeGen& codeGen, unsigned optLevel) : codeGen(codeGen), optLevel(optLevel) {}
+
+    // Compile an imported module (after all of its dependencies) into its own llvm::Module,
+    // optimized at optLevel when that is above 0
+    void compileLibrary(ModuleResolver::ResolvedModule& mod);
+    // Emit the entry module at the builder's insert point, after calls to the init function
+    // of every library compiled so far
+    void compileEntry(ModuleResolver::ResolvedModule& mod);
+    // Link the compiled libraries into codeGen's module, internalize everything but main and,
+    // above -O0, run CodeGen::optimizeLinked() across the former module boundaries
+    void link();
+
+private:
+    struct Export {
+        StaticType type = StaticType::Number;
+        int paramCount = -1;
+        std::string global;                          // external double holding the value
+        std::string function;                        // external fn for direct calls, or empty
+        llvm::FunctionType* functionType = nullptr;
+    };
+    struct Interface {
+        std::string name;  // as written at its first import, for diagnostics
+        std::map<std::string, Export, std::less<>> exports;
+    };
+    struct Import {
+        ModuleBinding binding;  // local name (the alias, if any) and type
+        const Export* source;
+    };
+
+    CodeGen& codeGen;
+    unsigned optLevel;
+    std::map<std::string, Interface> interfaces;  // by file path
+    std::vector<std::unique_ptr<llvm::Module>> libraries;
+    std::vector<std::string> initFunctions;
+
+    std::vector<Import> resolveImports(const ModuleResolver::ResolvedModule& mod) const;
+    static std::vector<ModuleBinding> importTypes(const std::vector<Import>& imports);
+    void bindImports(const std::vector<Import>& imports);
+};
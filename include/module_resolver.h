@@ -1,31 +1,53 @@
 #pragma once
 #include "ast.h"
+#include "module_cache.h"
+#include <exception>
 #include <string>
 #include <vector>
 #include <map>
 #include <set>
 #include <memory>
 
+// AIDEV-NOTE: Module loading runs in two phases. First every reachable file is read and
+// parsed on a small thread pool: as soon as a module's imports are known, the files they
+// name are queued, so independent modules parse concurrently. Then a sequential depth-first
+// walk from the entry file computes the topological loadOrder, detects cycles and reports
+// failures in the same order the old one-file-at-a-time resolver did.
 class ModuleResolver {
 public:
     struct ResolvedModule {
         std::string name;
         std::string filepath;
         std::unique_ptr<ProgramAST> ast;
-        std::vector<std::string> dependencies;
+        std::vector<std::string> dependencies;  // resolved path of each import, in import order
+        bool found = false;                     // the file could be read
+        std::exception_ptr parseError;          // set if the module could not be loaded or parsed
     };
 
-    ModuleResolver() = default;
+    ModuleResolver();
 
+    // Loads the entry file and everything it imports. Returns the modules in topological
+    // order (each after its dependencies, the entry file last), for separate compilation.
+    std::vector<std::unique_ptr<ResolvedModule>> resolveModules(const std::string& entryFile);
     // Resolves all dependencies starting from the entry file.
     // Returns a combined ProgramAST with all statements in topological order.
     std::unique_ptr<ProgramAST> resolve(const std::string& entryFile);
 
+    // Worker threads used besides the calling one (default: one per extra hardware thread)
+    void setMaxHelperThreads(unsigned count) { maxHelperThreads = count; }
+    // Load unchanged modules from (and save newly parsed ones to) cache; nullptr disables
+    void setCache(const ModuleCache* moduleCache) { cache = moduleCache; }
+
 private:
+    class Loader;
+
     std::map<std::string, std::unique_ptr<ResolvedModule>> modules;
     std::vector<std::string> loadOrder;
     std::set<std::string> visiting;
+    unsigned maxHelperThreads;
+    const ModuleCache* cache = nullptr;
 
-    void loadModule(const std::string& moduleName, const std::string& filepath, const SourceLocation& importLoc);
+    void parseModule(ResolvedModule& mod);
+    void orderModule(const std::string& moduleName, const std::string& filepath, SourceLoc importLoc);
     std::string resolveModulePath(const std::string& moduleName, const std::string& currentFile);
 };
@@ -0,0 +1,11 @@
+#pragma once
+#include <string_view>
+
+// AIDEV-NOTE: Correctly rounded, locale-independent, allocation-free parser for the
+// language's numeric literals (digits, optionally '.' digits; the lexer validates the
+// shape). Up to 19 significant digits are accumulated in a uint64; when that value and
+// the decimal exponent are both exactly representable (Clinger's fast path: mantissa
+// <= 2^53, |exp| <= 22) one IEEE multiply/divide gives the correctly rounded result.
+// Everything else goes through std::from_chars on the same buffer.
+// Throws std::runtime_error if the value overflows a double.
+double parseDecimalLiteral(std::string_view text);
@@ -7,3 +7,6 @@ std::string getLine(const std::string& source, int lineNumber);
 
 // Print standardized parse error with optional source snippet and caret to stderr
 void printParseError(const ParseError& e, const std::string& source);
+// Same, taking the snippet from the SourceManager's line index (no snippet if the file
+// was never loaded)
+void printParseError(const ParseError& e);
@@ -2,57 +2,98 @@
 #include "lexer.h"
 #include "ast.h"
 #include "function_ast.h"
+#include <exception>
 #include <memory>
-#include <map>
 #include <stdexcept>
+#include <vector>
 
 // ParseError exception carrying source location
 class ParseError : public std::runtime_error {
 public:
     SourceLocation loc;
+    SourceLoc packedLoc;  // set when raised from a packed location; finds the exact buffer
     explicit ParseError(const std::string& message, SourceLocation where)
         : std::runtime_error(message), loc(std::move(where)) {}
+    // Packed locations are expanded to file/line/column once, when the error is raised
+    explicit ParseError(const std::string& message, SourceLoc where)
+        : std::runtime_error(message), loc(getSourceManager().getPresumedLoc(where)), packedLoc(where) {}
 };
 
 class Parser {
 private:
     Lexer& lexer;
-    Token currentToken;
-    Token previousToken;
-    std::map<int, int> binOpPrecedence;
+    // AIDEV-NOTE: Token lookahead ring. The lexer fills it in batches and advancing only moves
+    // head, so no Token is copied; the slot behind head still holds the previous token. A
+    // lexer error stops the batch and is rethrown only when the parser advances or peeks onto
+    // it, so diagnostics come out in source order as with one-token lexing.
+    static constexpr size_t kRingSize = 32;  // power of two
+    static constexpr size_t kMaxLookahead = 8;
+    std::vector<Token> ring;
+    size_t head = 0;   // absolute index of the current token
+    size_t lexed = 0;  // absolute index one past the last token in the ring
+    bool sawEOF = false;
+    std::exception_ptr lexError;
     int functionDepth = 0;  // tracks nesting depth inside function bodies
+    std::unique_ptr<ASTContext> context;  // arena for the tree being built
+    // Children of every list under construction, innermost last; see takeList()
+    std::vector<ASTNode*> listScratch;
 
-    void getNextToken() { previousToken = currentToken; currentToken = lexer.getNextToken(); }
-    std::unique_ptr<ExprAST> parseExpression();
-    std::unique_ptr<ExprAST> parseAssignment();
-    std::unique_ptr<ASTNode> parsePrintStatement();
-    std::unique_ptr<ASTNode> parseIfStatement();
-    std::unique_ptr<ASTNode> parseWhileStatement();
-    std::unique_ptr<ASTNode> parseBlock();
-    std::unique_ptr<ExprAST> parseBinOpRHS(int exprPrec, std::unique_ptr<ExprAST> lhs);
-    std::unique_ptr<ExprAST> parsePrimary();
-    std::unique_ptr<ExprAST> parseUnaryExpr();
-    std::unique_ptr<ExprAST> parseParenExpr();
-    std::unique_ptr<ExprAST> parseNumberExpr();
-    std::unique_ptr<ExprAST> parseIdentifierExpr();
-    std::unique_ptr<ExprAST> parseStringLiteral();
-    std::unique_ptr<ExprAST> parseFunctionLiteral();
-    std::unique_ptr<ExprAST> parsePostfixExpr();
-    std::unique_ptr<ExprAST> parseFunctionCall(std::unique_ptr<ExprAST> callee);
-    std::vector<CapturedVariable> parseCaptureClause();
-    std::unique_ptr<ASTNode> parseReturnStatement();
-    std::unique_ptr<ImportStmtAST> parseImportStatement();
-    std::unique_ptr<ExportStmtAST> parseExportStatement();
+    template <typename T, typename... Args>
+    T* make(Args&&... args) { return context->create<T>(std::forward<Args>(args)...); }
+    // Move listScratch[mark..] into the arena as the finished list
+    template <typename T>
+    ASTSpan<T*> takeList(size_t mark) {
+        const size_t count = listScratch.size() - mark;
+        if (count == 0) return {};
+        auto** items = static_cast<T**>(context->allocate(sizeof(T*) * count, alignof(T*)));
+        for (size_t i = 0; i < count; ++i) items[i] = static_cast<T*>(listScratch[mark + i]);
+        listScratch.resize(mark);
+        return ASTSpan<T*>(items, static_cast<uint32_t>(count));
+    }
+
+    const Token& currentToken() const { return ring[head & (kRingSize - 1)]; }
+    const Token& previousToken() const { return ring[(head - 1) & (kRingSize - 1)]; }
+    // Token n positions after the current one (0 = current), n <= kMaxLookahead
+    const Token& peekToken(size_t n) {
+        if (head + n >= lexed) fillTokens(n);
+        return ring[(head + n) & (kRingSize - 1)];
+    }
+    void getNextToken() {
+        if (head + 1 >= lexed) fillTokens(1);
+        ++head;
+    }
+    void fillTokens(size_t needed);
+    ExprAST* parseExpression();
+    ExprAST* parseAssignment();
+    ASTNode* parsePrintStatement();
+    ASTNode* parseIfStatement();
+    ASTNode* parseWhileStatement();
+    ASTNode* parseBlock();
+    ExprAST* parseBinOpRHS(int exprPrec, ExprAST* lhs);
+    ExprAST* parsePrimary();
+    ExprAST* parseUnaryExpr();
+    ExprAST* parseParenExpr();
+    ExprAST* parseNumberExpr();
+    ExprAST* parseIdentifierExpr();
+    ExprAST* parseStringLiteral();
+    ExprAST* parseFunctionLiteral();
+    ExprAST* parsePostfixExpr();
+    ExprAST* parseFunctionCall(ExprAST* callee);
+    ASTSpan<CapturedVariable> parseCaptureClause();
+    ASTNode* parseReturnStatement();
+    ImportStmtAST* parseImportStatement();
+    ExportStmtAST* parseExportStatement();
     int getTokenPrecedence();
-    std::unique_ptr<ASTNode> parseStatement();
+    ASTNode* parseStatement();
     [[noreturn]] void errorHere(const std::string& msg) {
-        throw ParseError(msg, currentToken.range.start);
+        throw ParseError(msg, currentToken().range.start);
     }
-    [[noreturn]] void errorAt(const std::string& msg, SourceLocation loc) {
-        throw ParseError(msg, std::move(loc));
+    [[noreturn]] void errorAt(const std::string& msg, SourceLoc loc) {
+        throw ParseError(msg, loc);
     }
     
 public:
     Parser(Lexer& lexer);
+    // The returned program owns the arena holding the whole tree
     std::unique_ptr<ProgramAST> parseProgram();
 };
\ No newline at end of file
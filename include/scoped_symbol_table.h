@@ -0,0 +1,108 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Dense ids for names: 0, 1, 2... in first-seen order. Owns its spellings, so callers may
+// pass temporaries. Open addressing over a power-of-two slot array, like IdentifierTable.
+class SymbolIdTable {
+public:
+    static constexpr uint32_t None = UINT32_MAX;
+
+    SymbolIdTable();
+    uint32_t getOrCreate(std::string_view name);
+    uint32_t find(std::string_view name) const;  // None if never seen
+    size_t size() const { return spellings.size(); }
+
+private:
+    struct Slot {
+        uint64_t hash = 0;
+        uint32_t id = None;  // None = free
+    };
+    std::vector<Slot> slots;
+    std::vector<std::string> spellings;
+
+    void grow();
+};
+
+// AIDEV-NOTE: Scoped symbol table shared by CodeGen and the type checker. Each name id indexes
+// its innermost visible binding directly, so a lookup is one hash probe no matter how deep the
+// scope stack is. declare() saves the binding it shadows in an undo log and exitScope() pops the
+// log back to the scope's marker, restoring outer bindings. Redeclaring a name in the same
+// scope overwrites in place without logging: the old binding is unreachable either way.
+// Bindings live in a deque, so pointers from lookup() survive later declarations.
+template <typename Info>
+class ScopedSymbolTable {
+public:
+    ScopedSymbolTable() : scopeMarkers{0} {}
+
+    void enterScope() { scopeMarkers.push_back(undoLog.size()); }
+
+    // Drop the innermost scope, calling onDiscard(info) for each of its live bindings.
+    // Exiting the global scope just clears it.
+    template <typename F>
+    void exitScope(F&& onDiscard) {
+        while (undoLog.size() > scopeMarkers.back()) {
+            Undo& undo = undoLog.back();
+            onDiscard(static_cast<const Info&>(bindings[undo.id].info));
+            bindings[undo.id] = undo.shadowed;
+            undoLog.pop_back();
+        }
+        if (scopeMarkers.size() > 1) scopeMarkers.pop_back();
+    }
+    void exitScope() { exitScope([](const Info&) {}); }
+
+    // Innermost binding of name, or nullptr
+    Info* lookup(std::string_view name) {
+        Binding* b = find(name);
+        return b ? &b->info : nullptr;
+    }
+    const Info* lookup(std::string_view name) const {
+        return const_cast<ScopedSymbolTable*>(this)->lookup(name);
+    }
+
+    // Binding of name in the innermost scope only, or nullptr
+    Info* lookupCurrent(std::string_view name) {
+        Binding* b = find(name);
+        return b && b->depth == currentDepth() ? &b->info : nullptr;
+    }
+    const Info* lookupCurrent(std::string_view name) const {
+        return const_cast<ScopedSymbolTable*>(this)->lookupCurrent(name);
+    }
+
+    // Bind name in the innermost scope; returns the new binding
+    Info& declare(std::string_view name, const Info& info) {
+        uint32_t id = ids.getOrCreate(name);
+        if (id >= bindings.size()) bindings.resize(id + 1);
+        Binding& b = bindings[id];
+        if (!(b.bound && b.depth == currentDepth())) undoLog.push_back(Undo{id, b});
+        b = Binding{info, currentDepth(), true};
+        return b.info;
+    }
+
+    uint32_t currentDepth() const { return static_cast<uint32_t>(scopeMarkers.size() - 1); }
+
+private:
+    struct Binding {
+        Info info{};
+        uint32_t depth = 0;
+        bool bound = false;
+    };
+    struct Undo {
+        uint32_t id;
+        Binding shadowed;
+    };
+    SymbolIdTable ids;
+    std::deque<Binding> bindings;     // indexed by name id
+    std::vector<Undo> undoLog;
+    std::vector<size_t> scopeMarkers; // undoLog size at each scope entry
+
+    Binding* find(std::string_view name) {
+        uint32_t id = ids.find(name);
+        if (id == SymbolIdTable::None || id >= bindings.size() || !bindings[id].bound) return nullptr;
+        return &bindings[id];
+    }
+};
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+
+// AIDEV-NOTE: Vectorized byte scanners used by the lexer to jump over whitespace runs,
+// comment bodies and string-literal bodies 16/32 bytes at a time. The implementation is
+// picked once at startup from what the CPU supports (AVX2, SSE2, else scalar); all levels
+// return identical results. Each scanner returns the length of the prefix of [p, p + n)
+// it skips, i.e. the offset of the first byte that stops it (n if none does).
+namespace simd_scan {
+
+enum class Level { Scalar, SSE2, AVX2 };
+
+struct Scanners {
+    // ' ', \t, \n, \v, \f, \r (std::isspace in the C locale)
+    size_t (*whitespace)(const char* p, size_t n);
+    // Stops at \n, \r or NUL: the end of a // comment
+    size_t (*lineEnd)(const char* p, size_t n);
+    // Stops at '"', '\\', \n, \r or NUL: the next byte a string literal must look at
+    size_t (*stringBody)(const char* p, size_t n);
+};
+
+bool isSupported(Level level);
+const Scanners& getScanners(Level level);   // level must be supported
+const Scanners& activeScanners();           // best supported level
+Level activeLevel();
+
+} // namespace simd_scan
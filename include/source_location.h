@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Expanded source location (1-based), computed by SourceManager::getPresumedLoc() when a
+// diagnostic is reported. Not stored in tokens or AST nodes.
+struct SourceLocation {
+    std::string file;
+    int line = 1;
+    int column = 1;
+};
+
+// AIDEV-NOTE: Packed 32-bit location. Every buffer registered with the SourceManager owns a
+// contiguous slice of one global offset space, so a single value encodes both the file and
+// the byte offset within it (clang-style). 0 is the invalid/unknown location.
+struct SourceLoc {
+    uint32_t raw = 0;
+
+    bool isValid() const { return raw != 0; }
+    SourceLoc offsetBy(uint32_t bytes) const { return SourceLoc{raw + bytes}; }
+    friend bool operator==(SourceLoc a, SourceLoc b) { return a.raw == b.raw; }
+    friend bool operator!=(SourceLoc a, SourceLoc b) { return a.raw != b.raw; }
+};
+
+struct SourceRange {
+    SourceLoc start;
+    SourceLoc end; // exclusive end
+};
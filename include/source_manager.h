@@ -0,0 +1,71 @@
+#pragma once
+#include "source_location.h"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using FileID = uint32_t;
+
+// AIDEV-NOTE: Owner of every source buffer the compiler reads. Files are memory-mapped
+// (or read once into a single allocation where mmap is unavailable) and stay alive for the
+// whole compilation, so the lexer, tokens and diagnostics can refer to slices of them
+// without copying. Buffers never move once loaded.
+//
+// File paths are interned: each buffer gets a FileID and a base in the packed SourceLoc
+// space (see source_location.h), so a location is 4 bytes and line/column are only
+// computed when a diagnostic asks for them. The first such query scans the buffer once into
+// a line-start table; every later one is a binary search.
+//
+// Safe to share between threads (the module resolver parses files in parallel): the
+// buffer tables are guarded by a mutex, and files are read outside it.
+class SourceManager {
+public:
+    struct Buffer {
+        std::string name;
+        std::string_view text;
+        FileID id = 0;
+        uint32_t base = 0;  // SourceLoc of text[0]; text.size() + 1 locations are reserved
+
+        SourceLoc getLoc(size_t offset) const { return SourceLoc{base + static_cast<uint32_t>(offset)}; }
+    };
+
+    SourceManager();
+    ~SourceManager();
+    SourceManager(const SourceManager&) = delete;
+    SourceManager& operator=(const SourceManager&) = delete;
+
+    // Load (or return the already loaded) file; throws std::runtime_error if unreadable
+    const Buffer& loadFile(const std::string& path);
+    // Register in-memory source under name; a later lookup by name finds the newest buffer
+    const Buffer& addBuffer(const std::string& name, std::string contents);
+    // Register text owned by the caller, which must outlive any use of its locations
+    const Buffer& addView(const std::string& name, std::string_view text);
+    // Most recently registered buffer with this name, or nullptr
+    const Buffer* getBuffer(const std::string& name) const;
+    // Buffer containing loc, or nullptr for invalid/unknown locations
+    const Buffer* getBufferFor(SourceLoc loc) const;
+
+    // File, 1-based line and byte column of loc ({} for invalid locations)
+    SourceLocation getPresumedLoc(SourceLoc loc) const;
+    // Text of a 1-based line without its terminator; empty if out of range
+    std::string_view getLineText(const Buffer& buffer, int line) const;
+
+private:
+    struct Entry;
+    std::vector<std::unique_ptr<Entry>> entries;  // indexed by FileID, ordered by base
+    std::map<std::string, FileID> byName;
+    uint32_t nextBase = 1;  // 0 is the invalid location
+    mutable std::mutex mutex;  // guards entries, byName and nextBase
+
+    // Register entry; if dedupe and a buffer with its name exists, return that one instead
+    const Buffer& registerEntry(std::unique_ptr<Entry> entry, bool dedupe = false);
+    const Entry& entryFor(const Buffer& buffer) const;
+    // Offsets where each line starts, built on first use and kept for later diagnostics
+    const std::vector<uint32_t>& getLineStarts(const Entry& entry) const;
+};
+
+// Process-wide source manager used by the driver, the lexer and diagnostics
+SourceManager& getSourceManager();
@@ -1,4 +1,18 @@
 #pragma once
 #include "ast.h"
+#include <vector>
 
 void typeCheck(ASTNode* node, const std::string& filename = "");
+
+// A module-level name shared between separately compiled modules (module_compiler.h)
+struct ModuleBinding {
+    std::string_view name;
+    SourceLoc loc;  // import or export site
+    StaticType type = StaticType::Number;
+    int paramCount = -1;  // only meaningful for functions
+};
+
+// Check one module of a program: imports are declared, immutable, in its global scope first,
+// and each of exports (looked up by name) gets its type from the global scope at the end.
+void typeCheckModule(ProgramAST* module, const std::vector<ModuleBinding>& imports,
+                     std::vector<ModuleBinding>& exports);
@@ -0,0 +1,35 @@
+#include "ast_context.h"
+#include <algorithm>
+#include <cstring>
+
+ASTContext::ASTContext() = default;
+ASTContext::~ASTContext() = default;
+
+void* ASTContext::allocateSlow(size_t size, size_t align) {
+    // Slabs double up to 1 MiB; oversized requests get a slab of their own
+    size_t slabSize = std::max(nextSlabSize, size + align);
+    slabs.push_back(std::make_unique<char[]>(slabSize));
+    if (nextSlabSize < (size_t(1) << 20)) nextSlabSize *= 2;
+    cursor = slabs.back().get();
+    limit = cursor + slabSize;
+    return allocate(size, align);
+}
+
+std::string_view ASTContext::intern(std::string_view name) {
+    if (name.empty()) return name;
+    std::string_view known = names.lookup(name);
+    if (!known.empty()) return known;
+    char* copy = static_cast<char*>(allocate(name.size(), 1));
+    std::memcpy(copy, name.data(), name.size());
+    return names.intern(std::string_view(copy, name.size()));
+}
+
+void ASTContext::absorb(ASTContext& other) {
+    // Keep allocating from our own current slab; other's slabs only need to stay alive
+    slabs.insert(slabs.begin(), std::make_move_iterator(other.slabs.begin()),
+                 std::make_move_iterator(other.slabs.end()));
+    bytesAllocated += other.bytesAllocated;
+    other.slabs.clear();
+    other.cursor = other.limit = nullptr;
+    other.bytesAllocated = 0;
+}
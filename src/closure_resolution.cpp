@@ -0,0 +1,61 @@
+#include "closure_resolution.h"
+#include "ast_visitor.h"
+#include <algorithm>
+#include <set>
+#include <string_view>
+#include <vector>
+
+namespace {
+// Reads and declarations go to the innermost fn literal being walked; top-level code has none
+class ClosureResolver : public RecursiveASTVisitor<ClosureResolver> {
+public:
+    explicit ClosureResolver(ASTContext& context) : context(context) {}
+
+    bool visitVariable(VariableExprAST* var) {
+        if (!frames.empty()) frames.back().refs.push_back(var->getName());
+        return true;
+    }
+
+    bool visitAssignment(AssignmentExprAST* assign) {
+        if (!frames.empty()) frames.back().decls.push_back(assign->getVarName());
+        traverse(assign->getValue());
+        auto* fnLit = dyn_cast<FunctionLiteralAST>(assign->getValue());
+        if (fnLit && !assign->isMutableDeclaration()) {
+            auto freeVars = fnLit->getFreeVars();
+            if (std::find(freeVars.begin(), freeVars.end(), assign->getVarName()) != freeVars.end()) {
+                fnLit->setSelfName(assign->getVarName());
+            }
+        }
+        return false;
+    }
+
+    bool visitFunctionLiteral(FunctionLiteralAST* fnLit) {
+        frames.emplace_back();
+        traverse(fnLit->getBody());
+        Frame frame = std::move(frames.back());
+        frames.pop_back();
+
+        std::set<std::string_view> excluded(frame.decls.begin(), frame.decls.end());
+        for (const auto& p : fnLit->getParams()) excluded.insert(p.name);
+        for (const auto& c : fnLit->getCaptures()) excluded.insert(c.name);
+        std::vector<std::string_view> freeVars;
+        for (auto name : frame.refs) {
+            if (excluded.insert(name).second) freeVars.push_back(name);
+        }
+        fnLit->setFreeVars(context.copySpan(freeVars));
+        return false;
+    }
+
+private:
+    struct Frame {
+        std::vector<std::string_view> refs;
+        std::vector<std::string_view> decls;
+    };
+    ASTContext& context;
+    std::vector<Frame> frames;
+};
+} // namespace
+
+void resolveClosures(ASTNode* root, ASTContext& context) {
+    ClosureResolver(context).traverse(root);
+}
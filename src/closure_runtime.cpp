@@ -0,0 +1,250 @@
+#include "closure_runtime.h"
+#include "ast_visitor.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/IRBuilder.h"
+#include <set>
+#include <string>
+
+// Chunk layout: { ptr prev_chunk, ptr chunk_end } header followed by the data area
+static const uint64_t kArenaChunkSize = 64 * 1024;
+static const uint64_t kArenaChunkHeader = 16;
+
+static llvm::GlobalVariable* getArenaGlobal(CodeGen& cg, const char* name) {
+    if (auto* gv = cg.getModule().getNamedGlobal(name)) return gv;
+    auto* ptrTy = llvm::PointerType::getUnqual(cg.getContext());
+    auto* gv = new llvm::GlobalVariable(
+        cg.getModule(), ptrTy, /*isConstant=*/false, llvm::GlobalValue::LinkOnceODRLinkage,
+        llvm::ConstantPointerNull::get(ptrTy), name);
+    gv->setVisibility(llvm::GlobalValue::HiddenVisibility);
+    return gv;
+}
+
+// Creates an empty runtime function, or returns nullptr if the module already has it
+static llvm::Function* createRuntimeFunction(CodeGen& cg, const char* name, llvm::FunctionType* ty,
+                                             llvm::Function*& existing) {
+    existing = cg.getModule().getFunction(name);
+    if (existing) return nullptr;
+    auto* fn = llvm::Function::Create(ty, llvm::Function::LinkOnceODRLinkage, name, cg.getModule());
+    fn->setVisibility(llvm::GlobalValue::HiddenVisibility);
+    fn->addFnAttr(llvm::Attribute::NoUnwind);
+    return fn;
+}
+
+llvm::Function* getArenaAlloc(CodeGen& cg) {
+    auto& ctx = cg.getContext();
+    auto* ptrTy = llvm::PointerType::getUnqual(ctx);
+    auto* i8Ty = llvm::Type::getInt8Ty(ctx);
+    auto* i64Ty = llvm::Type::getInt64Ty(ctx);
+
+    llvm::Function* existing = nullptr;
+    auto* fn = createRuntimeFunction(
+        cg, "__arith_arena_alloc", llvm::FunctionType::get(ptrTy, {i64Ty}, false), existing);
+    if (!fn) return existing;
+
+    auto* curGV = getArenaGlobal(cg, "__arith_arena_cur");
+    auto* endGV = getArenaGlobal(cg, "__arith_arena_end");
+    auto* chunkGV = getArenaGlobal(cg, "__arith_arena_chunk");
+    auto mallocFn = cg.getModule().getOrInsertFunction(
+        "malloc", llvm::FunctionType::get(ptrTy, {i64Ty}, false));
+
+    auto* entryBB = llvm::BasicBlock::Create(ctx, "entry", fn);
+    auto* fastBB = llvm::BasicBlock::Create(ctx, "fast", fn);
+    auto* slowBB = llvm::BasicBlock::Create(ctx, "new_chunk", fn);
+    llvm::IRBuilder<> b(entryBB);
+
+    // size = (size + 7) & ~7; fits if cur + size <= end (both null before the first chunk)
+    auto* size = b.CreateAnd(b.CreateAdd(fn->getArg(0), b.getInt64(7)), b.getInt64(~7ULL), "size");
+    auto* cur = b.CreateLoad(ptrTy, curGV, "cur");
+    auto* end = b.CreateLoad(ptrTy, endGV, "end");
+    auto* next = b.CreateGEP(i8Ty, cur, size, "next");
+    auto* fits = b.CreateICmpULE(b.CreatePtrToInt(next, i64Ty), b.CreatePtrToInt(end, i64Ty), "fits");
+    auto* nonNull = b.CreateICmpNE(cur, llvm::ConstantPointerNull::get(ptrTy));
+    b.CreateCondBr(b.CreateAnd(fits, nonNull), fastBB, slowBB);
+
+    b.SetInsertPoint(fastBB);
+    b.CreateStore(next, curGV);
+    b.CreateRet(cur);
+
+    // Oversized requests get a chunk of their own
+    b.SetInsertPoint(slowBB);
+    auto* needed = b.CreateAdd(size, b.getInt64(kArenaChunkHeader));
+    auto* chunkSize = b.CreateSelect(
+        b.CreateICmpUGT(needed, b.getInt64(kArenaChunkSize)), needed, b.getInt64(kArenaChunkSize),
+        "chunk_size");
+    auto* chunk = b.CreateCall(mallocFn, {chunkSize}, "chunk");
+    auto* chunkEnd = b.CreateGEP(i8Ty, chunk, chunkSize, "chunk_end");
+    b.CreateStore(b.CreateLoad(ptrTy, chunkGV, "prev"), chunk);
+    b.CreateStore(chunkEnd, b.CreateConstGEP1_64(ptrTy, chunk, 1));
+    b.CreateStore(chunk, chunkGV);
+    auto* data = b.CreateConstGEP1_64(i8Ty, chunk, kArenaChunkHeader, "data");
+    b.CreateStore(b.CreateGEP(i8Ty, data, size), curGV);
+    b.CreateStore(chunkEnd, endGV);
+    b.CreateRet(data);
+    return fn;
+}
+
+llvm::Function* getArenaMark(CodeGen& cg) {
+    auto* ptrTy = llvm::PointerType::getUnqual(cg.getContext());
+    llvm::Function* existing = nullptr;
+    auto* fn = createRuntimeFunction(
+        cg, "__arith_arena_mark", llvm::FunctionType::get(ptrTy, false), existing);
+    if (!fn) return existing;
+
+    llvm::IRBuilder<> b(llvm::BasicBlock::Create(cg.getContext(), "entry", fn));
+    b.CreateRet(b.CreateLoad(ptrTy, getArenaGlobal(cg, "__arith_arena_cur"), "cur"));
+    return fn;
+}
+
+llvm::Function* getArenaRelease(CodeGen& cg) {
+    auto& ctx = cg.getContext();
+    auto* ptrTy = llvm::PointerType::getUnqual(ctx);
+    auto* i8Ty = llvm::Type::getInt8Ty(ctx);
+    auto* i64Ty = llvm::Type::getInt64Ty(ctx);
+
+    llvm::Function* existing = nullptr;
+    auto* fn = createRuntimeFunction(
+        cg, "__arith_arena_release",
+        llvm::FunctionType::get(llvm::Type::getVoidTy(ctx), {ptrTy}, false), existing);
+    if (!fn) return existing;
+
+    auto* curGV = getArenaGlobal(cg, "__arith_arena_cur");
+    auto* endGV = getArenaGlobal(cg, "__arith_arena_end");
+    auto* chunkGV = getArenaGlobal(cg, "__arith_arena_chunk");
+    auto freeFn = cg.getModule().getOrInsertFunction(
+        "free", llvm::FunctionType::get(llvm::Type::getVoidTy(ctx), {ptrTy}, false));
+
+    auto* entryBB = llvm::BasicBlock::Create(ctx, "entry", fn);
+    auto* loopBB = llvm::BasicBlock::Create(ctx, "loop", fn);
+    auto* checkBB = llvm::BasicBlock::Create(ctx, "check", fn);
+    auto* freeBB = llvm::BasicBlock::Create(ctx, "free_chunk", fn);
+    auto* foundBB = llvm::BasicBlock::Create(ctx, "found", fn);
+    auto* emptyBB = llvm::BasicBlock::Create(ctx, "empty", fn);
+    llvm::IRBuilder<> b(entryBB);
+    auto* mark = fn->getArg(0);
+    auto* markI = b.CreatePtrToInt(mark, i64Ty, "mark_i");
+    b.CreateBr(loopBB);
+
+    // Pop chunks until the one holding mark; a null mark frees them all
+    b.SetInsertPoint(loopBB);
+    auto* chunk = b.CreateLoad(ptrTy, chunkGV, "chunk");
+    b.CreateCondBr(b.CreateICmpEQ(chunk, llvm::ConstantPointerNull::get(ptrTy)), emptyBB, checkBB);
+
+    b.SetInsertPoint(checkBB);
+    auto* lo = b.CreatePtrToInt(b.CreateConstGEP1_64(i8Ty, chunk, kArenaChunkHeader), i64Ty);
+    auto* chunkEnd = b.CreateLoad(ptrTy, b.CreateConstGEP1_64(ptrTy, chunk, 1), "chunk_end");
+    auto* inChunk = b.CreateAnd(b.CreateICmpUGE(markI, lo),
+                                b.CreateICmpULE(markI, b.CreatePtrToInt(chunkEnd, i64Ty)));
+    b.CreateCondBr(inChunk, foundBB, freeBB);
+
+    b.SetInsertPoint(freeBB);
+    auto* prev = b.CreateLoad(ptrTy, chunk, "prev");
+    b.CreateCall(freeFn, {chunk});
+    b.CreateStore(prev, chunkGV);
+    b.CreateBr(loopBB);
+
+    b.SetInsertPoint(foundBB);
+    b.CreateStore(mark, curGV);
+    b.CreateStore(chunkEnd, endGV);
+    b.CreateRetVoid();
+
+    b.SetInsertPoint(emptyBB);
+    b.CreateStore(llvm::ConstantPointerNull::get(ptrTy), curGV);
+    b.CreateStore(llvm::ConstantPointerNull::get(ptrTy), endGV);
+    b.CreateRetVoid();
+    return fn;
+}
+
+namespace {
+// Names bound inside a loop's condition and body (including nested fn literals)
+struct LoopBindings : RecursiveASTVisitor<LoopBindings> {
+    std::set<std::string_view> literals;  // names bound to fn literals
+    std::set<std::string_view> others;    // names also bound to anything else (params included)
+
+    bool visitAssignment(AssignmentExprAST* assign) {
+        if (!assign->isMutableDeclaration() && isa<FunctionLiteralAST>(assign->getValue())) {
+            literals.insert(assign->getVarName());
+        } else {
+            others.insert(assign->getVarName());
+        }
+        return true;
+    }
+
+    bool visitFunctionLiteral(FunctionLiteralAST* fnLit) {
+        for (const auto& p : fnLit->getParams()) others.insert(p.name);
+        return true;
+    }
+};
+
+// Walks a loop's condition and body (including nested fn literals) looking for ways a
+// closure allocated during one iteration could still be reachable after it. Node kinds
+// without a visit hook below are walked through, so their children are still checked.
+struct IterationEscapeScan : RecursiveASTVisitor<IterationEscapeScan> {
+    CodeGen& cg;
+    const LoopBindings& bindings;
+    int literalDepth = 0;  // inside a fn literal defined in the loop, return only leaves it
+    bool createsClosures = false;
+    bool escapes = false;
+
+    IterationEscapeScan(CodeGen& cg, const LoopBindings& bindings) : cg(cg), bindings(bindings) {}
+
+    // Stop at the first escape
+    void traverse(ASTNode* node) {
+        if (!escapes) RecursiveASTVisitor::traverse(node);
+    }
+
+    // Values that can never be a closure bundle
+    static bool isPlainNumber(ExprAST* e) {
+        return isa<NumberExprAST>(e) || isa<StringLiteralAST>(e) ||
+               isa<BinaryExprAST>(e) || isa<UnaryExprAST>(e);
+    }
+
+    bool visibleBeforeLoop(std::string_view name) { return cg.getVariable(name) != nullptr; }
+
+    bool isLoopLocalFunction(ExprAST* callee) {
+        if (isa<FunctionLiteralAST>(callee)) return true;
+        auto* var = dyn_cast<VariableExprAST>(callee);
+        return var && bindings.literals.count(var->getName()) && !bindings.others.count(var->getName()) &&
+               !visibleBeforeLoop(var->getName());
+    }
+
+    bool visitAssignment(AssignmentExprAST* assign) {
+        if (!assign->isMutableDeclaration() && visibleBeforeLoop(assign->getVarName()) &&
+            !isPlainNumber(assign->getValue())) {
+            escapes = true;
+        }
+        return !escapes;
+    }
+
+    bool visitFunctionLiteral(FunctionLiteralAST* fnLit) {
+        // Non-escaping closures live on the stack and never touch the arena
+        if (!fnLit->isNonEscaping()) createsClosures = true;
+        ++literalDepth;
+        traverseChildren(fnLit);
+        --literalDepth;
+        return false;
+    }
+
+    bool visitFunctionCall(FunctionCallAST* call) {
+        if (!isLoopLocalFunction(call->getCallee())) escapes = true;
+        return !escapes;
+    }
+
+    bool visitReturn(ReturnStmtAST*) {
+        if (literalDepth == 0) escapes = true;
+        return !escapes;
+    }
+};
+} // namespace
+
+bool loopClosuresAreIterationLocal(ExprAST* condition, ASTNode* body, CodeGen& cg) {
+    LoopBindings bindings;
+    bindings.traverse(condition);
+    bindings.traverse(body);
+    IterationEscapeScan scan(cg, bindings);
+    scan.traverse(condition);
+    scan.traverse(body);
+    return scan.createsClosures && !scan.escapes;
+}
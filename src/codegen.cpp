@@ -1,6 +1,8 @@
 #include "codegen.h"
 #include "ast.h"
 #include "function_ast.h"
+#include "closure_runtime.h"
+#include "escape_analysis.h"
 #include "lexer.h"
 #include "parser.h" // for ParseError
 #include "llvm/IR/Type.h"
@@ -8,6 +10,22 @@
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/MC/TargetRegistry.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetOptions.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Transforms/IPO/GlobalDCE.h"
+#include "llvm/Transforms/IPO/GlobalOpt.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Config/llvm-config.h"
+#if LLVM_VERSION_MAJOR >= 17
+#include "llvm/TargetParser/Host.h"
+#else
+#include "llvm/Support/Host.h"
+#endif
+#include <functional>
 #include <stdexcept>
 #include <vector>
 
@@ -17,20 +35,19 @@ CodeGen::CodeGen(const std::string& moduleName, const std::string& sourceFile) :
     context = std::make_unique<llvm::LLVMContext>();
     module = std::make_unique<llvm::Module>(moduleName, *context);
     builder = std::make_unique<llvm::IRBuilder<>>(*context);
-    // Initialize global scope
-    scopes.emplace_back();
-    
     if (!sourceFileName.empty()) {
         module->setSourceFileName(sourceFileName);
     }
 }
 
-llvm::AllocaInst* CodeGen::createVariable(const std::string& name) {
-    return declareVariable(name, /*is_mutable=*/false, SourceLocation{sourceFileName, 1, 1});
+CodeGen::~CodeGen() = default;
+
+llvm::AllocaInst* CodeGen::createVariable(std::string_view name) {
+    return declareVariable(name, /*is_mutable=*/false, SourceLoc{});
 }
 
-llvm::AllocaInst* CodeGen::declareVariable(const std::string& name, bool is_mutable,
-                                           const SourceLocation& loc) {
+llvm::AllocaInst* CodeGen::declareVariable(std::string_view name, bool is_mutable,
+                                           SourceLoc loc) {
     // Ensure we have a valid insertion point and function (unit tests may call without setup)
     llvm::Function* function = nullptr;
     if (auto* insertBB = builder->GetInsertBlock()) {
@@ -48,78 +65,118 @@ llvm::AllocaInst* CodeGen::declareVariable(const std::string& name, bool is_muta
         auto* entryBB = llvm::BasicBlock::Create(*context, "entry", function);
         builder->SetInsertPoint(entryBB);
     }
+    llvm::AllocaInst* alloca = acquireSlot(function, llvm::Type::getDoubleTy(*context), name);
+    symbols.declare(name, Symbol{alloca, is_mutable, true, loc}).owns_slot = true;
+    return alloca;
+}
+
+llvm::AllocaInst* CodeGen::acquireSlot(llvm::Function* function, llvm::Type* type, std::string_view name) {
+    // The binding being redeclared in this scope becomes unreachable; its slot is free now
+    if (auto* shadowed = symbols.lookupCurrent(name)) releaseSlot(*shadowed);
+
+    auto& pool = freeSlots[{function, type}];
+    if (!pool.empty()) {
+        llvm::AllocaInst* slot = pool.back();
+        pool.pop_back();
+        return slot;
+    }
     llvm::IRBuilder<> tmpB(&function->getEntryBlock(), function->getEntryBlock().begin());
-    llvm::AllocaInst* alloca = tmpB.CreateAlloca(llvm::Type::getDoubleTy(*context), nullptr, name);
-    int scope_level = static_cast<int>(scopes.size()) - 1;
-    scopes.back()[name] = Symbol{name, alloca, is_mutable, true, loc, scope_level};
+    return tmpB.CreateAlloca(type, nullptr, llvm::StringRef(name));
+}
+
+void CodeGen::releaseSlot(const Symbol& sym) {
+    if (!reuseSlots || !sym.owns_slot) return;
+    auto* slot = llvm::cast<llvm::AllocaInst>(sym.storage);
+    freeSlots[{slot->getFunction(), slot->getAllocatedType()}].push_back(slot);
+}
+
+llvm::StructType* CodeGen::getClosureType() {
+    auto* ptrTy = llvm::PointerType::getUnqual(*context);
+    return llvm::StructType::get(*context, {ptrTy, ptrTy, ptrTy});
+}
+
+llvm::AllocaInst* CodeGen::declareClosureVariable(std::string_view name, bool is_mutable,
+                                                  SourceLoc loc) {
+    auto* function = builder->GetInsertBlock()->getParent();
+    llvm::AllocaInst* alloca = acquireSlot(function, getClosureType(), name);
+    Symbol& sym = symbols.declare(name, Symbol{alloca, is_mutable, true, loc});
+    sym.is_closure_slot = true;
+    sym.owns_slot = true;
     return alloca;
 }
 
-llvm::AllocaInst* CodeGen::getVariable(const std::string& name) {
-    for (int i = static_cast<int>(scopes.size()) - 1; i >= 0; --i) {
-        auto it = scopes[i].find(name);
-    if (it != scopes[i].end()) return it->second.allocaInst;
+llvm::Value* CodeGen::emitVariableLoad(std::string_view name, std::string_view valueName) {
+    auto* sym = lookupNearestSymbol(name);
+    if (!sym) return nullptr;
+    llvm::StringRef label = valueName.empty() ? name : valueName;
+    if (sym->is_closure_slot) {
+        auto* bundleField = builder->CreateStructGEP(getClosureType(), sym->storage, 2, label + "_bundle_ptr");
+        auto* bundle = builder->CreateLoad(llvm::PointerType::getUnqual(*context), bundleField, label + "_bundle");
+        auto* bundleI64 = builder->CreatePtrToInt(bundle, llvm::Type::getInt64Ty(*context), label + "_i64");
+        return builder->CreateBitCast(bundleI64, llvm::Type::getDoubleTy(*context), label);
     }
-    return nullptr;
+    return builder->CreateLoad(llvm::Type::getDoubleTy(*context), sym->storage, label);
+}
+
+void CodeGen::bindVariable(std::string_view name, llvm::Value* storage, bool is_mutable,
+                           SourceLoc loc) {
+    symbols.declare(name, Symbol{storage, is_mutable, true, loc});
+}
+
+llvm::Value* CodeGen::getVariable(std::string_view name) {
+    auto* sym = symbols.lookup(name);
+    return sym ? sym->storage : nullptr;
 }
 
-void CodeGen::setVariable(const std::string& name, llvm::AllocaInst* alloca) {
-    int scope_level = static_cast<int>(scopes.size()) - 1;
-    scopes.back()[name] = Symbol{name, alloca, /*is_mutable=*/false, true,
-                                 SourceLocation{sourceFileName, 1, 1}, scope_level};
+void CodeGen::setVariable(std::string_view name, llvm::Value* storage) {
+    bindVariable(name, storage, /*is_mutable=*/false, SourceLoc{});
 }
 
 void CodeGen::enterScope() {
-    scopes.emplace_back();
+    symbols.enterScope();
 }
 
 void CodeGen::exitScope() {
-    if (!scopes.empty()) scopes.pop_back();
-    if (scopes.empty()) {
-        // Ensure there is always at least one scope to avoid edge cases
-        scopes.emplace_back();
-    }
+    // The global scope is never popped, only cleared
+    symbols.exitScope([this](const Symbol& sym) { releaseSlot(sym); });
 }
 
-bool CodeGen::canReassign(const std::string& name) const {
-    for (int i = static_cast<int>(scopes.size()) - 1; i >= 0; --i) {
-        auto it = scopes[i].find(name);
-        if (it != scopes[i].end()) return it->second.is_mutable;
-    }
-    return false;
+bool CodeGen::canReassign(std::string_view name) const {
+    auto* sym = symbols.lookup(name);
+    return sym && sym->is_mutable;
 }
 
-bool CodeGen::canShadow(const std::string& /*name*/) const {
+bool CodeGen::canShadow(std::string_view /*name*/) const {
     return true; // Language allows shadowing in inner scopes
 }
 
-const CodeGen::Symbol* CodeGen::lookupNearestSymbol(const std::string& name) const {
-    for (int i = static_cast<int>(scopes.size()) - 1; i >= 0; --i) {
-        auto it = scopes[i].find(name);
-        if (it != scopes[i].end()) return &it->second;
-    }
-    return nullptr;
+const CodeGen::Symbol* CodeGen::lookupNearestSymbol(std::string_view name) const {
+    return symbols.lookup(name);
 }
 
-const CodeGen::Symbol* CodeGen::lookupCurrentSymbol(const std::string& name) const {
-    if (scopes.empty()) return nullptr;
-    auto it = scopes.back().find(name);
-    if (it != scopes.back().end()) return &it->second;
-    return nullptr;
+const CodeGen::Symbol* CodeGen::lookupCurrentSymbol(std::string_view name) const {
+    return symbols.lookupCurrent(name);
 }
 
-bool CodeGen::hasCurrentSymbol(const std::string& name) const {
+bool CodeGen::hasCurrentSymbol(std::string_view name) const {
     return lookupCurrentSymbol(name) != nullptr;
 }
 
-bool CodeGen::isCurrentSymbolMutable(const std::string& name) const {
+bool CodeGen::isCurrentSymbolMutable(std::string_view name) const {
     auto* s = lookupCurrentSymbol(name);
     return s ? s->is_mutable : false;
 }
 
-llvm::AllocaInst* CodeGen::getCurrentAlloca(const std::string& name) const {
+llvm::Value* CodeGen::getCurrentAlloca(std::string_view name) const {
     auto* s = lookupCurrentSymbol(name);
-    return s ? s->allocaInst : nullptr;
+    return s ? s->storage : nullptr;
+}
+
+void CodeGen::setKnownFunction(std::string_view name, llvm::Function* fn, llvm::Value* env) {
+    auto* sym = symbols.lookupCurrent(name);
+    if (!sym || sym->is_mutable) return;
+    sym->knownFunction = fn;
+    sym->knownEnv = env;
 }
 
 llvm::Function* CodeGen::getPrintfDeclaration() {
@@ -140,25 +197,136 @@ llvm::Function* CodeGen::getPrintfDeclaration() {
     return printfFunc;
 }
 
-void CodeGen::pushMutCaptureSyncs(std::vector<MutCaptureSync> syncs) {
-    mutCaptureSyncStack.push_back(std::move(syncs));
+void CodeGen::printModule() {
+    module->print(llvm::outs(), nullptr);
 }
 
-void CodeGen::popMutCaptureSyncs() {
-    if (!mutCaptureSyncStack.empty()) mutCaptureSyncStack.pop_back();
+void CodeGen::setTargetCPU(const std::string& cpu, const std::string& features) {
+    if (targetMachine) {
+        throw std::runtime_error("Target CPU must be set before the target machine is created");
+    }
+    targetCPU = cpu == "native" ? llvm::sys::getHostCPUName().str() : cpu;
+    targetFeatures = features;
 }
 
-void CodeGen::emitMutCaptureSyncs() {
-    if (mutCaptureSyncStack.empty()) return;
-    for (const auto& s : mutCaptureSyncStack.back()) {
-        auto* cur = builder->CreateLoad(
-            llvm::Type::getDoubleTy(*context), s.localAlloca, "sync_val");
-        builder->CreateStore(cur, s.sharedPtr);
+llvm::TargetMachine* CodeGen::getTargetMachine() {
+    if (targetMachine) {
+        module->setTargetTriple(targetTriple);
+        module->setDataLayout(targetMachine->createDataLayout());
+        return targetMachine.get();
+    }
+
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+    std::string triple = llvm::sys::getDefaultTargetTriple();
+    std::string error;
+    const llvm::Target* target = llvm::TargetRegistry::lookupTarget(triple, error);
+    if (!target) {
+        throw std::runtime_error("Cannot find target for " + triple + ": " + error);
+    }
+    targetMachine.reset(target->createTargetMachine(
+        triple, targetCPU, targetFeatures, llvm::TargetOptions(), llvm::Reloc::PIC_));
+    if (!targetMachine) {
+        throw std::runtime_error("Cannot create target machine for " + triple);
     }
+    targetTriple = triple;
+    module->setTargetTriple(triple);
+    module->setDataLayout(targetMachine->createDataLayout());
+    return targetMachine.get();
+}
+
+std::unique_ptr<llvm::Module> CodeGen::swapModule(std::unique_ptr<llvm::Module> next) {
+    std::swap(module, next);
+    // Pooled slots belong to the old module's functions, which may be optimized away
+    freeSlots.clear();
+    if (targetMachine) getTargetMachine();
+    return next;
+}
+
+// Run the pipeline build() makes over module; tm supplies TTI so the vectorizers/unroller have
+// a cost model
+static void runPipeline(llvm::Module& module, llvm::TargetMachine* tm,
+                        const std::function<llvm::ModulePassManager(llvm::PassBuilder&)>& build) {
+    llvm::LoopAnalysisManager LAM;
+    llvm::FunctionAnalysisManager FAM;
+    llvm::CGSCCAnalysisManager CGAM;
+    llvm::ModuleAnalysisManager MAM;
+
+    llvm::PassBuilder PB(tm);
+    PB.registerModuleAnalyses(MAM);
+    PB.registerCGSCCAnalyses(CGAM);
+    PB.registerFunctionAnalyses(FAM);
+    PB.registerLoopAnalyses(LAM);
+    PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+    llvm::ModulePassManager MPM = build(PB);
+    MPM.run(module, MAM);
+}
+
+// AIDEV-NOTE: Standard new-PM setup mirroring clang -O<n>. -O1..-O3 get mem2reg, instcombine,
+// GVN and loop passes.
+void CodeGen::optimize(unsigned optLevel) {
+    if (optLevel > 3) {
+        throw std::runtime_error("Invalid optimization level: " + std::to_string(optLevel));
+    }
+    static const llvm::OptimizationLevel levels[] = {
+        llvm::OptimizationLevel::O0, llvm::OptimizationLevel::O1,
+        llvm::OptimizationLevel::O2, llvm::OptimizationLevel::O3};
+
+    runPipeline(*module, getTargetMachine(), [&](llvm::PassBuilder& PB) {
+        return optLevel == 0 ? PB.buildO0DefaultPipeline(levels[0])
+                             : PB.buildPerModuleDefaultPipeline(levels[optLevel]);
+    });
+}
+
+// AIDEV-NOTE: Post-link pass for separately optimized modules (module_compiler.h). The LTO
+// pipeline inlines across the former module boundaries (init functions, exported fns), folds
+// the internalized export globals, and re-runs the loop passes so inlined calls in hot loops get
+// unrolled and vectorized as they would have been in a single-module build.
+void CodeGen::optimizeLinked(unsigned optLevel) {
+    if (optLevel == 0 || optLevel > 3) {
+        throw std::runtime_error("Invalid post-link optimization level: " + std::to_string(optLevel));
+    }
+    static const llvm::OptimizationLevel levels[] = {
+        llvm::OptimizationLevel::O1, llvm::OptimizationLevel::O2, llvm::OptimizationLevel::O3};
+
+    runPipeline(*module, getTargetMachine(), [&](llvm::PassBuilder& PB) {
+        auto MPM = PB.buildLTODefaultPipeline(levels[optLevel - 1], /*ExportSummary=*/nullptr);
+        // Export globals whose loads were all inlined away are only stored to by now
+        MPM.addPass(llvm::GlobalOptPass());
+        MPM.addPass(llvm::GlobalDCEPass());
+        return MPM;
+    });
 }
 
-void CodeGen::printModule() {
-    module->print(llvm::outs(), nullptr);
+void CodeGen::emitFile(const std::string& filename, bool assembly) {
+    llvm::TargetMachine* tm = getTargetMachine();
+
+    std::error_code ec;
+    llvm::raw_fd_ostream dest(filename, ec, llvm::sys::fs::OF_None);
+    if (ec) {
+        throw std::runtime_error("Cannot open output file " + filename + ": " + ec.message());
+    }
+
+#if LLVM_VERSION_MAJOR >= 18
+    auto fileType = assembly ? llvm::CodeGenFileType::AssemblyFile : llvm::CodeGenFileType::ObjectFile;
+#else
+    auto fileType = assembly ? llvm::CGFT_AssemblyFile : llvm::CGFT_ObjectFile;
+#endif
+    llvm::legacy::PassManager pass;
+    if (tm->addPassesToEmitFile(pass, dest, nullptr, fileType)) {
+        throw std::runtime_error("Target machine cannot emit a file of this type");
+    }
+    pass.run(*module);
+    dest.flush();
+}
+
+void CodeGen::writeObjectFile(const std::string& filename) {
+    emitFile(filename, /*assembly=*/false);
+}
+
+void CodeGen::writeAssemblyFile(const std::string& filename) {
+    emitFile(filename, /*assembly=*/true);
 }
 
 void CodeGen::setSourceFileName(const std::string& filename) {
@@ -173,12 +341,12 @@ llvm::Value* NumberExprAST::codegen() {
 }
 
 llvm::Value* VariableExprAST::codegen() {
-    llvm::AllocaInst* alloca = codeGenInstance->getVariable(name);
-    if (!alloca) {
+    llvm::Value* value = codeGenInstance->emitVariableLoad(name);
+    if (!value) {
     // Propagate as ParseError with identifier location for better diagnostics
-    throw ParseError("cannot find value '" + name + "' in this scope", name_location);
+    throw ParseError("cannot find value '" + std::string(name) + "' in this scope", name_location);
     }
-    return codeGenInstance->getBuilder().CreateLoad(llvm::Type::getDoubleTy(codeGenInstance->getContext()), alloca, name);
+    return value;
 }
 
 llvm::Value* StringLiteralAST::codegen() {
@@ -241,33 +409,23 @@ llvm::Value* BinaryExprAST::codegen() {
 }
 
 llvm::Value* AssignmentExprAST::codegen() {
-    // Detect self-referential function literal (recursive function):
-    // if the RHS is a fn literal that references the LHS variable in its body,
-    // set pendingSelfRefVar so FunctionLiteralAST::codegen() can build a self-bundle.
-    bool isSelfRef = false;
-    if (!is_mutable_declaration) {
-        if (auto* fnLit = dynamic_cast<FunctionLiteralAST*>(value.get())) {
-            if (functionBodyReferencesVar(fnLit, varName)) {
-                isSelfRef = true;
-                codeGenInstance->setPendingSelfRefVar(varName);
-            }
-        }
-    }
-
-    llvm::Value* val = value->codegen();
-
-    if (isSelfRef) codeGenInstance->clearPendingSelfRefVar();
+    // Function-typed values are bound as { fn, env, bundle } closure structs
+    const bool closureTyped = value->getStaticType() == StaticType::Function;
+    llvm::Value* val = closureTyped ? codegenClosureValue(value) : value->codegen();
 
     if (!val) return nullptr;
 
     // Determine how to handle binding based on mutability and scope
     const bool isMutDecl = is_mutable_declaration;
-    llvm::AllocaInst* targetAlloca = nullptr;
+    llvm::Value* targetAlloca = nullptr;
+    auto declare = [&](bool is_mutable) -> llvm::Value* {
+        return closureTyped ? codeGenInstance->declareClosureVariable(varName, is_mutable, name_location)
+                            : codeGenInstance->declareVariable(varName, is_mutable, name_location);
+    };
 
     if (isMutDecl) {
         // Explicit mutable declaration: always create a new alloca in current scope
-        targetAlloca = codeGenInstance->declareVariable(varName, /*is_mutable=*/true,
-                        SourceLocation{codeGenInstance->getModule().getSourceFileName(), 1, 1});
+        targetAlloca = declare(/*is_mutable=*/true);
     } else {
         // No 'mut'
         if (codeGenInstance->hasCurrentSymbol(varName) && codeGenInstance->isCurrentSymbolMutable(varName)) {
@@ -275,21 +433,42 @@ llvm::Value* AssignmentExprAST::codegen() {
             targetAlloca = codeGenInstance->getCurrentAlloca(varName);
         } else if (codeGenInstance->hasCurrentSymbol(varName)) {
             // Shadowing: new immutable binding (redeclare in current scope)
-            targetAlloca = codeGenInstance->declareVariable(varName, /*is_mutable=*/false,
-                            SourceLocation{codeGenInstance->getModule().getSourceFileName(), 1, 1});
+            targetAlloca = declare(/*is_mutable=*/false);
         } else {
             // Not present in current scope. If outer mutable exists, mutate it; otherwise, shadow with new immutable.
             if (codeGenInstance->hasNearestSymbol(varName) && codeGenInstance->isNearestSymbolMutable(varName)) {
                 targetAlloca = codeGenInstance->getNearestAlloca(varName);
             } else {
-                targetAlloca = codeGenInstance->declareVariable(varName, /*is_mutable=*/false,
-                                SourceLocation{codeGenInstance->getModule().getSourceFileName(), 1, 1});
+                targetAlloca = declare(/*is_mutable=*/false);
             }
         }
     }
 
+    // A mutated variable keeps its representation; convert if the value's differs
+    const bool targetIsSlot = codeGenInstance->isClosureSlot(varName);
+    if (closureTyped && !targetIsSlot) val = boxClosure(val);
+    else if (!closureTyped && targetIsSlot) val = unboxClosure(val);
     codeGenInstance->getBuilder().CreateStore(val, targetAlloca);
-    return val;
+
+    // Record statically-known function bindings so calls through this name can be direct.
+    // Only fresh immutable bindings qualify; mutations of mutable variables never do.
+    if (!isMutDecl && !codeGenInstance->isCurrentSymbolMutable(varName) &&
+        codeGenInstance->getCurrentAlloca(varName) == targetAlloca) {
+        if (auto* fnLit = dyn_cast<FunctionLiteralAST>(value)) {
+            if (auto* fn = fnLit->getGeneratedFunction()) {
+                llvm::Value* env = fnLit->hasEnv()
+                    ? fnLit->getEnvValue()
+                    : llvm::ConstantPointerNull::get(llvm::PointerType::getUnqual(codeGenInstance->getContext()));
+                codeGenInstance->setKnownFunction(varName, fn, env);
+            }
+        } else if (auto* src = dyn_cast<VariableExprAST>(value)) {
+            // Alias of a known function (e.g. import { f as g }) shares the same bundle
+            if (auto* fn = codeGenInstance->getNearestKnownFunction(src->getName())) {
+                codeGenInstance->setKnownFunction(varName, fn, codeGenInstance->getNearestKnownEnv(src->getName()));
+            }
+        }
+    }
+    return targetIsSlot ? boxClosure(val) : val;
 }
 
 llvm::Value* PrintStmtAST::codegen() {
@@ -300,11 +479,11 @@ llvm::Value* PrintStmtAST::codegen() {
     if (!formatVal) return nullptr;
     
     // Check if we have a format string with arguments
-    StringLiteralAST* formatString = dynamic_cast<StringLiteralAST*>(formatExpr.get());
+    StringLiteralAST* formatString = dyn_cast<StringLiteralAST>(formatExpr);
     
     if (formatString && !args.empty()) {
         // This is a format string with arguments - parse the format string
-        std::string formatStr = formatString->getValue();
+        std::string_view formatStr = formatString->getValue();
         std::vector<llvm::Value*> printfArgs;
         
         // Start with the format string itself
@@ -338,7 +517,7 @@ llvm::Value* PrintStmtAST::codegen() {
                             processedFormat += "%d";
                         } else if (formatStr[i + 1] == 's') {
                             // String argument - check if it's a string literal
-                            StringLiteralAST* stringArg = dynamic_cast<StringLiteralAST*>(args[argIndex].get());
+                            StringLiteralAST* stringArg = dyn_cast<StringLiteralAST>(args[argIndex]);
                             if (!stringArg) {
                                 throw std::runtime_error("%s format specifier requires string literal argument");
                             }
@@ -397,7 +576,7 @@ llvm::Value* PrintStmtAST::codegen() {
         
     } else if (formatString) {
         // String literal without arguments - process %% and output with %s (no automatic newline)
-        std::string str = formatString->getValue();
+        std::string_view str = formatString->getValue();
         
         // Process %% -> % in string literals
         std::string processedStr;
@@ -505,6 +684,14 @@ llvm::Value* WhileStmtAST::codegen() {
     llvm::BasicBlock* loopBB = llvm::BasicBlock::Create(codeGenInstance->getContext(), "loop");
     llvm::BasicBlock* afterBB = llvm::BasicBlock::Create(codeGenInstance->getContext(), "afterloop");
     
+    // AIDEV-NOTE: Closures that can't outlive an iteration are freed at its end by
+    // rewinding the closure arena to where it stood before the loop.
+    llvm::Value* arenaMark = nullptr;
+    if (loopClosuresAreIterationLocal(condition, body, *codeGenInstance)) {
+        arenaMark = codeGenInstance->getBuilder().CreateCall(
+            getArenaMark(*codeGenInstance), {}, "arena_mark");
+    }
+
     // Jump to condition block
     codeGenInstance->getBuilder().CreateBr(condBB);
     
@@ -529,6 +716,10 @@ llvm::Value* WhileStmtAST::codegen() {
     llvm::Value* bodyV = body->codegen();
     if (!bodyV) return nullptr;
     
+    if (arenaMark) {
+        codeGenInstance->getBuilder().CreateCall(getArenaRelease(*codeGenInstance), {arenaMark});
+    }
+
     // Jump back to condition
     codeGenInstance->getBuilder().CreateBr(condBB);
     
@@ -566,6 +757,7 @@ llvm::Value* ExportStmtAST::codegen() {
 
 llvm::Value* ProgramAST::codegen() {
     llvm::Value* lastValue = nullptr;
+    markNonEscapingClosures(this);
     
     for (const auto& exp : exports) {
         lastValue = exp->codegen();
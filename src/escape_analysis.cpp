@@ -0,0 +1,195 @@
+#include "escape_analysis.h"
+#include "ast_visitor.h"
+#include <map>
+#include <set>
+#include <utility>
+#include <string_view>
+#include <vector>
+
+namespace {
+struct Binding {
+    bool is_mutable = false;
+    int fnDepth = 0;                          // nesting depth of the fn literal that owns it
+    FunctionLiteralAST* literal = nullptr;    // set for immutable bindings to a fn literal
+    FunctionLiteralAST* paramOf = nullptr;    // set for parameters
+    int paramIndex = -1;
+};
+
+// Mirrors CodeGen's scoping (blocks and fn bodies open scopes; assignments mutate the nearest
+// mutable binding or declare) so a callee name resolves to the binding codegen will use.
+// Value uses conservatively escape every visible binding of the name. Node kinds without a
+// visit hook below are only walked through, so anything they contain is still seen.
+class EscapeScan : public RecursiveASTVisitor<EscapeScan> {
+public:
+    void run(ProgramAST* program) {
+        pushScope();
+        traverse(program);
+        // Exported values are copied out of the module once its code has run (module_compiler.h)
+        for (const auto& exp : program->getExports()) {
+            if (auto* assign = dyn_cast<AssignmentExprAST>(exp->getDeclaration())) {
+                escapeAllVisible(assign->getVarName());
+            }
+            for (const auto& sym : exp->getSymbols()) escapeAllVisible(sym.name);
+        }
+        popScope();
+
+        for (auto* lit : candidates) {
+            if (!escaped.count(lit)) lit->setNonEscaping(true);
+        }
+    }
+
+    bool visitVariable(VariableExprAST* var) {
+        escapeAllVisible(var->getName());
+        return true;
+    }
+
+    bool visitAssignment(AssignmentExprAST* assign) {
+        std::string_view name = assign->getVarName();
+        auto* fnLit = dyn_cast<FunctionLiteralAST>(assign->getValue());
+
+        // Same rule as AssignmentExprAST::codegen: without 'mut', a nearest mutable binding is
+        // mutated and anything else is shadowed by a new immutable binding
+        const Binding* nearest = lookupNearest(name);
+        bool mutatesExisting = !assign->isMutableDeclaration() && nearest && nearest->is_mutable;
+
+        // Storing into a mutable variable (declaration or mutation) lets the value flow anywhere
+        if (!fnLit || assign->isMutableDeclaration() || mutatesExisting) {
+            traverse(assign->getValue());
+            if (!mutatesExisting) declare(name, assign->isMutableDeclaration());
+            return false;
+        }
+
+        // Fresh immutable binding of a literal; declared first so a recursive body resolves to it
+        candidates.insert(fnLit);
+        declare(name, /*is_mutable=*/false, fnLit);
+        scanLiteralBody(fnLit);
+        return false;
+    }
+
+    // A literal used as a plain value (argument, return value, ...) escapes
+    bool visitFunctionLiteral(FunctionLiteralAST* fnLit) {
+        scanLiteralBody(fnLit);
+        return false;
+    }
+
+    bool visitFunctionCall(FunctionCallAST* call) {
+        const FunctionLiteralAST* target = resolveCallee(call->getCallee());
+        if (auto* calleeVar = dyn_cast<VariableExprAST>(call->getCallee())) {
+            noteDirectCall(calleeVar->getName());
+        } else if (auto* calleeLit = dyn_cast<FunctionLiteralAST>(call->getCallee())) {
+            candidates.insert(calleeLit);
+            scanLiteralBody(calleeLit);
+        } else {
+            traverse(call->getCallee());
+        }
+        for (size_t i = 0; i < call->getArgs().size(); ++i) {
+            scanArgument(target, static_cast<int>(i), call->getArgs()[i]);
+        }
+        return false;
+    }
+
+    bool visitBlock(BlockAST* block) {
+        pushScope();
+        traverseChildren(block);
+        popScope();
+        return false;
+    }
+
+private:
+    std::vector<std::map<std::string_view, Binding>> scopes;
+    std::set<FunctionLiteralAST*> candidates;
+    std::set<FunctionLiteralAST*> escaped;
+    std::set<std::pair<const FunctionLiteralAST*, int>> escapedParams;  // params whose argument may escape
+    std::vector<FunctionLiteralAST*> literalStack;  // literals whose bodies are being visited
+    int fnDepth = 0;
+
+    void pushScope() { scopes.emplace_back(); }
+    void popScope() { scopes.pop_back(); }
+
+    void declare(std::string_view name, bool is_mutable, FunctionLiteralAST* literal = nullptr) {
+        scopes.back()[name] = Binding{is_mutable, fnDepth, literal};
+    }
+
+    const Binding* lookupNearest(std::string_view name) const {
+        for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope) {
+            auto it = scope->find(name);
+            if (it != scope->end()) return &it->second;
+        }
+        return nullptr;
+    }
+
+    void escapeBinding(const Binding& b) {
+        if (b.literal) escaped.insert(b.literal);
+        if (b.paramOf) escapedParams.insert({b.paramOf, b.paramIndex});
+    }
+
+    // A value use of name may reach any visible binding of that name
+    void escapeAllVisible(std::string_view name) {
+        for (const auto& scope : scopes) {
+            auto it = scope.find(name);
+            if (it != scope.end()) escapeBinding(it->second);
+        }
+    }
+
+    // A direct call is fine from the function that created the closure and from the closure's
+    // own body (recursion); any other nested literal would capture the closure value instead.
+    void noteDirectCall(std::string_view name) {
+        for (const auto& scope : scopes) {
+            auto it = scope.find(name);
+            if (it == scope.end() || it->second.fnDepth == fnDepth) continue;
+            bool selfCall = it->second.literal && it->second.fnDepth + 1 == fnDepth &&
+                            literalStack.back() == it->second.literal;
+            if (!selfCall) escapeBinding(it->second);
+        }
+    }
+
+    // The literal a direct call from here will run, if its parameter summary is complete
+    const FunctionLiteralAST* resolveCallee(ExprAST* callee) const {
+        auto* var = dyn_cast<VariableExprAST>(callee);
+        if (!var) return nullptr;
+        const Binding* b = lookupNearest(var->getName());
+        if (!b || !b->literal || b->fnDepth != fnDepth) return nullptr;
+        for (auto* lit : literalStack) {
+            if (lit == b->literal) return nullptr;  // body still being scanned
+        }
+        return b->literal;
+    }
+
+    // An argument bound to a parameter that is only ever called doesn't escape with the call
+    void scanArgument(const FunctionLiteralAST* callee, int index, ExprAST* arg) {
+        bool paramStaysLocal = callee && index < static_cast<int>(callee->getParams().size()) &&
+            !escapedParams.count({callee, index});
+        if (paramStaysLocal) {
+            if (isa<VariableExprAST>(arg)) return;
+            if (auto* fnLit = dyn_cast<FunctionLiteralAST>(arg)) {
+                candidates.insert(fnLit);
+                scanLiteralBody(fnLit);
+                return;
+            }
+        }
+        traverse(arg);
+    }
+
+    void scanLiteralBody(FunctionLiteralAST* fnLit) {
+        ++fnDepth;
+        literalStack.push_back(fnLit);
+        pushScope();
+        for (size_t i = 0; i < fnLit->getParams().size(); ++i) {
+            const auto& p = fnLit->getParams()[i];
+            declare(p.name, p.is_mutable);
+            scopes.back()[p.name].paramOf = fnLit;
+            scopes.back()[p.name].paramIndex = static_cast<int>(i);
+        }
+        for (const auto& c : fnLit->getCaptures()) declare(c.name, /*is_mutable=*/true);
+        traverse(fnLit->getBody());
+        popScope();
+        literalStack.pop_back();
+        --fnDepth;
+    }
+};
+} // namespace
+
+void markNonEscapingClosures(ProgramAST* program) {
+    if (!program) return;
+    EscapeScan().run(program);
+}
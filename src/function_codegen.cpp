@@ -1,11 +1,13 @@
 #include "function_ast.h"
 #include "codegen.h"
+#include "closure_runtime.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/Type.h"
 #include "llvm/IR/Constants.h"
-#include <set>
+#include "llvm/IR/GlobalVariable.h"
 #include <string>
+#include <string_view>
 #include <vector>
 
 // Forward declaration (defined in codegen.cpp)
@@ -14,163 +16,62 @@ CodeGen& getCodeGen();
 // Counter for generating unique function names
 static int fnCounter = 0;
 
-// Declare (or get) malloc function in the module
-static llvm::Function* getMalloc(CodeGen& cg) {
-    if (auto* fn = cg.getModule().getFunction("malloc")) return fn;
-    auto* mallocTy = llvm::FunctionType::get(
-        llvm::PointerType::getUnqual(cg.getContext()),
-        {llvm::Type::getInt64Ty(cg.getContext())},
-        /*isVarArg=*/false);
-    return llvm::Function::Create(
-        mallocTy, llvm::Function::ExternalLinkage, "malloc", cg.getModule());
-}
-
-// Recursively collect variable reads and local declaration names from an AST node.
-// Does NOT recurse into nested FunctionLiteralAST (separate scope).
-static void collectVarRefsAndDecls(ASTNode* node,
-                                    std::vector<std::string>& refs,
-                                    std::vector<std::string>& decls) {
-    if (!node) return;
-    if (auto* v = dynamic_cast<VariableExprAST*>(node)) {
-        refs.push_back(v->getName());
-        return;
-    }
-    if (dynamic_cast<NumberExprAST*>(node) || dynamic_cast<StringLiteralAST*>(node)) {
-        return;
-    }
-    if (auto* assign = dynamic_cast<AssignmentExprAST*>(node)) {
-        decls.push_back(assign->getVarName());
-        collectVarRefsAndDecls(assign->getValue(), refs, decls);
-        return;
-    }
-    if (auto* bin = dynamic_cast<BinaryExprAST*>(node)) {
-        collectVarRefsAndDecls(bin->getLHS(), refs, decls);
-        collectVarRefsAndDecls(bin->getRHS(), refs, decls);
-        return;
-    }
-    if (auto* un = dynamic_cast<UnaryExprAST*>(node)) {
-        collectVarRefsAndDecls(un->getOperand(), refs, decls);
-        return;
-    }
-    if (auto* call = dynamic_cast<FunctionCallAST*>(node)) {
-        collectVarRefsAndDecls(call->getCallee(), refs, decls);
-        for (const auto& arg : call->getArgs())
-            collectVarRefsAndDecls(arg.get(), refs, decls);
-        return;
-    }
-    if (dynamic_cast<FunctionLiteralAST*>(node)) {
-        return;  // nested fn literal — do not recurse into it
-    }
-    if (auto* block = dynamic_cast<BlockAST*>(node)) {
-        for (const auto& stmt : block->getStatements())
-            collectVarRefsAndDecls(stmt.get(), refs, decls);
-        return;
-    }
-    if (auto* print = dynamic_cast<PrintStmtAST*>(node)) {
-        collectVarRefsAndDecls(print->getFormatExpr(), refs, decls);
-        for (const auto& arg : print->getArgs())
-            collectVarRefsAndDecls(arg.get(), refs, decls);
-        return;
-    }
-    if (auto* ret = dynamic_cast<ReturnStmtAST*>(node)) {
-        if (ret->hasValue())
-            collectVarRefsAndDecls(ret->getValue(), refs, decls);
-        return;
-    }
-    if (auto* ifs = dynamic_cast<IfStmtAST*>(node)) {
-        collectVarRefsAndDecls(ifs->getCondition(), refs, decls);
-        collectVarRefsAndDecls(ifs->getThenStmt(), refs, decls);
-        collectVarRefsAndDecls(ifs->getElseStmt(), refs, decls);
-        return;
-    }
-    if (auto* wh = dynamic_cast<WhileStmtAST*>(node)) {
-        collectVarRefsAndDecls(wh->getCondition(), refs, decls);
-        collectVarRefsAndDecls(wh->getBody(), refs, decls);
-        return;
-    }
-}
-
-// Public utility: returns true if varName is a free variable reference in fn's direct body.
-bool functionBodyReferencesVar(const FunctionLiteralAST* fn, const std::string& varName) {
-    std::vector<std::string> refs, decls;
-    collectVarRefsAndDecls(fn->getBody(), refs, decls);
-    std::set<std::string> excluded;
-    for (const auto& p : fn->getParams()) excluded.insert(p.name);
-    for (const auto& c : fn->getCaptures()) excluded.insert(c.name);
-    for (const auto& d : decls) excluded.insert(d);
-    for (const auto& r : refs) {
-        if (r == varName && !excluded.count(r)) return true;
-    }
-    return false;
-}
-
-// Compute the ordered list of immutable free variables for a function body.
-// Free vars: referenced in body, NOT in params, NOT in explicit mut() captures,
-// NOT locally declared in body, AND exist in the current outer CodeGen scope.
-static std::vector<std::string> computeFreeVars(
-    ASTNode* body,
-    const std::vector<FunctionParameter>& params,
-    const std::vector<CapturedVariable>& captures,
-    CodeGen& cg)
-{
-    std::vector<std::string> refs, decls;
-    collectVarRefsAndDecls(body, refs, decls);
-
-    std::set<std::string> excluded;
-    for (const auto& p : params) excluded.insert(p.name);
-    for (const auto& c : captures) excluded.insert(c.name);
-    for (const auto& d : decls) excluded.insert(d);
-
-    std::vector<std::string> result;
-    std::set<std::string> seen;
-    for (const auto& r : refs) {
-        if (!excluded.count(r) && seen.insert(r).second && cg.getVariable(r)) {
-            result.push_back(r);
-        }
-    }
-    return result;
+// Stack slot in the entry block of the function currently being emitted
+static llvm::AllocaInst* createEntryBlockAlloca(CodeGen& cg, llvm::Type* ty, const std::string& name) {
+    auto* fn = cg.getBuilder().GetInsertBlock()->getParent();
+    llvm::IRBuilder<> tmpB(&fn->getEntryBlock(), fn->getEntryBlock().begin());
+    auto* alloca = tmpB.CreateAlloca(ty, nullptr, name);
+    alloca->setAlignment(llvm::Align(8));
+    return alloca;
 }
 
 // AIDEV-NOTE: Closure bundle encoding:
 // Each function value is a double encoding a ptr to a 2-element i64 bundle:
 //   bundle[0] = LLVM function pointer (as i64)
 //   bundle[1] = env pointer (as i64, 0 = no captures)
-// The env is a heap-allocated array with N_free doubles followed by N_mut i64 ptr values.
+// The env is an arena-allocated array with N_free doubles followed by N_mut i64 ptr values.
 //   env[0..N_free-1]       = immutable free var values (double)
 //   env[N_free..N_free+N_mut-1] = mutable capture heap ptrs (i64/ptr, 8 bytes each)
+//   env[N_free+N_mut]      = the closure's own bundle ptr (recursive closures only)
 // All generated LLVM functions take an extra 'ptr env' as their LAST parameter.
 // At call site, the bundle is decoded to recover fn_ptr and env_ptr.
 //
-// Mutable captures: each mutable var gets a separate malloc(8) heap double shared
-// between the outer scope (initialized once at closure creation) and the closure
-// (reads/writes go through the heap ptr). State persists across closure calls.
-// The sync stack in CodeGen tracks {local_alloca, shared_heap_ptr} pairs so that
-// ReturnStmtAST::codegen() and block fallthrough can sync local state to heap before ret.
+// Env, bundle and capture cells all come from the closure arena (closure_runtime.h), or
+// from entry-block allocas of the creating function when the closure is non-escaping
+// (escape_analysis.h).
+//
+// Mutable captures: each mutable var gets a separate 8-byte cell, initialized from the
+// outer variable once at closure creation. Inside the closure the name is bound directly
+// to the cell (CodeGen::bindVariable), so every read/write goes to shared memory and the
+// state persists across closure calls with no copy-in/copy-out.
 llvm::Value* FunctionLiteralAST::codegen() {
     auto& cg = getCodeGen();
 
-    // Compute immutable free variables while still in the outer scope
-    auto freeVars = computeFreeVars(body.get(), params, captures, cg);
-
-    // Remove self-referential variable from freeVars: it won't be snapshotted (it's
-    // not in scope yet); instead a self-bundle will be reconstructed inside the body.
-    const std::string& selfRefVar = cg.getPendingSelfRefVar();
-    if (!selfRefVar.empty()) {
-        auto it = std::find(freeVars.begin(), freeVars.end(), selfRefVar);
-        if (it != freeVars.end()) freeVars.erase(it);
+    // Immutable captures: the resolved free vars bound in the outer scope. The self name
+    // is not bound yet and isn't snapshotted; the body recovers its own bundle (see below).
+    const std::string_view selfRefVar = self_name;
+    std::vector<std::string_view> freeVars;
+    for (auto name : free_vars) {
+        if (name != selfRefVar && cg.getVariable(name)) freeVars.push_back(name);
     }
 
     int N_free = static_cast<int>(freeVars.size());
     int N_mut  = static_cast<int>(captures.size());
+    // A recursive closure with captures stores its own bundle in one extra env slot
+    bool hasSelfSlot = !selfRefVar.empty() && N_free + N_mut > 0;
 
-    // Snapshot current values of immutable free variables from the outer scope
+    // Snapshot current values of immutable free variables from the outer scope.
+    // Known-function facts travel with the capture; only a constant env stays valid inside.
     std::vector<llvm::Value*> capturedValues;
+    std::vector<llvm::Function*> capturedKnownFns;
+    std::vector<llvm::Value*> capturedKnownEnvs;
     capturedValues.reserve(N_free);
     for (const auto& varName : freeVars) {
-        auto* alloca = cg.getVariable(varName);
-        auto* val = cg.getBuilder().CreateLoad(
-            llvm::Type::getDoubleTy(cg.getContext()), alloca, varName + "_snap");
+        auto* val = cg.emitVariableLoad(varName, std::string(varName) + "_snap");
         capturedValues.push_back(val);
+        llvm::Value* knownEnv = cg.getNearestKnownEnv(varName);
+        capturedKnownFns.push_back(cg.getNearestKnownFunction(varName));
+        capturedKnownEnvs.push_back(knownEnv && llvm::isa<llvm::Constant>(knownEnv) ? knownEnv : nullptr);
     }
 
     // Allocate heap doubles for mutable captures in the outer scope.
@@ -178,13 +79,16 @@ llvm::Value* FunctionLiteralAST::codegen() {
     // shared storage between the outer scope and all future closure calls.
     std::vector<llvm::Value*> mutCapturedPtrs;
     mutCapturedPtrs.reserve(N_mut);
-    auto* mallocFn = getMalloc(cg);
+    auto* allocFn = getArenaAlloc(cg);
     for (const auto& cap : captures) {
-        auto* outerAlloca = cg.getVariable(cap.name);
-        auto* outerVal = cg.getBuilder().CreateLoad(
-            llvm::Type::getDoubleTy(cg.getContext()), outerAlloca, cap.name + "_outer");
-        auto* heapSize = llvm::ConstantInt::get(llvm::Type::getInt64Ty(cg.getContext()), 8);
-        auto* heapMem = cg.getBuilder().CreateCall(mallocFn, {heapSize}, cap.name + "_mut_heap");
+        auto* outerVal = cg.emitVariableLoad(cap.name, std::string(cap.name) + "_outer");
+        llvm::Value* heapMem;
+        if (non_escaping) {
+            heapMem = createEntryBlockAlloca(cg, llvm::Type::getDoubleTy(cg.getContext()), std::string(cap.name) + "_mut_cell");
+        } else {
+            auto* heapSize = llvm::ConstantInt::get(llvm::Type::getInt64Ty(cg.getContext()), 8);
+            heapMem = cg.getBuilder().CreateCall(allocFn, {heapSize}, std::string(cap.name) + "_mut_heap");
+        }
         cg.getBuilder().CreateStore(outerVal, heapMem);
         mutCapturedPtrs.push_back(heapMem);
     }
@@ -245,84 +149,86 @@ llvm::Value* FunctionLiteralAST::codegen() {
         for (int i = 0; i < N_free; ++i) {
             auto* elemPtr = cg.getBuilder().CreateConstGEP1_64(
                 llvm::Type::getDoubleTy(cg.getContext()), envArg, i,
-                freeVars[i] + "_env_ptr");
+                std::string(freeVars[i]) + "_env_ptr");
             auto* capVal = cg.getBuilder().CreateLoad(
-                llvm::Type::getDoubleTy(cg.getContext()), elemPtr, freeVars[i] + "_cap");
+                llvm::Type::getDoubleTy(cg.getContext()), elemPtr, std::string(freeVars[i]) + "_cap");
             // Declare a local alloca with the same name, shadowing the outer scope
-            auto* capAlloca = cg.declareVariable(freeVars[i], /*is_mutable=*/false, SourceLocation{});
+            auto* capAlloca = cg.declareVariable(freeVars[i], /*is_mutable=*/false, SourceLoc{});
             cg.getBuilder().CreateStore(capVal, capAlloca);
+            if (capturedKnownFns[i]) {
+                cg.setKnownFunction(freeVars[i], capturedKnownFns[i], capturedKnownEnvs[i]);
+            }
         }
     }
 
-    // Load mutable capture heap ptrs from env, set up local mutable allocas,
-    // and build the sync list for copy-back on return.
-    std::vector<CodeGen::MutCaptureSync> syncList;
+    // Bind mutable capture names straight to their cells (pointers loaded from env)
     if (N_mut > 0 && envArg) {
-        syncList.reserve(N_mut);
         for (int j = 0; j < N_mut; ++j) {
             const auto& cap = captures[j];
             // env[N_free + j] stores the heap ptr as i64 (same 8-byte slot size as double)
             auto* i64Slot = cg.getBuilder().CreateConstGEP1_64(
                 llvm::Type::getInt64Ty(cg.getContext()), envArg, N_free + j,
-                cap.name + "_heap_slot");
+                std::string(cap.name) + "_heap_slot");
             auto* heapPtrI64 = cg.getBuilder().CreateLoad(
-                llvm::Type::getInt64Ty(cg.getContext()), i64Slot, cap.name + "_heap_i64");
+                llvm::Type::getInt64Ty(cg.getContext()), i64Slot, std::string(cap.name) + "_heap_i64");
             auto* heapPtr = cg.getBuilder().CreateIntToPtr(
-                heapPtrI64, llvm::PointerType::getUnqual(cg.getContext()), cap.name + "_heap_ptr");
-            // Load current value from heap into a local mutable alloca
-            auto* curVal = cg.getBuilder().CreateLoad(
-                llvm::Type::getDoubleTy(cg.getContext()), heapPtr, cap.name + "_cur");
-            auto* localAlloca = cg.declareVariable(cap.name, /*is_mutable=*/true, cap.location);
-            cg.getBuilder().CreateStore(curVal, localAlloca);
-            syncList.push_back({localAlloca, heapPtr});
+                heapPtrI64, llvm::PointerType::getUnqual(cg.getContext()), std::string(cap.name) + "_heap_ptr");
+            cg.bindVariable(cap.name, heapPtr, /*is_mutable=*/true, cap.location);
         }
     }
-    // Always push (even empty) so ReturnStmtAST syncs the correct function's captures
-    cg.pushMutCaptureSyncs(std::move(syncList));
 
     // AIDEV-NOTE: Self-referential (recursive) function support.
-    // If this function literal is being assigned to variable selfRefVar, we reconstruct
-    // the closure bundle for that variable inside the inner function body. This lets the
-    // body call itself by name without the outer variable having existed at closure creation
-    // time. The self-bundle is: {ptrtoint(func), ptrtoint(envArg)} — same fn_ptr, same env.
-    // Each recursive call gets its own self-bundle allocation at runtime (via malloc).
+    // If this function literal is being assigned to variable selfRefVar, the body needs a
+    // value for that name without the outer variable existing at closure creation time.
+    // Nothing is allocated per call:
+    //   - no captures: the bundle is a private constant global {func, null}, also used as
+    //     the closure value itself, so it is shared by every frame;
+    //   - with captures: the closure bundle is written into env[N_free + N_mut] when it is
+    //     built, and the body just loads it back.
+    // Recursive calls by name are direct calls anyway; the bundle only matters when the
+    // function passes itself around as a value.
+    llvm::GlobalVariable* selfBundleGlobal = nullptr;
     if (!selfRefVar.empty()) {
-        auto* selfFnPtrI64 = cg.getBuilder().CreatePtrToInt(
-            func, llvm::Type::getInt64Ty(cg.getContext()), "self_fn_i64");
-        auto* selfEnvPtrI64 = envArg
-            ? cg.getBuilder().CreatePtrToInt(
-                  envArg, llvm::Type::getInt64Ty(cg.getContext()), "self_env_i64")
-            : llvm::ConstantInt::get(llvm::Type::getInt64Ty(cg.getContext()), 0);
-
-        auto* selfBundleMem = cg.getBuilder().CreateCall(
-            mallocFn,
-            {llvm::ConstantInt::get(llvm::Type::getInt64Ty(cg.getContext()), 16)},
-            "self_bundle");
-        cg.getBuilder().CreateStore(selfFnPtrI64, selfBundleMem);
-        auto* selfSlot1 = cg.getBuilder().CreateConstGEP1_64(
-            llvm::Type::getInt64Ty(cg.getContext()), selfBundleMem, 1, "self_bundle_slot1");
-        cg.getBuilder().CreateStore(selfEnvPtrI64, selfSlot1);
-
-        auto* selfBundlePtrI64 = cg.getBuilder().CreatePtrToInt(
-            selfBundleMem, llvm::Type::getInt64Ty(cg.getContext()), "self_bundle_i64");
+        llvm::Value* selfBundlePtrI64;
+        if (hasSelfSlot) {
+            auto* selfSlot = cg.getBuilder().CreateConstGEP1_64(
+                llvm::Type::getInt64Ty(cg.getContext()), envArg, N_free + N_mut, "self_slot");
+            selfBundlePtrI64 = cg.getBuilder().CreateLoad(
+                llvm::Type::getInt64Ty(cg.getContext()), selfSlot, "self_bundle_i64");
+        } else {
+            auto* ptrTy = llvm::PointerType::getUnqual(cg.getContext());
+            auto* bundleTy = llvm::StructType::get(cg.getContext(), {ptrTy, ptrTy});
+            selfBundleGlobal = new llvm::GlobalVariable(
+                cg.getModule(), bundleTy, /*isConstant=*/true,
+                llvm::GlobalValue::PrivateLinkage,
+                llvm::ConstantStruct::get(bundleTy, {func, llvm::ConstantPointerNull::get(ptrTy)}),
+                fnName + "_self");
+            selfBundleGlobal->setAlignment(llvm::Align(8));
+            selfBundlePtrI64 = cg.getBuilder().CreatePtrToInt(
+                selfBundleGlobal, llvm::Type::getInt64Ty(cg.getContext()), "self_bundle_i64");
+        }
         auto* selfBundleDouble = cg.getBuilder().CreateBitCast(
             selfBundlePtrI64, llvm::Type::getDoubleTy(cg.getContext()), "self_bundle_double");
 
-        auto* selfAlloca = cg.declareVariable(selfRefVar, /*is_mutable=*/false, SourceLocation{});
+        auto* selfAlloca = cg.declareVariable(selfRefVar, /*is_mutable=*/false, SourceLoc{});
         cg.getBuilder().CreateStore(selfBundleDouble, selfAlloca);
+        // Recursive calls by name become direct calls reusing this invocation's env
+        cg.setKnownFunction(selfRefVar, func,
+            N_free + N_mut > 0
+                ? envArg
+                : llvm::ConstantPointerNull::get(llvm::PointerType::getUnqual(cg.getContext())));
     }
 
     // Codegen the body
     llvm::Value* bodyVal = nullptr;
     if (is_expression_function) {
-        auto* bodyExpr = dynamic_cast<ExprAST*>(body.get());
+        auto* bodyExpr = dyn_cast<ExprAST>(body);
         if (bodyExpr) bodyVal = bodyExpr->codegen();
     } else {
         // Block-style: statements generate code; ReturnStmtAST emits ret directly
         body->codegen();
         if (!cg.getBuilder().GetInsertBlock()->getTerminator()) {
-            // Fallthrough: sync mutable captures then emit implicit ret 0.0
-            cg.emitMutCaptureSyncs();
+            // Fallthrough: implicit ret 0.0
             cg.getBuilder().CreateRet(
                 llvm::ConstantFP::get(cg.getContext(), llvm::APFloat(0.0)));
         }
@@ -331,26 +237,42 @@ llvm::Value* FunctionLiteralAST::codegen() {
     cg.exitScope();
 
     if (bodyVal) {
-        // Expression function: sync mutable captures before emitting ret
-        cg.emitMutCaptureSyncs();
         cg.getBuilder().CreateRet(bodyVal);
     }
 
-    cg.popMutCaptureSyncs();
+    generated_function = func;
+    has_env = N_free + N_mut > 0;
 
     // Restore the caller's insert point
     cg.getBuilder().SetInsertPoint(savedBlock);
 
     // --- Build closure bundle in the outer context ---
 
-    // Allocate env array on the heap: N_free doubles + N_mut i64 ptr values (8 bytes each)
-    int N_total = N_free + N_mut;
+    // A capture-free recursive function already has its constant bundle
+    if (selfBundleGlobal) {
+        auto* bundlePtrI64 = cg.getBuilder().CreatePtrToInt(
+            selfBundleGlobal, llvm::Type::getInt64Ty(cg.getContext()), "bundle_i64");
+        return cg.getBuilder().CreateBitCast(
+            bundlePtrI64, llvm::Type::getDoubleTy(cg.getContext()), "bundle_double");
+    }
+
+    // Allocate env array in the arena: N_free doubles + N_mut i64 ptr values (8 bytes each),
+    // plus the self slot for recursive closures
+    int N_total = N_free + N_mut + (hasSelfSlot ? 1 : 0);
     llvm::Value* envPtrI64;
+    llvm::Value* envMemForSelf = nullptr;
     if (N_total > 0) {
-        auto* envSize = llvm::ConstantInt::get(
-            llvm::Type::getInt64Ty(cg.getContext()),
-            static_cast<uint64_t>(N_total * 8));
-        auto* envMem = cg.getBuilder().CreateCall(mallocFn, {envSize}, "env_mem");
+        llvm::Value* envMem;
+        if (non_escaping) {
+            envMem = createEntryBlockAlloca(
+                cg, llvm::ArrayType::get(llvm::Type::getInt64Ty(cg.getContext()), N_total), "env_mem");
+        } else {
+            auto* envSize = llvm::ConstantInt::get(
+                llvm::Type::getInt64Ty(cg.getContext()),
+                static_cast<uint64_t>(N_total * 8));
+            envMem = cg.getBuilder().CreateCall(allocFn, {envSize}, "env_mem");
+        }
+        env_value = envMem;
 
         // Store immutable captured doubles at env[0..N_free-1]
         for (int i = 0; i < N_free; ++i) {
@@ -368,17 +290,24 @@ llvm::Value* FunctionLiteralAST::codegen() {
             cg.getBuilder().CreateStore(ptrAsI64, slot);
         }
 
+        envMemForSelf = envMem;
         envPtrI64 = cg.getBuilder().CreatePtrToInt(
             envMem, llvm::Type::getInt64Ty(cg.getContext()), "env_ptr_i64");
     } else {
         envPtrI64 = llvm::ConstantInt::get(llvm::Type::getInt64Ty(cg.getContext()), 0);
     }
 
-    // Malloc closure bundle: 2 x i64 = 16 bytes { fn_ptr_i64, env_ptr_i64 }
-    auto* bundleMem = cg.getBuilder().CreateCall(
-        mallocFn,
-        {llvm::ConstantInt::get(llvm::Type::getInt64Ty(cg.getContext()), 16)},
-        "closure_bundle");
+    // Allocate closure bundle: 2 x i64 = 16 bytes { fn_ptr_i64, env_ptr_i64 }
+    llvm::Value* bundleMem;
+    if (non_escaping) {
+        bundleMem = createEntryBlockAlloca(
+            cg, llvm::ArrayType::get(llvm::Type::getInt64Ty(cg.getContext()), 2), "closure_bundle");
+    } else {
+        bundleMem = cg.getBuilder().CreateCall(
+            allocFn,
+            {llvm::ConstantInt::get(llvm::Type::getInt64Ty(cg.getContext()), 16)},
+            "closure_bundle");
+    }
 
     // Store fn_ptr as i64 at bundle[0]
     auto* fnPtrI64 = cg.getBuilder().CreatePtrToInt(
@@ -393,37 +322,90 @@ llvm::Value* FunctionLiteralAST::codegen() {
     // Encode bundle pointer as double: ptr -> i64 -> double
     auto* bundlePtrI64 = cg.getBuilder().CreatePtrToInt(
         bundleMem, llvm::Type::getInt64Ty(cg.getContext()), "bundle_i64");
+    if (hasSelfSlot) {
+        auto* selfSlot = cg.getBuilder().CreateConstGEP1_64(
+            llvm::Type::getInt64Ty(cg.getContext()), envMemForSelf, N_free + N_mut, "self_env_slot");
+        cg.getBuilder().CreateStore(bundlePtrI64, selfSlot);
+    }
     return cg.getBuilder().CreateBitCast(
         bundlePtrI64, llvm::Type::getDoubleTy(cg.getContext()), "bundle_double");
 }
 
-llvm::Value* FunctionCallAST::codegen() {
-    auto& cg = getCodeGen();
-
-    // Codegen the callee expression (closure bundle pointer encoded as double)
-    llvm::Value* calleeVal = callee->codegen();
-    if (!calleeVal) return nullptr;
+// True if v can be used by code being emitted into fn (constants, or values defined in fn)
+static bool isAvailableIn(llvm::Value* v, llvm::Function* fn) {
+    if (llvm::isa<llvm::Constant>(v)) return true;
+    if (auto* arg = llvm::dyn_cast<llvm::Argument>(v)) return arg->getParent() == fn;
+    if (auto* inst = llvm::dyn_cast<llvm::Instruction>(v)) return inst->getFunction() == fn;
+    return false;
+}
 
-    // Decode bundle pointer: double -> i64 -> ptr
+// Decode the env pointer stored at bundle[1] of a closure bundle encoded as double
+static llvm::Value* loadBundleEnv(CodeGen& cg, llvm::Value* calleeVal) {
     auto* bundlePtrI64 = cg.getBuilder().CreateBitCast(
         calleeVal, llvm::Type::getInt64Ty(cg.getContext()), "bundle_i64");
     auto* bundle = cg.getBuilder().CreateIntToPtr(
         bundlePtrI64, llvm::PointerType::getUnqual(cg.getContext()), "bundle_ptr");
-
-    // Load fn_ptr_i64 from bundle[0], then convert to function pointer
-    auto* fnPtrI64 = cg.getBuilder().CreateLoad(
-        llvm::Type::getInt64Ty(cg.getContext()), bundle, "fn_ptr_i64");
-    auto* fnPtr = cg.getBuilder().CreateIntToPtr(
-        fnPtrI64, llvm::PointerType::getUnqual(cg.getContext()), "fn_ptr");
-
-    // Load env_ptr_i64 from bundle[1], convert to ptr
     auto* slot1 = cg.getBuilder().CreateConstGEP1_64(
         llvm::Type::getInt64Ty(cg.getContext()), bundle, 1, "bundle_slot1");
     auto* envPtrI64 = cg.getBuilder().CreateLoad(
         llvm::Type::getInt64Ty(cg.getContext()), slot1, "env_ptr_i64");
-    auto* envPtr = cg.getBuilder().CreateIntToPtr(
+    return cg.getBuilder().CreateIntToPtr(
         envPtrI64, llvm::PointerType::getUnqual(cg.getContext()), "env_ptr");
+}
 
+llvm::Value* boxClosure(llvm::Value* closure) {
+    auto& cg = getCodeGen();
+    auto* bundle = cg.getBuilder().CreateExtractValue(closure, 2, "bundle");
+    auto* bundleI64 = cg.getBuilder().CreatePtrToInt(
+        bundle, llvm::Type::getInt64Ty(cg.getContext()), "bundle_i64");
+    return cg.getBuilder().CreateBitCast(
+        bundleI64, llvm::Type::getDoubleTy(cg.getContext()), "bundle_double");
+}
+
+llvm::Value* unboxClosure(llvm::Value* boxed) {
+    auto& cg = getCodeGen();
+    auto* ptrTy = llvm::PointerType::getUnqual(cg.getContext());
+    auto* bundleI64 = cg.getBuilder().CreateBitCast(
+        boxed, llvm::Type::getInt64Ty(cg.getContext()), "bundle_i64");
+    auto* bundle = cg.getBuilder().CreateIntToPtr(bundleI64, ptrTy, "bundle_ptr");
+    auto* fnPtr = cg.getBuilder().CreateLoad(ptrTy, bundle, "fn_ptr");
+    auto* env = cg.getBuilder().CreateLoad(
+        ptrTy, cg.getBuilder().CreateConstGEP1_64(ptrTy, bundle, 1, "bundle_slot1"), "env_ptr");
+    llvm::Value* closure = llvm::UndefValue::get(cg.getClosureType());
+    closure = cg.getBuilder().CreateInsertValue(closure, fnPtr, 0);
+    closure = cg.getBuilder().CreateInsertValue(closure, env, 1);
+    return cg.getBuilder().CreateInsertValue(closure, bundle, 2, "closure");
+}
+
+llvm::Value* codegenClosureValue(ExprAST* expr) {
+    auto& cg = getCodeGen();
+    if (auto* var = dyn_cast<VariableExprAST>(expr)) {
+        if (cg.isClosureSlot(var->getName())) {
+            return cg.getBuilder().CreateLoad(
+                cg.getClosureType(), cg.getVariable(var->getName()), std::string(var->getName()) + "_closure");
+        }
+    }
+
+    llvm::Value* boxed = expr->codegen();
+    if (!boxed) return nullptr;
+    auto* fnLit = dyn_cast<FunctionLiteralAST>(expr);
+    if (!fnLit || !fnLit->getGeneratedFunction()) return unboxClosure(boxed);
+
+    // Fresh literal: every field is already at hand, nothing to load back
+    auto* ptrTy = llvm::PointerType::getUnqual(cg.getContext());
+    llvm::Value* env = fnLit->hasEnv() ? fnLit->getEnvValue() : llvm::ConstantPointerNull::get(ptrTy);
+    auto* bundleI64 = cg.getBuilder().CreateBitCast(
+        boxed, llvm::Type::getInt64Ty(cg.getContext()), "bundle_i64");
+    auto* bundle = cg.getBuilder().CreateIntToPtr(bundleI64, ptrTy, "bundle_ptr");
+    llvm::Value* closure = llvm::UndefValue::get(cg.getClosureType());
+    closure = cg.getBuilder().CreateInsertValue(closure, fnLit->getGeneratedFunction(), 0);
+    closure = cg.getBuilder().CreateInsertValue(closure, env, 1);
+    return cg.getBuilder().CreateInsertValue(closure, bundle, 2, "closure");
+}
+
+// Emit the call itself: user args followed by env, against the uniform double(double*N, ptr) type
+static llvm::Value* emitClosureCall(CodeGen& cg, llvm::Value* fnPtr, llvm::Value* envPtr,
+                                    ASTSpan<ExprAST*> args) {
     // Codegen user arguments
     std::vector<llvm::Value*> argValues;
     argValues.reserve(args.size() + 1);
@@ -443,6 +425,79 @@ llvm::Value* FunctionCallAST::codegen() {
     return cg.getBuilder().CreateCall(funcType, fnPtr, argValues, "calltmp");
 }
 
+// AIDEV-NOTE: Direct-call fast path. When the callee is an immutable binding to a fn literal
+// (tracked as Symbol::knownFunction) or a fn literal itself, call @__fn_N directly so LLVM can
+// inline it; the env comes from the binding if statically known, else from bundle[1].
+llvm::Value* FunctionCallAST::codegen() {
+    auto& cg = getCodeGen();
+    auto* curFn = cg.getBuilder().GetInsertBlock()->getParent();
+
+    // Arity is normally enforced by the type checker; on a mismatch keep the indirect call
+    auto arityMatches = [&](llvm::Function* fn) { return fn->arg_size() == args.size() + 1; };
+
+    llvm::Function* directFn = nullptr;
+    llvm::Value* directEnv = nullptr;
+    if (auto* var = dyn_cast<VariableExprAST>(callee)) {
+        directFn = cg.getNearestKnownFunction(var->getName());
+        if (directFn && arityMatches(directFn)) {
+            directEnv = cg.getNearestKnownEnv(var->getName());
+            if (directEnv && !isAvailableIn(directEnv, curFn)) directEnv = nullptr;
+        } else {
+            directFn = nullptr;
+        }
+    }
+
+    // Typed closure slot: fn and env are plain fields, no bundle decoding
+    if (!(directFn && directEnv)) {
+        auto* var = dyn_cast<VariableExprAST>(callee);
+        if (var && cg.isClosureSlot(var->getName())) {
+            auto* closure = cg.getBuilder().CreateLoad(
+                cg.getClosureType(), cg.getVariable(var->getName()), std::string(var->getName()) + "_closure");
+            auto* envPtr = cg.getBuilder().CreateExtractValue(closure, 1, "env_ptr");
+            llvm::Value* fnPtr = directFn ? directFn : cg.getBuilder().CreateExtractValue(closure, 0, "fn_ptr");
+            return emitClosureCall(cg, fnPtr, envPtr, args);
+        }
+    }
+
+    llvm::Value* envPtr = nullptr;
+    if (directFn && directEnv) {
+        // Function and env both known: the bundle does not need to be touched at all
+        envPtr = directEnv;
+    } else {
+        // Codegen the callee expression (closure bundle pointer encoded as double)
+        llvm::Value* calleeVal = callee->codegen();
+        if (!calleeVal) return nullptr;
+
+        if (auto* fnLit = dyn_cast<FunctionLiteralAST>(callee)) {
+            directFn = fnLit->getGeneratedFunction();
+            if (directFn && !arityMatches(directFn)) directFn = nullptr;
+            if (directFn && !fnLit->hasEnv()) {
+                envPtr = llvm::ConstantPointerNull::get(llvm::PointerType::getUnqual(cg.getContext()));
+            } else if (directFn) {
+                envPtr = fnLit->getEnvValue();
+            }
+        }
+
+        if (directFn) {
+            if (!envPtr) envPtr = loadBundleEnv(cg, calleeVal);
+        } else {
+            // Unknown callee: decode bundle pointer (double -> i64 -> ptr) and load fn_ptr
+            auto* bundlePtrI64 = cg.getBuilder().CreateBitCast(
+                calleeVal, llvm::Type::getInt64Ty(cg.getContext()), "bundle_i64");
+            auto* bundle = cg.getBuilder().CreateIntToPtr(
+                bundlePtrI64, llvm::PointerType::getUnqual(cg.getContext()), "bundle_ptr");
+            auto* fnPtrI64 = cg.getBuilder().CreateLoad(
+                llvm::Type::getInt64Ty(cg.getContext()), bundle, "fn_ptr_i64");
+            auto* fnPtr = cg.getBuilder().CreateIntToPtr(
+                fnPtrI64, llvm::PointerType::getUnqual(cg.getContext()), "fn_ptr");
+            envPtr = loadBundleEnv(cg, calleeVal);
+            return emitClosureCall(cg, fnPtr, envPtr, args);
+        }
+    }
+
+    return emitClosureCall(cg, directFn, envPtr, args);
+}
+
 llvm::Value* ReturnStmtAST::codegen() {
     auto& cg = getCodeGen();
     llvm::Value* retVal;
@@ -452,8 +507,6 @@ llvm::Value* ReturnStmtAST::codegen() {
     } else {
         retVal = llvm::ConstantFP::get(cg.getContext(), llvm::APFloat(0.0));
     }
-    // Sync mutable captures back to heap before returning
-    cg.emitMutCaptureSyncs();
     cg.getBuilder().CreateRet(retVal);
     return retVal;
 }
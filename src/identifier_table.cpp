@@ -0,0 +1,50 @@
+#include "identifier_table.h"
+
+uint64_t hashIdentifier(std::string_view name) {
+    uint64_t h = 14695981039346656037ull;
+    for (unsigned char c : name) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+IdentifierTable::IdentifierTable() : slots(256) {}
+
+std::string_view IdentifierTable::intern(std::string_view name) {
+    if (name.empty()) return name;
+    const uint64_t h = hashIdentifier(name);
+    const size_t mask = slots.size() - 1;
+    for (size_t i = static_cast<size_t>(h) & mask;; i = (i + 1) & mask) {
+        Slot& slot = slots[i];
+        if (slot.name.empty()) {
+            slot = Slot{h, name};
+            if (++count * 4 > slots.size() * 3) grow();  // keep load factor under 3/4
+            return name;
+        }
+        if (slot.hash == h && slot.name == name) return slot.name;
+    }
+}
+
+std::string_view IdentifierTable::lookup(std::string_view name) const {
+    if (name.empty()) return {};
+    const uint64_t h = hashIdentifier(name);
+    const size_t mask = slots.size() - 1;
+    for (size_t i = static_cast<size_t>(h) & mask;; i = (i + 1) & mask) {
+        const Slot& slot = slots[i];
+        if (slot.name.empty()) return {};
+        if (slot.hash == h && slot.name == name) return slot.name;
+    }
+}
+
+void IdentifierTable::grow() {
+    std::vector<Slot> old(slots.size() * 2);
+    old.swap(slots);
+    const size_t mask = slots.size() - 1;
+    for (const Slot& slot : old) {
+        if (slot.name.empty()) continue;
+        size_t i = static_cast<size_t>(slot.hash) & mask;
+        while (!slots[i].name.empty()) i = (i + 1) & mask;
+        slots[i] = slot;
+    }
+}
@@ -0,0 +1,56 @@
+#include "jit.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/TargetSelect.h"
+#include <stdexcept>
+#include <string>
+
+template <typename T>
+static T checkJIT(llvm::Expected<T> value, const char* what) {
+    if (!value) {
+        throw std::runtime_error(std::string(what) + ": " + llvm::toString(value.takeError()));
+    }
+    return std::move(*value);
+}
+
+static void checkJIT(llvm::Error err, const char* what) {
+    if (err) {
+        throw std::runtime_error(std::string(what) + ": " + llvm::toString(std::move(err)));
+    }
+}
+
+// Resolve printf/malloc and other libc symbols against the arithc process itself
+template <typename JIT>
+static void addProcessSymbols(JIT& jit) {
+    auto generator = checkJIT(
+        llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+            jit.getDataLayout().getGlobalPrefix()),
+        "JIT symbol generator creation failed");
+    jit.getMainJITDylib().addGenerator(std::move(generator));
+}
+
+// AIDEV-NOTE: The module keeps the host data layout set by CodeGen::getTargetMachine() (if -O ran);
+// LLJIT fills in its own layout otherwise. Lazy mode relies on CompileOnDemandLayer's default
+// per-function partitioning, so only __fn_N closures that are actually called get compiled.
+int runWithJIT(CodeGen& cg, bool lazy) {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+
+    llvm::orc::ThreadSafeModule tsm(cg.takeModule(), cg.takeContext());
+
+    if (lazy) {
+        auto jit = checkJIT(llvm::orc::LLLazyJITBuilder().create(), "JIT creation failed");
+        addProcessSymbols(*jit);
+        checkJIT(jit->addLazyIRModule(std::move(tsm)), "JIT module load failed");
+        auto mainSym = checkJIT(jit->lookup("main"), "JIT lookup of main failed");
+        return mainSym.toPtr<int (*)()>()();
+    }
+
+    auto jit = checkJIT(llvm::orc::LLJITBuilder().create(), "JIT creation failed");
+    addProcessSymbols(*jit);
+    checkJIT(jit->addIRModule(std::move(tsm)), "JIT module load failed");
+    auto mainSym = checkJIT(jit->lookup("main"), "JIT lookup of main failed");
+    return mainSym.toPtr<int (*)()>()();
+}
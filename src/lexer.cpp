@@ -1,48 +1,38 @@
 #include "lexer.h"
 #include "parser.h" // For ParseError
+#include "number_parse.h"
 #include <cctype>
 #include <stdexcept>
 
-Lexer::Lexer(const std::string& input, std::string filename)
-    : input(input), filename(std::move(filename)), pos(0), currentChar('\0'), line(1), column(1) {
+Lexer::Lexer(const SourceManager::Buffer& buffer)
+    : input(buffer.text), filename(buffer.name), base(buffer.getLoc(0)), pos(0), currentChar('\0') {
     currentChar = pos < input.length() ? input[pos] : '\0';
 }
 
+Lexer::Lexer(std::string_view input, std::string filename)
+    : Lexer(getSourceManager().addBuffer(filename, std::string(input))) {}
+
 void Lexer::advance() {
-    // handle CRLF and LF
-    if (currentChar == '\r') {
-        // if next char is \n, consume both but count as single newline
-        pos++;
-        if (pos < input.length() && input[pos] == '\n') {
-            pos++;
-        }
-        line += 1;
-        column = 1;
-    } else if (currentChar == '\n') {
-        pos++;
-        line += 1;
-        column = 1;
-    } else if (currentChar == '\0') {
-        // already at end
-    } else {
-        pos++;
-        column += 1;
-    }
+    // Line/column are derived from the offset on demand (SourceManager::getPresumedLoc)
+    if (currentChar == '\0') return;  // already at end
+    pos++;
+    currentChar = pos < input.length() ? input[pos] : '\0';
+}
+
+// Skip n bytes known not to contain the end-of-input NUL
+void Lexer::advanceBy(size_t n) {
+    pos += n;
     currentChar = pos < input.length() ? input[pos] : '\0';
 }
 
 void Lexer::skipWhitespace() {
-    while (currentChar != '\0' && std::isspace(static_cast<unsigned char>(currentChar))) {
-        advance();
-    }
+    advanceBy(scan.whitespace(input.data() + pos, input.length() - pos));
 }
 
 void Lexer::skipComment() {
     if (currentChar == '/' && pos + 1 < input.length() && input[pos + 1] == '/') {
         // // 주석: 라인 끝까지 건너뛰기
-        while (currentChar != '\0' && currentChar != '\n' && currentChar != '\r') {
-            advance();
-        }
+        advanceBy(scan.lineEnd(input.data() + pos, input.length() - pos));
         // 개행까지 소비 (advance가 줄바꿈 처리)
         if (currentChar == '\n' || currentChar == '\r') {
             advance();
@@ -51,51 +41,57 @@ void Lexer::skipComment() {
 }
 
 double Lexer::readNumber() {
-    std::string numStr;
+    size_t end = pos;
     bool hasDot = false;
     
-    // Read digits and at most one decimal point
-    while (currentChar != '\0' && (std::isdigit(currentChar) || currentChar == '.')) {
-        if (currentChar == '.') {
+    // Read digits and at most one decimal point straight from the buffer
+    for (; end < input.size(); ++end) {
+        char c = input[end];
+        if (c == '.') {
             if (hasDot) {
                 // Multiple decimal points - invalid number
                 throw std::runtime_error("Invalid number format: multiple decimal points");
             }
             hasDot = true;
+        } else if (!std::isdigit(static_cast<unsigned char>(c))) {
+            break;
         }
-    numStr += currentChar;
-    advance();
     }
+    std::string_view numText = input.substr(pos, end - pos);
+    advanceBy(end - pos);
     
     // Check for invalid formats like ending with dot
-    if (numStr.empty() || numStr.back() == '.') {
+    if (numText.empty() || numText.back() == '.') {
         throw std::runtime_error("Invalid number format: number cannot end with decimal point");
     }
     
     // Check for starting with dot
-    if (numStr.front() == '.') {
+    if (numText.front() == '.') {
         throw std::runtime_error("Invalid number format: number cannot start with decimal point");
     }
     
-    return std::stod(numStr);
+    return parseDecimalLiteral(numText);
 }
 
-std::string Lexer::readIdentifier() {
-    std::string identifier;
-    
+std::string_view Lexer::readIdentifier() {
+    size_t start = pos;
     while (currentChar != '\0' && (std::isalnum(static_cast<unsigned char>(currentChar)) || currentChar == '_' || (static_cast<unsigned char>(currentChar) >= 0x80))) {
-        identifier += currentChar;
         advance();
     }
-    
-    return identifier;
+    return input.substr(start, pos - start);
 }
 
-std::string Lexer::readString() {
-    std::string str;
+std::string_view Lexer::readString() {
     advance(); // consume opening quote
+    size_t start = pos;
+    std::string* decoded = nullptr;  // created at the first escape; plain literals stay slices
     
     while (true) {
+        // Jump over the plain run up to the next quote, backslash or line end
+        size_t run = scan.stringBody(input.data() + pos, input.length() - pos);
+        if (decoded) decoded->append(input.data() + pos, run);
+        advanceBy(run);
+
         // Unterminated if we hit end-of-file or newline before closing quote
         if (currentChar == '\0' || currentChar == '\n' || currentChar == '\r') {
             throw ParseError("Unterminated string literal", currentLocation());
@@ -110,64 +106,85 @@ std::string Lexer::readString() {
             if (currentChar == '\0' || currentChar == '\n' || currentChar == '\r') {
                 throw ParseError("Unterminated string literal", currentLocation());
             }
+            if (!decoded) {
+                decoded = &decodedStrings.emplace_back(input.substr(start, pos - 1 - start));
+            }
             switch (currentChar) {
-                case 'n': str += '\n'; break;
-                case 't': str += '\t'; break;
-                case 'r': str += '\r'; break;
-                case '\\': str += '\\'; break;
-                case '"': str += '"'; break;
+                case 'n': *decoded += '\n'; break;
+                case 't': *decoded += '\t'; break;
+                case 'r': *decoded += '\r'; break;
+                case '\\': *decoded += '\\'; break;
+                case '"': *decoded += '"'; break;
                 default:
                     throw ParseError("Invalid escape sequence in string literal", currentLocation());
             }
-        } else {
-            str += currentChar;
         }
         advance();
     }
     
+    std::string_view str = decoded ? std::string_view(*decoded) : input.substr(start, pos - start);
     advance(); // consume closing quote
     return str;
 }
 
-Token Lexer::handleKeywordOrIdentifier(const std::string& identifier, const SourceRange& r) {
-    if (identifier == "print") {
-        return Token(TOK_PRINT, identifier, 0.0, r);
-    } else if (identifier == "if") {
-        return Token(TOK_IF, identifier, 0.0, r);
-    } else if (identifier == "else") {
-        return Token(TOK_ELSE, identifier, 0.0, r);
-    } else if (identifier == "while") {
-        return Token(TOK_WHILE, identifier, 0.0, r);
-    } else if (identifier == "mut") {
-        return Token(TOK_MUT, identifier, 0.0, r);
-    } else if (identifier == "fn") {
-        return Token(TOK_FN, identifier, 0.0, r);
-    } else if (identifier == "return") {
-        return Token(TOK_RETURN, identifier, 0.0, r);
-    } else if (identifier == "import") {
-        return Token(TOK_IMPORT, identifier, 0.0, r);
-    } else if (identifier == "export") {
-        return Token(TOK_EXPORT, identifier, 0.0, r);
-    } else if (identifier == "from") {
-        return Token(TOK_FROM, identifier, 0.0, r);
-    } else if (identifier == "as") {
-        return Token(TOK_AS, identifier, 0.0, r);
-    } else if (identifier == "default") {
-        return Token(TOK_DEFAULT, identifier, 0.0, r);
+namespace {
+// AIDEV-NOTE: Keywords are found with a perfect hash over (length, first two chars) into a
+// 16-slot table built at compile time; a collision fails the build. One hash plus one
+// string compare per identifier instead of a chain of comparisons.
+struct Keyword {
+    std::string_view text;
+    TokenType type = TOK_IDENTIFIER;
+};
+
+constexpr Keyword kKeywords[] = {
+    {"print", TOK_PRINT}, {"if", TOK_IF}, {"else", TOK_ELSE}, {"while", TOK_WHILE},
+    {"mut", TOK_MUT}, {"fn", TOK_FN}, {"return", TOK_RETURN}, {"import", TOK_IMPORT},
+    {"export", TOK_EXPORT}, {"from", TOK_FROM}, {"as", TOK_AS}, {"default", TOK_DEFAULT},
+};
+constexpr size_t kMinKeywordLength = 2;
+constexpr size_t kMaxKeywordLength = 7;
+constexpr size_t kKeywordSlots = 16;
+
+constexpr size_t keywordHash(std::string_view s) {
+    return (s.size() + 3u * static_cast<unsigned char>(s[0]) + 11u * static_cast<unsigned char>(s[1])) &
+           (kKeywordSlots - 1);
+}
+
+struct KeywordTable {
+    Keyword slots[kKeywordSlots];
+};
+
+constexpr KeywordTable makeKeywordTable() {
+    KeywordTable table{};
+    for (const Keyword& kw : kKeywords) {
+        Keyword& slot = table.slots[keywordHash(kw.text)];
+        if (!slot.text.empty()) throw "keyword hash collision";
+        slot = kw;
+    }
+    return table;
+}
+
+constexpr KeywordTable kKeywordTable = makeKeywordTable();
+} // namespace
+
+Token Lexer::handleKeywordOrIdentifier(std::string_view identifier, const SourceRange& r) {
+    if (identifier.size() >= kMinKeywordLength && identifier.size() <= kMaxKeywordLength) {
+        const Keyword& kw = kKeywordTable.slots[keywordHash(identifier)];
+        if (kw.text == identifier) return Token(kw.type, identifier, 0.0, r);
     }
-    return Token(TOK_IDENTIFIER, identifier, 0.0, r);
+    return Token(TOK_IDENTIFIER, identifiers.intern(identifier), 0.0, r);
 }
 
-Token Lexer::handleOperator(char ch, const SourceLocation& startLoc) {
+Token Lexer::handleOperator(char ch, SourceLoc startLoc) {
     // we will advance as we consume
-    SourceLocation curStart = startLoc;
+    SourceLoc curStart = startLoc;
     advance();
     
     switch (ch) {
         case '+': case '-': case '*': case '/':
         case '(': case ')': case '{': case '}':
         case ';': case ',':
-            return Token(static_cast<TokenType>(ch), std::string(1, ch), 0.0,
+            return Token(static_cast<TokenType>(ch), input.substr(pos - 1, 1), 0.0,
                          SourceRange{curStart, currentLocation()});
         case '=':
             if (currentChar == '=') {
@@ -220,21 +237,22 @@ Token Lexer::getNextToken() {
         break; // 주석이 아니면 토큰 처리 진행
     }
     // record start location of the token
-    SourceLocation startLoc = currentLocation();
+    SourceLoc startLoc = currentLocation();
     
     if (std::isdigit(static_cast<unsigned char>(currentChar))) {
+        size_t start = pos;
         double value = readNumber();
-        return Token(TOK_NUMBER, std::to_string(value), value, SourceRange{startLoc, currentLocation()});
+        return Token(TOK_NUMBER, input.substr(start, pos - start), value, SourceRange{startLoc, currentLocation()});
     }
     
     if (std::isalpha(static_cast<unsigned char>(currentChar)) || currentChar == '_' || (static_cast<unsigned char>(currentChar) >= 0x80)) {
-        std::string identifier = readIdentifier();
+        std::string_view identifier = readIdentifier();
         return handleKeywordOrIdentifier(identifier, SourceRange{startLoc, currentLocation()});
     }
     
     if (currentChar == '"') {
         try {
-            std::string str = readString();
+            std::string_view str = readString();
             return Token(TOK_STRING, str, 0.0, SourceRange{startLoc, currentLocation()});
         } catch (const std::runtime_error& e) {
             // Report lexer string errors at the current position (e.g., end of line for unterminated)
@@ -4,22 +4,35 @@
 #include "ast.h"
 #include "type_check.h"
 #include "module_resolver.h"
+#include "module_compiler.h"
+#include "jit.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Type.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Program.h"
 #include <iostream>
 #include <string>
 #include <fstream>
-#include <sstream>
 #include "parse_error_reporting.h"
 
 void initializeCodeGen(const std::string& moduleName, const std::string& sourceFile = "");
 CodeGen& getCodeGen();
 
+enum class EmitKind { IR, Assembly, Object, Executable };
+
 struct CompilerOptions {
     std::string inputFile;
     std::string outputFile;
+    unsigned optLevel = 0;
+    EmitKind emit = EmitKind::IR;
+    bool emitGiven = false;  // --emit=, -S, -c 중 하나가 지정됨
+    std::string targetCPU = "generic";
+    std::string targetFeatures;
+    bool run = false;       // --run: JIT으로 바로 실행 (파일 출력 없음)
+    bool lazyJIT = false;   // --lazy: 호출되는 함수만 컴파일
+    std::string moduleCacheDir;  // --module-cache=<디렉토리>: 파싱된 모듈 캐시 위치 (비어 있으면 사용 안 함)
 };
 
 void printUsage(const char* programName) {
@@ -29,11 +42,23 @@ void printUsage(const char* programName) {
     std::cout << "  " << programName << " -o <출력파일> <입력파일>\n";
     std::cout << "  " << programName << " <입력파일> -o <출력파일>\n\n";
     std::cout << "옵션:\n";
-    std::cout << "  -o <파일>    LLVM IR을 지정된 파일에 저장 (기본값: a.ll)\n\n";
+    std::cout << "  -o <파일>    출력을 지정된 파일에 저장 (기본값: a.ll)\n";
+    std::cout << "  -O<n>        최적화 레벨 0-3 (기본값: -O0)\n";
+    std::cout << "  --emit=<종류> 출력 종류: ll, asm, obj, exe (기본값: ll)\n";
+    std::cout << "  -S           --emit=asm과 동일 (기본 출력: a.s)\n";
+    std::cout << "  -c           --emit=obj와 동일 (기본 출력: a.o)\n";
+    std::cout << "  -mcpu=<cpu>  대상 CPU (기본값: generic, native = 호스트 CPU)\n";
+    std::cout << "  -mattr=<속성> 대상 CPU 기능 (예: +avx2,+fma)\n";
+    std::cout << "  --run        파일을 만들지 않고 ORC JIT으로 즉시 실행 (-o, --emit, -S, -c와 함께 사용 불가)\n";
+    std::cout << "  --lazy       --run에서 함수를 처음 호출될 때 컴파일\n";
+    std::cout << "  --module-cache=<디렉토리> 파싱된 모듈을 디렉토리에 캐시하여 재사용\n\n";
     std::cout << "예제:\n";
     std::cout << "  " << programName << " input.k                 # a.ll로 출력\n";
     std::cout << "  " << programName << " -o output.ll input.k    # output.ll로 출력\n";
     std::cout << "  " << programName << " input.k -o output.ll    # output.ll로 출력\n";
+    std::cout << "  " << programName << " -O2 -o output.ll input.k  # 최적화된 IR 출력\n";
+    std::cout << "  " << programName << " -O2 --emit=exe -o prog input.k  # 네이티브 실행파일 출력\n";
+    std::cout << "  " << programName << " --run input.k           # JIT으로 즉시 실행\n";
     std::cout << "입력 파일은 .k 확장자를 사용합니다.\n";
 }
 
@@ -60,42 +85,78 @@ std::string pathToModuleID(const std::string& path) {
     return result;
 }
 
-std::string readFile(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        throw std::runtime_error("파일을 열 수 없습니다: " + filename);
-    }
-    
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
-}
-
 CompilerOptions parseCommandLine(int argc, char* argv[]) {
     CompilerOptions options;
     
-    if (argc == 2) {
-        // gcc와 같은 동작: -o 없으면 현재 디렉토리에 'a.ll' 생성
-        options.inputFile = argv[1];
-        options.outputFile = "a.ll";
-    } else if (argc == 4) {
-        if (std::string(argv[1]) == "-o") {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-o") {
             // -o 옵션으로 출력 파일 지정: arithc -o output.ll input.k
-            options.outputFile = argv[2];
-            options.inputFile = argv[3];
-        } else if (std::string(argv[2]) == "-o") {
-            // -o 옵션이 뒤에: arithc input.k -o output.ll
-            options.inputFile = argv[1];
-            options.outputFile = argv[3];
+            if (i + 1 >= argc || !options.outputFile.empty()) {
+                printUsage(argv[0]);
+                throw std::runtime_error("잘못된 명령행 인자");
+            }
+            options.outputFile = argv[++i];
+        } else if (arg.size() == 3 && arg[0] == '-' && arg[1] == 'O' &&
+                   arg[2] >= '0' && arg[2] <= '3') {
+            // -O0 ~ -O3: clang과 같은 최적화 레벨
+            options.optLevel = static_cast<unsigned>(arg[2] - '0');
+        } else if (arg == "-S" || arg == "--emit=asm") {
+            options.emit = EmitKind::Assembly;
+            options.emitGiven = true;
+        } else if (arg == "-c" || arg == "--emit=obj") {
+            options.emit = EmitKind::Object;
+            options.emitGiven = true;
+        } else if (arg == "--emit=exe") {
+            options.emit = EmitKind::Executable;
+            options.emitGiven = true;
+        } else if (arg == "--emit=ll") {
+            options.emit = EmitKind::IR;
+            options.emitGiven = true;
+        } else if (arg == "--run") {
+            options.run = true;
+        } else if (arg == "--lazy") {
+            options.lazyJIT = true;
+        } else if (arg.rfind("--module-cache=", 0) == 0 && arg.size() > 15) {
+            options.moduleCacheDir = arg.substr(15);
+        } else if (arg.rfind("-mcpu=", 0) == 0) {
+            options.targetCPU = arg.substr(6);
+        } else if (arg.rfind("-mattr=", 0) == 0) {
+            options.targetFeatures = arg.substr(7);
+        } else if (!arg.empty() && arg[0] != '-' && options.inputFile.empty()) {
+            options.inputFile = arg;
         } else {
             printUsage(argv[0]);
             throw std::runtime_error("잘못된 명령행 인자");
         }
-    } else {
+    }
+    
+    if (options.inputFile.empty()) {
         printUsage(argv[0]);
         throw std::runtime_error("잘못된 명령행 인자");
     }
     
+    if (options.lazyJIT && !options.run) {
+        printUsage(argv[0]);
+        throw std::runtime_error("--lazy는 --run과 함께 사용해야 합니다");
+    }
+    
+    // --run은 파일을 쓰지 않으므로 출력 옵션을 조용히 무시하지 않고 거부
+    if (options.run && (!options.outputFile.empty() || options.emitGiven)) {
+        printUsage(argv[0]);
+        throw std::runtime_error("--run은 -o, --emit, -S, -c와 함께 사용할 수 없습니다");
+    }
+    
+    // gcc와 같은 동작: -o 없으면 현재 디렉토리에 'a.ll' (a.s, a.o, a.out) 생성
+    if (options.outputFile.empty()) {
+        switch (options.emit) {
+            case EmitKind::IR: options.outputFile = "a.ll"; break;
+            case EmitKind::Assembly: options.outputFile = "a.s"; break;
+            case EmitKind::Object: options.outputFile = "a.o"; break;
+            case EmitKind::Executable: options.outputFile = "a.out"; break;
+        }
+    }
+    
     if (options.inputFile.length() < 2 || 
         options.inputFile.substr(options.inputFile.length() - 2) != ".k") {
         throw std::runtime_error("입력 파일은 .k 확장자를 사용해야 합니다");
@@ -121,26 +182,32 @@ void setupLLVMFunction(const std::string& inputFile) {
     codeGen.getBuilder().SetInsertPoint(entry);
 }
 
-void compileSource(const std::string& input, const std::string& filename) {
+// 모듈마다 별도의 LLVM 모듈로 컴파일·최적화한 뒤 main 모듈에 링크
+void compileSource(const std::string& filename, const std::string& moduleCacheDir, unsigned optLevel) {
     ModuleResolver resolver;
-    auto programAST = resolver.resolve(filename);
-    if (!programAST) {
-        throw std::runtime_error("프로그램 파싱 실패");
+    std::unique_ptr<ModuleCache> cache;
+    if (!moduleCacheDir.empty()) {
+        cache = std::make_unique<ModuleCache>(moduleCacheDir);
+        resolver.setCache(cache.get());
     }
+    auto modules = resolver.resolveModules(filename);
 
-    // 타입 체크 단계 추가
-    typeCheck(programAST.get(), filename);
-
-    // Generate IR for entire program
-    llvm::Value* result = programAST->codegen();
-    if (!result) {
-        throw std::runtime_error("코드 생성 실패");
+    auto& codeGen = getCodeGen();
+    ModuleCompiler compiler(codeGen, optLevel);
+    for (size_t i = 0; i + 1 < modules.size(); ++i) {
+        compiler.compileLibrary(*modules[i]);
     }
+    compiler.compileEntry(*modules.back());
     
     // 함수 종료 처리: return 0 (i32)
-    auto& codeGen = getCodeGen();
     llvm::Value* zero = llvm::ConstantInt::get(llvm::Type::getInt32Ty(codeGen.getContext()), 0);
     codeGen.getBuilder().CreateRet(zero);
+
+    // 최적화 파이프라인 실행 (-O0이면 생성된 IR 그대로 출력)
+    if (optLevel > 0) {
+        codeGen.optimize(optLevel);
+    }
+    compiler.link();
 }
 
 void saveIRToFile(const std::string& outputFile) {
@@ -160,6 +227,62 @@ void saveIRToFile(const std::string& outputFile) {
     outFile.close();
 }
 
+// 시스템 C 컴파일러 드라이버로 오브젝트 파일을 링크 (libc의 printf/malloc 사용)
+void linkExecutable(const std::string& objectFile, const std::string& outputFile) {
+    std::string linker;
+    for (const char* name : {"cc", "clang", "gcc"}) {
+        if (auto path = llvm::sys::findProgramByName(name)) {
+            linker = *path;
+            break;
+        }
+    }
+    if (linker.empty()) {
+        throw std::runtime_error("링커를 찾을 수 없습니다 (cc, clang, gcc)");
+    }
+    
+    llvm::SmallVector<llvm::StringRef, 4> args = {linker, objectFile, "-o", outputFile};
+    std::string errMsg;
+    int rc = llvm::sys::ExecuteAndWait(linker, args, /*Env=*/{}, /*Redirects=*/{},
+                                       /*SecondsToWait=*/0, /*MemoryLimit=*/0, &errMsg);
+    if (rc != 0) {
+        throw std::runtime_error("링크 실패: " + (errMsg.empty() ? linker : errMsg));
+    }
+}
+
+void emitOutput(const CompilerOptions& options) {
+    auto& codeGen = getCodeGen();
+    switch (options.emit) {
+        case EmitKind::IR:
+            saveIRToFile(options.outputFile);
+            std::cout << "IR이 생성되었습니다: " << options.outputFile << std::endl;
+            break;
+        case EmitKind::Assembly:
+            codeGen.writeAssemblyFile(options.outputFile);
+            std::cout << "어셈블리가 생성되었습니다: " << options.outputFile << std::endl;
+            break;
+        case EmitKind::Object:
+            codeGen.writeObjectFile(options.outputFile);
+            std::cout << "오브젝트 파일이 생성되었습니다: " << options.outputFile << std::endl;
+            break;
+        case EmitKind::Executable: {
+            llvm::SmallString<128> objPath;
+            if (auto ec = llvm::sys::fs::createTemporaryFile("arithc", "o", objPath)) {
+                throw std::runtime_error("임시 파일을 만들 수 없습니다: " + ec.message());
+            }
+            try {
+                codeGen.writeObjectFile(std::string(objPath));
+                linkExecutable(std::string(objPath), options.outputFile);
+            } catch (...) {
+                llvm::sys::fs::remove(objPath);
+                throw;
+            }
+            llvm::sys::fs::remove(objPath);
+            std::cout << "실행파일이 생성되었습니다: " << options.outputFile << std::endl;
+            break;
+        }
+    }
+}
+
 int main(int argc, char* argv[]) {
     try {
         // 명령행 처리
@@ -167,21 +290,25 @@ int main(int argc, char* argv[]) {
         
         // LLVM 함수 설정
         setupLLVMFunction(options.inputFile);
+        getCodeGen().setTargetCPU(options.targetCPU, options.targetFeatures);
         
         // 소스 컴파일
-        compileSource("", options.inputFile);
+        compileSource(options.inputFile, options.moduleCacheDir, options.optLevel);
         
-        // IR 저장
-        saveIRToFile(options.outputFile);
+        // JIT 실행: main의 반환값을 종료 코드로 사용
+        if (options.run) {
+            return runWithJIT(getCodeGen(), options.lazyJIT);
+        }
         
-        std::cout << "IR이 생성되었습니다: " << options.outputFile << std::endl;
+        // IR / 어셈블리 / 오브젝트 / 실행파일 저장
+        emitOutput(options);
         
     } catch (const std::exception& e) {
         // Try to detect ParseError via dynamic_cast
         try {
             throw; // rethrow
         } catch (const ParseError& pe) {
-            printParseError(pe, readFile(pe.loc.file));
+            printParseError(pe);
             return 1;
         } catch (const std::exception& ex) {
             std::cerr << "오류: " << ex.what() << std::endl;
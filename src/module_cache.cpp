@@ -0,0 +1,512 @@
+#include "module_cache.h"
+#include "ast_visitor.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#ifndef ARITHC_VERSION
+#define ARITHC_VERSION "unknown"
+#endif
+
+// Entry layout (host byte order; a cache is not meant to move between machines):
+//   "AKMC" u32 format, str compilerVersion, u64 sourceSize, u64 sourceHash, u64 payloadHash
+//   u32 stringCount, str...   every name and literal, each once
+//   node                      the ProgramAST, preorder
+// where str = u32 length + bytes, a node is a u8 NodeKind (kNullNode for none) followed by
+// its fields and children, names are u32 string indices and a location is its offset in
+// the source + 1 (0 = invalid). payloadHash is the xxHash64 of everything after the header.
+static constexpr char kMagic[4] = {'A', 'K', 'M', 'C'};
+static constexpr uint32_t kModuleCacheFormat = 2;
+static constexpr uint8_t kNullNode = 0xFF;
+
+static uint64_t hashSource(const SourceManager::Buffer& source) {
+    return llvm::xxHash64(llvm::StringRef(source.text.data(), source.text.size()));
+}
+
+namespace {
+
+class ModuleWriter : public ASTVisitor<ModuleWriter> {
+public:
+    explicit ModuleWriter(const SourceManager::Buffer& source) : source(source) {}
+
+    // Whole entry, or an empty string if the tree can't be encoded relative to source
+    std::string write(ProgramAST& program, uint64_t sourceHash) {
+        node(&program);
+        if (!valid) return {};
+
+        std::string payload;
+        append(payload, static_cast<uint32_t>(strings.size()));
+        for (auto s : strings) appendString(payload, s);
+        payload += body;
+
+        std::string out(kMagic, sizeof(kMagic));
+        append(out, kModuleCacheFormat);
+        appendString(out, ARITHC_VERSION);
+        append(out, static_cast<uint64_t>(source.text.size()));
+        append(out, sourceHash);
+        append(out, llvm::xxHash64(payload));
+        out += payload;
+        return out;
+    }
+
+    void visitNumber(NumberExprAST* n) {
+        loc(n->getLiteralLocation());
+        put(n->getValue());
+    }
+    void visitVariable(VariableExprAST* n) {
+        loc(n->getNameLocation());
+        str(n->getName());
+    }
+    void visitStringLiteral(StringLiteralAST* n) {
+        loc(n->getLiteralLocation());
+        str(n->getValue());
+    }
+    void visitUnary(UnaryExprAST* n) {
+        put(n->getOperator());
+        loc(n->getOperatorLocation());
+        node(n->getOperand());
+    }
+    void visitBinary(BinaryExprAST* n) {
+        put(n->getOperator());
+        loc(n->getOperatorLocation());
+        node(n->getLHS());
+        node(n->getRHS());
+    }
+    void visitAssignment(AssignmentExprAST* n) {
+        put<uint8_t>(n->isMutableDeclaration());
+        put(n->getAssignmentType());
+        loc(n->getNameLocation());
+        str(n->getVarName());
+        node(n->getValue());
+    }
+    void visitFunctionLiteral(FunctionLiteralAST* n) {
+        put<uint8_t>(n->isExpressionFunction());
+        loc(n->getFnLocation());
+        put(static_cast<uint32_t>(n->getParams().size()));
+        for (const auto& p : n->getParams()) {
+            str(p.name);
+            put<uint8_t>(p.is_mutable);
+            loc(p.location);
+        }
+        put(static_cast<uint32_t>(n->getCaptures().size()));
+        for (const auto& c : n->getCaptures()) {
+            str(c.name);
+            put<uint8_t>(c.is_mutable_capture);
+            loc(c.location);
+        }
+        node(n->getBody());
+        // resolveClosures() results, so a cached tree needs no re-walk
+        str(n->getSelfName());
+        put(static_cast<uint32_t>(n->getFreeVars().size()));
+        for (auto name : n->getFreeVars()) str(name);
+    }
+    void visitFunctionCall(FunctionCallAST* n) {
+        loc(n->getCallLocation());
+        node(n->getCallee());
+        list(n->getArgs());
+    }
+    void visitPrint(PrintStmtAST* n) {
+        loc(n->getPrintLocation());
+        node(n->getFormatExpr());
+        list(n->getArgs());
+    }
+    void visitIf(IfStmtAST* n) {
+        loc(n->getIfLocation());
+        node(n->getCondition());
+        node(n->getThenStmt());
+        node(n->getElseStmt());
+    }
+    void visitWhile(WhileStmtAST* n) {
+        loc(n->getWhileLocation());
+        node(n->getCondition());
+        node(n->getBody());
+    }
+    void visitBlock(BlockAST* n) { list(n->getStatements()); }
+    void visitReturn(ReturnStmtAST* n) {
+        loc(n->getReturnLocation());
+        node(n->getValue());
+    }
+    void visitImport(ImportStmtAST* n) {
+        put(n->getImportType());
+        loc(n->getLocation());
+        str(n->getModuleName());
+        str(n->getAlias());
+        put(static_cast<uint32_t>(n->getSymbols().size()));
+        for (const auto& s : n->getSymbols()) {
+            str(s.name);
+            str(s.alias);
+        }
+    }
+    void visitExport(ExportStmtAST* n) {
+        put(n->getExportType());
+        loc(n->getLocation());
+        put(static_cast<uint32_t>(n->getSymbols().size()));
+        for (const auto& s : n->getSymbols()) {
+            str(s.name);
+            str(s.alias);
+        }
+        node(n->getDeclaration());
+    }
+    void visitProgram(ProgramAST* n) {
+        list(n->getImports());
+        list(n->getExports());
+        list(n->getStatements());
+    }
+
+private:
+    const SourceManager::Buffer& source;
+    std::string body;
+    std::vector<std::string_view> strings;
+    std::unordered_map<std::string_view, uint32_t> stringIds;
+    bool valid = true;
+
+    template <typename T>
+    static void append(std::string& out, T value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+    static void appendString(std::string& out, std::string_view s) {
+        append(out, static_cast<uint32_t>(s.size()));
+        out.append(s.data(), s.size());
+    }
+
+    template <typename T>
+    void put(T value) { append(body, value); }
+    void str(std::string_view s) {
+        auto [it, inserted] = stringIds.try_emplace(s, static_cast<uint32_t>(strings.size()));
+        if (inserted) strings.push_back(s);
+        put(it->second);
+    }
+    void loc(SourceLoc l) {
+        if (!l.isValid()) {
+            put<uint32_t>(0);
+            return;
+        }
+        // Only locations inside this module's own buffer can be rebased on load
+        if (l.raw < source.base || l.raw - source.base > source.text.size()) valid = false;
+        put<uint32_t>(l.raw - source.base + 1);
+    }
+    void node(ASTNode* n) {
+        if (!n) {
+            put(kNullNode);
+            return;
+        }
+        put(static_cast<uint8_t>(n->getKind()));
+        visit(n);
+    }
+    template <typename T>
+    void list(ASTSpan<T*> items) {
+        put(static_cast<uint32_t>(items.size()));
+        for (auto* item : items) node(item);
+    }
+};
+
+// Every read is bounds-checked; the first bad byte clears ok and the whole entry is rejected
+class ModuleReader {
+public:
+    ModuleReader(std::string_view data, const SourceManager::Buffer& source)
+        : cur(data.data()), end(data.data() + data.size()), source(source),
+          context(std::make_unique<ASTContext>()) {}
+
+    std::unique_ptr<ProgramAST> read(uint64_t sourceHash) {
+        if (size_t(end - cur) < sizeof(kMagic) || std::memcmp(cur, kMagic, sizeof(kMagic)) != 0) return nullptr;
+        cur += sizeof(kMagic);
+        if (get<uint32_t>() != kModuleCacheFormat || rawString() != ARITHC_VERSION ||
+            get<uint64_t>() != source.text.size() || get<uint64_t>() != sourceHash || !ok) {
+            return nullptr;
+        }
+        // The header only says which source the entry claims to be for; this covers the tree
+        uint64_t payloadHash = get<uint64_t>();
+        if (!ok || llvm::xxHash64(llvm::StringRef(cur, size_t(end - cur))) != payloadHash) return nullptr;
+
+        uint32_t stringCount = count();
+        strings.reserve(stringCount);
+        for (uint32_t i = 0; i < stringCount && ok; ++i) {
+            std::string_view s = rawString();
+            strings.push_back(s.empty() ? std::string_view{} : context->intern(s));
+        }
+
+        if (get<uint8_t>() != static_cast<uint8_t>(NodeKind::Program)) return nullptr;
+        auto imports = list<ImportStmtAST>();
+        auto exports = list<ExportStmtAST>();
+        auto statements = list<ASTNode>();
+        if (!ok || cur != end) return nullptr;
+        return std::make_unique<ProgramAST>(std::move(context), imports, exports, statements);
+    }
+
+private:
+    const char* cur;
+    const char* end;
+    const SourceManager::Buffer& source;
+    std::unique_ptr<ASTContext> context;
+    std::vector<std::string_view> strings;
+    bool ok = true;
+
+    template <typename T>
+    T get() {
+        T value{};
+        if (size_t(end - cur) < sizeof(T)) {
+            ok = false;
+            return value;
+        }
+        std::memcpy(&value, cur, sizeof(T));
+        cur += sizeof(T);
+        return value;
+    }
+    // Element count; every element takes at least a byte, which bounds bogus counts
+    uint32_t count() {
+        uint32_t n = get<uint32_t>();
+        if (n > size_t(end - cur)) ok = false;
+        return ok ? n : 0;
+    }
+    std::string_view rawString() {
+        uint32_t n = get<uint32_t>();
+        if (n > size_t(end - cur)) {
+            ok = false;
+            return {};
+        }
+        std::string_view s(cur, n);
+        cur += n;
+        return s;
+    }
+    std::string_view str() {
+        uint32_t id = get<uint32_t>();
+        if (id >= strings.size()) {
+            ok = false;
+            return {};
+        }
+        return strings[id];
+    }
+    SourceLoc loc() {
+        uint32_t v = get<uint32_t>();
+        if (v == 0) return SourceLoc{};
+        if (v - 1 > source.text.size()) {
+            ok = false;
+            return SourceLoc{};
+        }
+        return source.getLoc(v - 1);
+    }
+    bool flag() { return get<uint8_t>() != 0; }
+    template <typename E>
+    E enumValue(E last) {
+        auto v = get<uint8_t>();
+        if (v > static_cast<uint8_t>(last)) ok = false;
+        return static_cast<E>(v);
+    }
+
+    ExprAST* expr(bool optional = false) {
+        ASTNode* n = node();
+        if (n ? !isa<ExprAST>(n) : !optional) ok = false;
+        return ok ? static_cast<ExprAST*>(n) : nullptr;
+    }
+    ASTNode* stmt(bool optional = false) {
+        ASTNode* n = node();
+        if (!n && !optional) ok = false;
+        return ok ? n : nullptr;
+    }
+    template <typename T>
+    ASTSpan<T*> list() {
+        uint32_t n = count();
+        std::vector<T*> items;
+        items.reserve(n);
+        for (uint32_t i = 0; i < n && ok; ++i) {
+            ASTNode* item = node();
+            if constexpr (std::is_same_v<T, ASTNode>) {
+                if (!item) ok = false;
+                items.push_back(item);
+            } else {
+                if (!isa<T>(item)) ok = false;
+                items.push_back(static_cast<T*>(item));
+            }
+        }
+        return ok ? context->copySpan(items) : ASTSpan<T*>{};
+    }
+    template <typename Symbol>
+    ASTSpan<Symbol> symbols() {
+        uint32_t n = count();
+        std::vector<Symbol> items;
+        items.reserve(n);
+        for (uint32_t i = 0; i < n && ok; ++i) {
+            auto name = str();
+            auto alias = str();
+            items.push_back(Symbol{name, alias});
+        }
+        return context->copySpan(items);
+    }
+
+    // Fields are read into locals first: argument evaluation order is unspecified
+    ASTNode* node() {
+        uint8_t tag = get<uint8_t>();
+        if (!ok || tag == kNullNode) return nullptr;
+        switch (static_cast<NodeKind>(tag)) {
+        case NodeKind::Number: {
+            auto l = loc();
+            auto value = get<double>();
+            return context->create<NumberExprAST>(value, l);
+        }
+        case NodeKind::Variable: {
+            auto l = loc();
+            auto name = str();
+            return context->create<VariableExprAST>(name, l);
+        }
+        case NodeKind::StringLiteral: {
+            auto l = loc();
+            auto value = str();
+            return context->create<StringLiteralAST>(value, l);
+        }
+        case NodeKind::Unary: {
+            auto op = get<char>();
+            auto l = loc();
+            auto* operand = expr();
+            return context->create<UnaryExprAST>(op, operand, l);
+        }
+        case NodeKind::Binary: {
+            auto op = get<char>();
+            auto l = loc();
+            auto* lhs = expr();
+            auto* rhs = expr();
+            return context->create<BinaryExprAST>(op, lhs, rhs, l);
+        }
+        case NodeKind::Assignment: {
+            bool isMut = flag();
+            auto type = enumValue(AssignmentType::SHADOWING);
+            auto l = loc();
+            auto name = str();
+            auto* value = expr();
+            return context->create<AssignmentExprAST>(name, value, isMut, type, l);
+        }
+        case NodeKind::FunctionLiteral: {
+            bool isExpression = flag();
+            auto l = loc();
+            std::vector<FunctionParameter> params(count());
+            for (auto& p : params) {
+                p.name = str();
+                p.is_mutable = flag();
+                p.location = loc();
+            }
+            std::vector<CapturedVariable> captures(count());
+            for (auto& c : captures) {
+                c.name = str();
+                c.is_mutable_capture = flag();
+                c.location = loc();
+            }
+            auto* body = stmt();
+            auto selfName = str();
+            std::vector<std::string_view> freeVars(count());
+            for (auto& name : freeVars) name = str();
+            auto* fn = context->create<FunctionLiteralAST>(context->copySpan(params), context->copySpan(captures),
+                                                           body, isExpression, l);
+            fn->setSelfName(selfName);
+            fn->setFreeVars(context->copySpan(freeVars));
+            return fn;
+        }
+        case NodeKind::FunctionCall: {
+            auto l = loc();
+            auto* callee = expr();
+            auto args = list<ExprAST>();
+            return context->create<FunctionCallAST>(callee, args, l);
+        }
+        case NodeKind::Print: {
+            auto l = loc();
+            auto* format = expr();
+            auto args = list<ExprAST>();
+            return context->create<PrintStmtAST>(format, args, l);
+        }
+        case NodeKind::If: {
+            auto l = loc();
+            auto* condition = expr();
+            auto* thenStmt = stmt();
+            auto* elseStmt = stmt(/*optional=*/true);
+            return context->create<IfStmtAST>(condition, thenStmt, elseStmt, l);
+        }
+        case NodeKind::While: {
+            auto l = loc();
+            auto* condition = expr();
+            auto* body = stmt();
+            return context->create<WhileStmtAST>(condition, body, l);
+        }
+        case NodeKind::Block:
+            return context->create<BlockAST>(list<ASTNode>());
+        case NodeKind::Return: {
+            auto l = loc();
+            auto* value = expr(/*optional=*/true);
+            return context->create<ReturnStmtAST>(value, l);
+        }
+        case NodeKind::Import: {
+            auto type = enumValue(ImportType::Default);
+            auto l = loc();
+            auto moduleName = str();
+            auto alias = str();
+            auto syms = symbols<ImportedSymbol>();
+            return context->create<ImportStmtAST>(moduleName, type, syms, alias, l);
+        }
+        case NodeKind::Export: {
+            auto type = enumValue(ExportType::Assignment);
+            auto l = loc();
+            auto syms = symbols<ExportedSymbol>();
+            auto* declaration = stmt(/*optional=*/true);
+            return context->create<ExportStmtAST>(type, syms, declaration, l);
+        }
+        case NodeKind::Program:  // only at the root
+            break;
+        }
+        ok = false;
+        return nullptr;
+    }
+};
+
+} // namespace
+
+std::string serializeModule(ProgramAST& program, const SourceManager::Buffer& source) {
+    return ModuleWriter(source).write(program, hashSource(source));
+}
+
+std::unique_ptr<ProgramAST> deserializeModule(std::string_view data, const SourceManager::Buffer& source) {
+    return ModuleReader(data, source).read(hashSource(source));
+}
+
+std::string ModuleCache::entryPath(uint64_t sourceHash) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.kmc", static_cast<unsigned long long>(sourceHash));
+    llvm::SmallString<128> path(directory);
+    llvm::sys::path::append(path, name);
+    return std::string(path);
+}
+
+std::unique_ptr<ProgramAST> ModuleCache::load(const SourceManager::Buffer& source) const {
+    const uint64_t hash = hashSource(source);
+    auto file = llvm::MemoryBuffer::getFile(entryPath(hash), /*IsText=*/false, /*RequiresNullTerminator=*/false);
+    if (!file) return nullptr;
+    llvm::StringRef data = (*file)->getBuffer();
+    // Names are copied into the tree's arena, so the mapping can go when this returns
+    return ModuleReader(std::string_view(data.data(), data.size()), source).read(hash);
+}
+
+void ModuleCache::store(const SourceManager::Buffer& source, ProgramAST& program) const {
+    const uint64_t hash = hashSource(source);
+    std::string data = ModuleWriter(source).write(program, hash);
+    if (data.empty() || llvm::sys::fs::create_directories(directory)) return;
+
+    // Write a private file and rename it into place, so readers never see a partial entry
+    const std::string path = entryPath(hash);
+    int fd = -1;
+    llvm::SmallString<128> tmpPath;
+    if (llvm::sys::fs::createUniqueFile(path + ".%%%%%%%%.tmp", fd, tmpPath)) return;
+    bool written;
+    {
+        llvm::raw_fd_ostream out(fd, /*shouldClose=*/true);
+        out << data;
+        out.close();
+        written = !out.has_error();
+        out.clear_error();
+    }
+    if (!written || llvm::sys::fs::rename(tmpPath, path)) llvm::sys::fs::remove(tmpPath);
+}
@@ -0,0 +1,214 @@
+#include "module_compiler.h"
+#include "codegen.h"
+#include "parser.h" // for ParseError
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Transforms/IPO/Internalize.h"
+#include <cctype>
+#include <filesystem>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+
+// One importable name of a module and the module-level binding it exports
+struct ExportedName {
+    std::string_view name;
+    std::string_view local;
+    SourceLoc loc;
+};
+
+std::vector<ExportedName> collectExports(ProgramAST* program) {
+    std::vector<ExportedName> names;
+    auto add = [&](std::string_view name, std::string_view local, SourceLoc loc) {
+        for (const auto& prior : names) {
+            if (prior.name == name) throw ParseError("duplicate export '" + std::string(name) + "'", loc);
+        }
+        names.push_back({name, local, loc});
+    };
+    for (const auto* exp : program->getExports()) {
+        // `export default expr;` is evaluated but cannot be imported by name
+        if (auto* assign = dyn_cast<AssignmentExprAST>(exp->getDeclaration())) {
+            add(assign->getVarName(), assign->getVarName(), assign->getNameLocation());
+        }
+        for (const auto& sym : exp->getSymbols()) {
+            add(sym.alias.empty() ? sym.name : sym.alias, sym.name, exp->getLocation());
+        }
+    }
+    return names;
+}
+
+// Type-check program with its imports bound; returns the type of each exported binding
+std::vector<ModuleBinding> checkModule(ProgramAST* program, const std::vector<ModuleBinding>& imports,
+                                       const std::vector<ExportedName>& exported) {
+    std::vector<ModuleBinding> exports;
+    for (const auto& exp : exported) exports.push_back(ModuleBinding{exp.local, exp.loc});
+    typeCheckModule(program, imports, exports);
+    return exports;
+}
+
+// "lib/math.k" -> "lib.math", "my-lib.k" -> "my_2Dlib": a separator becomes '.', and any other
+// byte but a letter or digit is escaped as _XX, so distinct (normalized) paths never collide
+std::string moduleSymbolPrefix(const std::string& filepath) {
+    static const char hex[] = "0123456789ABCDEF";
+    std::string_view path = filepath;
+    if (path.size() >= 2 && path.substr(path.size() - 2) == ".k") path.remove_suffix(2);
+    std::string prefix;
+    for (char c : path) {
+        auto byte = static_cast<unsigned char>(c);
+        if (c == '/' || c == std::filesystem::path::preferred_separator) {
+            prefix += '.';
+        } else if (std::isalnum(byte)) {
+            prefix += c;
+        } else {
+            prefix += '_';
+            prefix += hex[byte >> 4];
+            prefix += hex[byte & 0xF];
+        }
+    }
+    return prefix;
+}
+
+}  // namespace
+
+std::vector<ModuleBinding> ModuleCompiler::importTypes(const std::vector<Import>& imports) {
+    std::vector<ModuleBinding> bindings;
+    for (const auto& imp : imports) bindings.push_back(imp.binding);
+    return bindings;
+}
+
+std::vector<ModuleCompiler::Import> ModuleCompiler::resolveImports(const ModuleResolver::ResolvedModule& mod) const {
+    std::vector<Import> imports;
+    auto statements = mod.ast->getImports();
+    for (size_t i = 0; i < statements.size(); ++i) {
+        const ImportStmtAST* imp = statements[i];
+        if (imp->getImportType() != ImportType::Named) {
+            throw ParseError("only named imports are supported, e.g. import { x } from \"" +
+                             std::string(imp->getModuleName()) + "\"", imp->getLocation());
+        }
+        const Interface& source = interfaces.at(mod.dependencies[i]);
+        for (const auto& sym : imp->getSymbols()) {
+            auto it = source.exports.find(sym.name);
+            if (it == source.exports.end()) {
+                throw ParseError("'" + std::string(sym.name) + "' is not exported by module '" + source.name + "'",
+                                 imp->getLocation());
+            }
+            std::string_view local = sym.alias.empty() ? sym.name : sym.alias;
+            for (const auto& prior : imports) {
+                if (prior.binding.name == local) {
+                    throw ParseError("name '" + std::string(local) + "' imported multiple times", imp->getLocation());
+                }
+            }
+            imports.push_back({ModuleBinding{local, imp->getLocation(), it->second.type, it->second.paramCount},
+                               &it->second});
+        }
+    }
+    return imports;
+}
+
+void ModuleCompiler::bindImports(const std::vector<Import>& imports) {
+    llvm::Module& module = codeGen.getModule();
+    auto* doubleTy = llvm::Type::getDoubleTy(codeGen.getContext());
+    auto* ptrTy = llvm::PointerType::getUnqual(codeGen.getContext());
+    for (const auto& imp : imports) {
+        llvm::Constant* global = module.getOrInsertGlobal(imp.source->global, doubleTy);
+        codeGen.bindVariable(imp.binding.name, global, /*is_mutable=*/false, imp.binding.loc);
+        if (!imp.source->function.empty()) {
+            auto callee = module.getOrInsertFunction(imp.source->function, imp.source->functionType);
+            codeGen.setKnownFunction(imp.binding.name, llvm::cast<llvm::Function>(callee.getCallee()),
+                                     llvm::ConstantPointerNull::get(ptrTy));
+        }
+    }
+}
+
+void ModuleCompiler::compileLibrary(ModuleResolver::ResolvedModule& mod) {
+    auto imports = resolveImports(mod);
+    auto exported = collectExports(mod.ast.get());
+    auto exportTypes = checkModule(mod.ast.get(), importTypes(imports), exported);
+
+    llvm::LLVMContext& context = codeGen.getContext();
+    llvm::IRBuilder<>& builder = codeGen.getBuilder();
+    auto* doubleTy = llvm::Type::getDoubleTy(context);
+    std::string prefix = moduleSymbolPrefix(mod.filepath);
+
+    auto resumeAt = builder.saveIP();
+    auto previous = codeGen.swapModule(std::make_unique<llvm::Module>(mod.filepath, context));
+    llvm::Module& module = codeGen.getModule();
+    module.setSourceFileName(mod.filepath);
+
+    // ".." cannot occur in a prefix or an identifier, so this never clashes with an export
+    auto* init = llvm::Function::Create(llvm::FunctionType::get(llvm::Type::getVoidTy(context), false),
+                                        llvm::Function::ExternalLinkage, prefix + "..init", module);
+    builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", init));
+    bindImports(imports);
+    if (!mod.ast->codegen()) {
+        throw std::runtime_error("code generation failed for " + mod.filepath);
+    }
+
+    Interface& interface = interfaces[mod.filepath];
+    interface.name = mod.name;
+    for (size_t i = 0; i < exported.size(); ++i) {
+        std::string_view local = exported[i].local;
+        Export& out = interface.exports[std::string(exported[i].name)];
+        out.type = exportTypes[i].type;
+        out.paramCount = exportTypes[i].paramCount;
+        out.global = prefix + "." + std::string(exported[i].name);
+
+        auto* global = new llvm::GlobalVariable(module, doubleTy, /*isConstant=*/false,
+                                                llvm::GlobalValue::ExternalLinkage,
+                                                llvm::ConstantFP::get(doubleTy, 0.0), out.global);
+        builder.CreateStore(codeGen.emitVariableLoad(local), global);
+
+        llvm::Function* fn = codeGen.getNearestKnownFunction(local);
+        if (fn && llvm::isa_and_nonnull<llvm::ConstantPointerNull>(codeGen.getNearestKnownEnv(local))) {
+            // Exported under several names, or re-exported from an import: keep the first name
+            if (fn->hasLocalLinkage()) {
+                fn->setName(out.global + ".fn");
+                fn->setLinkage(llvm::GlobalValue::ExternalLinkage);
+            }
+            out.function = fn->getName().str();
+            out.functionType = fn->getFunctionType();
+        }
+    }
+    builder.CreateRetVoid();
+    codeGen.exitScope();  // clears the global scope for the next module
+
+    if (optLevel > 0) codeGen.optimize(optLevel);
+    libraries.push_back(codeGen.swapModule(std::move(previous)));
+    initFunctions.push_back(init->getName().str());
+    builder.restoreIP(resumeAt);
+}
+
+void ModuleCompiler::compileEntry(ModuleResolver::ResolvedModule& mod) {
+    auto imports = resolveImports(mod);
+    checkModule(mod.ast.get(), importTypes(imports), collectExports(mod.ast.get()));
+
+    llvm::Module& module = codeGen.getModule();
+    auto* initType = llvm::FunctionType::get(llvm::Type::getVoidTy(codeGen.getContext()), false);
+    for (const auto& name : initFunctions) {
+        codeGen.getBuilder().CreateCall(module.getOrInsertFunction(name, initType));
+    }
+    bindImports(imports);
+    if (!mod.ast->codegen()) {
+        throw std::runtime_error("code generation failed for " + mod.filepath);
+    }
+}
+
+void ModuleCompiler::link() {
+    if (libraries.empty()) return;
+    llvm::Module& program = codeGen.getModule();
+    for (auto& library : libraries) {
+        std::string name = library->getModuleIdentifier();
+        if (llvm::Linker::linkModules(program, std::move(library))) {
+            throw std::runtime_error("failed to link module " + name);
+        }
+    }
+    libraries.clear();
+
+    // The linked program is only entered through main: internal symbols let the post-link
+    // pass inline init functions and exported fns and fold the export globals away
+    llvm::internalizeModule(program, [](const llvm::GlobalValue& value) { return value.getName() == "main"; });
+    if (optLevel > 0) codeGen.optimizeLinked(optLevel);
+}
@@ -1,22 +1,16 @@
 #include "module_resolver.h"
 #include "parser.h"
-#include <fstream>
-#include <sstream>
-#include <stdexcept>
+#include "source_manager.h"
+#include <condition_variable>
+#include <deque>
 #include <filesystem>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
 
 namespace fs = std::filesystem;
 
-static std::string readFile(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        throw std::runtime_error("Cannot open file: " + filename);
-    }
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
-}
-
 std::string ModuleResolver::resolveModulePath(const std::string& moduleName, const std::string& currentFile) {
     // Basic resolution: assume moduleName is relative to currentFile's directory
     // or relative to current working directory if currentFile is empty.
@@ -32,84 +26,236 @@ std::string ModuleResolver::resolveModulePath(const std::string& moduleName, con
 
     fs::path currPath(currentFile);
     fs::path dir = currPath.parent_path();
-    fs::path targetPath = dir / filename;
+    // Normalized, so a file reached along different relative paths is still one module
+    fs::path targetPath = (dir / filename).lexically_normal();
     return targetPath.string();
 }
 
-void ModuleResolver::loadModule(const std::string& moduleName, const std::string& filepath, const SourceLocation& importLoc) {
-    if (modules.find(filepath) != modules.end()) {
-        // Already loaded or in progress
-        if (visiting.count(filepath)) {
-            throw ParseError("circular dependency detected: " + filepath, importLoc);
+// Work queue for the parse phase. The calling thread works too; helper threads are only
+// started while more modules are queued than there are idle workers, so a program without
+// imports never spawns one.
+class ModuleResolver::Loader {
+public:
+    explicit Loader(ModuleResolver& resolver) : resolver(resolver) {}
+
+    ~Loader() {
+        for (auto& t : helpers) t.join();
+    }
+
+    // Parse entryFile and everything it transitively imports
+    void run(const std::string& entryFile) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            enqueue(entryFile);
         }
-        return;
+        work();
     }
 
-    visiting.insert(filepath);
+private:
+    ModuleResolver& resolver;
+    std::mutex mutex;  // guards resolver.modules and everything below
+    std::condition_variable wake;
+    std::deque<ResolvedModule*> pending;
+    size_t busy = 0;  // workers currently parsing
+    std::vector<std::thread> helpers;
+
+    // Counts a worker as busy while it handles one module. The count is dropped with the
+    // mutex held even when the handling throws, so idle workers still see the queue drain.
+    class BusyScope {
+    public:
+        BusyScope(Loader& loader, std::unique_lock<std::mutex>& lock) : loader(loader), lock(lock) {
+            ++loader.busy;
+        }
+        ~BusyScope() {
+            if (!lock.owns_lock()) lock.lock();
+            if (--loader.busy == 0 && loader.pending.empty()) loader.wake.notify_all();
+        }
+        BusyScope(const BusyScope&) = delete;
+        BusyScope& operator=(const BusyScope&) = delete;
+
+    private:
+        Loader& loader;
+        std::unique_lock<std::mutex>& lock;
+    };
+
+    // Queue filepath unless it was already seen; mutex must be held
+    void enqueue(const std::string& filepath) {
+        auto& slot = resolver.modules[filepath];
+        if (slot) return;
+        try {
+            slot = std::make_unique<ResolvedModule>();
+            slot->filepath = filepath;
+            pending.push_back(slot.get());
+        } catch (...) {
+            // Leave no half-registered module behind: a later import queues it again
+            resolver.modules.erase(filepath);
+            throw;
+        }
+
+        const size_t idle = helpers.size() + 1 - busy;
+        if (pending.size() > idle && helpers.size() < resolver.maxHelperThreads) {
+            try {
+                helpers.emplace_back([this] { work(); });
+                return;
+            } catch (const std::system_error&) {
+                // Out of threads; the workers we have will get to it
+            }
+        }
+        wake.notify_one();
+    }
+
+    void work() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [this] { return !pending.empty() || busy == 0; });
+            if (pending.empty()) return;  // nothing queued and nobody left to queue more
+
+            ResolvedModule* mod = pending.front();
+            pending.pop_front();
+            BusyScope scope(*this, lock);
+            lock.unlock();
+            resolver.parseModule(*mod);
+            lock.lock();
+            try {
+                for (const auto& dep : mod->dependencies) enqueue(dep);
+            } catch (...) {
+                // Reported at the import site like any other failure of mod
+                mod->parseError = std::current_exception();
+            }
+        }
+    }
+};
+
+ModuleResolver::ModuleResolver() {
+    const unsigned hw = std::thread::hardware_concurrency();
+    maxHelperThreads = hw > 1 ? hw - 1 : 0;
+}
 
-    std::string source;
+// Runs on a worker thread; touches nothing but mod, the cache and the (thread-safe) source
+// manager.
+// Never throws: failures are recorded on mod and reported by orderModule, which knows the
+// import site.
+void ModuleResolver::parseModule(ResolvedModule& mod) {
+    const SourceManager::Buffer* source = nullptr;
     try {
-        source = readFile(filepath);
-    } catch (const std::exception& e) {
-        throw ParseError("module '" + moduleName + "' not found", importLoc);
+        source = &getSourceManager().loadFile(mod.filepath);
+    } catch (...) {
+        // Only a missing file is "not found"; anything else (unreadable, out of location
+        // space, ...) is reported with its own message
+        std::error_code ec;
+        if (!fs::exists(mod.filepath, ec) && !ec) return;
+        mod.found = true;
+        mod.parseError = std::current_exception();
+        return;
+    }
+    mod.found = true;
+
+    try {
+        if (cache) mod.ast = cache->load(*source);
+        if (!mod.ast) {
+            Lexer lexer(*source);
+            Parser parser(lexer);
+            mod.ast = parser.parseProgram();
+            if (cache) cache->store(*source, *mod.ast);
+        }
+
+        for (const auto* imp : mod.ast->getImports()) {
+            mod.dependencies.push_back(resolveModulePath(std::string(imp->getModuleName()), mod.filepath));
+        }
+    } catch (...) {
+        // Out of memory or a filesystem error in the cache count as a failure to load mod
+        mod.dependencies.clear();
+        mod.parseError = std::current_exception();
     }
+}
 
-    Lexer lexer(source, filepath);
-    Parser parser(lexer);
-    auto ast = parser.parseProgram();
+void ModuleResolver::orderModule(const std::string& moduleName, const std::string& filepath, SourceLoc importLoc) {
+    if (visiting.count(filepath)) {
+        throw ParseError("circular dependency detected: " + filepath, importLoc);
+    }
 
-    auto mod = std::make_unique<ResolvedModule>();
-    mod->name = moduleName;
-    mod->filepath = filepath;
+    auto& mod = *modules.at(filepath);
+    if (!mod.name.empty()) return;  // already ordered
+    mod.name = moduleName;
 
-    for (const auto& imp : ast->getImports()) {
-        std::string depPath = resolveModulePath(imp->getModuleName(), filepath);
-        mod->dependencies.push_back(depPath);
-        loadModule(imp->getModuleName(), depPath, imp->getLocation());
+    if (!mod.found) {
+        // The entry file has no import site; report it at its own first line
+        if (!importLoc.isValid()) {
+            throw ParseError("module '" + moduleName + "' not found", SourceLocation{filepath, 1, 1});
+        }
+        throw ParseError("module '" + moduleName + "' not found", importLoc);
+    }
+    if (mod.parseError) {
+        try {
+            std::rethrow_exception(mod.parseError);
+        } catch (const ParseError&) {
+            throw;
+        } catch (const std::exception& e) {
+            std::string message = "cannot load module '" + moduleName + "': " + e.what();
+            if (!importLoc.isValid()) throw ParseError(message, SourceLocation{filepath, 1, 1});
+            throw ParseError(message, importLoc);
+        }
     }
 
-    mod->ast = std::move(ast);
+    visiting.insert(filepath);
+    const auto& imports = mod.ast->getImports();
+    for (size_t i = 0; i < imports.size(); ++i) {
+        orderModule(std::string(imports[i]->getModuleName()), mod.dependencies[i], imports[i]->getLocation());
+    }
     visiting.erase(filepath);
-    modules[filepath] = std::move(mod);
     loadOrder.push_back(filepath);
 }
 
+std::vector<std::unique_ptr<ModuleResolver::ResolvedModule>> ModuleResolver::resolveModules(
+    const std::string& entryFile) {
+    Loader(*this).run(entryFile);
+    orderModule("main", entryFile, SourceLoc{});
+
+    std::vector<std::unique_ptr<ResolvedModule>> ordered;
+    ordered.reserve(loadOrder.size());
+    for (const auto& filepath : loadOrder) ordered.push_back(std::move(modules[filepath]));
+    modules.clear();
+    loadOrder.clear();
+    return ordered;
+}
+
 std::unique_ptr<ProgramAST> ModuleResolver::resolve(const std::string& entryFile) {
-    SourceLocation entryLoc{entryFile, 1, 1};
-    loadModule("main", entryFile, entryLoc);
+    auto ordered = resolveModules(entryFile);
 
-    std::vector<std::unique_ptr<ImportStmtAST>> combinedImports;
-    std::vector<std::unique_ptr<ExportStmtAST>> combinedExports;
-    std::vector<std::unique_ptr<ASTNode>> combinedStatements;
+    // The combined program takes over every module's arena, so the nodes stay where they are
+    auto context = std::make_unique<ASTContext>();
+    std::vector<ImportStmtAST*> combinedImports;
+    std::vector<ExportStmtAST*> combinedExports;
+    std::vector<ASTNode*> combinedStatements;
 
-    for (const auto& filepath : loadOrder) {
-        auto& mod = modules[filepath];
-        
-        auto imps = mod->ast->releaseImports();
-        for (auto& imp : imps) {
+    for (auto& mod : ordered) {
+        for (auto* imp : mod->ast->getImports()) {
             for (const auto& sym : imp->getSymbols()) {
                 if (!sym.alias.empty()) {
-                    auto varExpr = std::make_unique<VariableExprAST>(sym.name, imp->getLocation());
-                    auto assignExpr = std::make_unique<AssignmentExprAST>(
-                        sym.alias, std::move(varExpr),
+                    auto* varExpr = context->create<VariableExprAST>(sym.name, imp->getLocation());
+                    auto* assignExpr = context->create<AssignmentExprAST>(
+                        sym.alias, varExpr,
                         false, AssignmentType::DECLARATION, imp->getLocation()
                     );
-                    combinedStatements.push_back(std::move(assignExpr));
+                    combinedStatements.push_back(assignExpr);
                 }
             }
-            combinedImports.push_back(std::move(imp));
+            combinedImports.push_back(imp);
         }
         
-        auto exps = mod->ast->releaseExports();
-        for (auto& exp : exps) {
-            combinedExports.push_back(std::move(exp));
+        for (auto* exp : mod->ast->getExports()) {
+            combinedExports.push_back(exp);
         }
         
-        auto stmts = mod->ast->releaseStatements();
-        for (auto& stmt : stmts) {
-            combinedStatements.push_back(std::move(stmt));
+        for (auto* stmt : mod->ast->getStatements()) {
+            combinedStatements.push_back(stmt);
         }
+
+        context->absorb(*mod->ast->releaseContext());
     }
 
-    return std::make_unique<ProgramAST>(std::move(combinedImports), std::move(combinedExports), std::move(combinedStatements));
+    auto importSpan = context->copySpan(combinedImports);
+    auto exportSpan = context->copySpan(combinedExports);
+    auto statementSpan = context->copySpan(combinedStatements);
+    return std::make_unique<ProgramAST>(std::move(context), importSpan, exportSpan, statementSpan);
 }
@@ -0,0 +1,70 @@
+#include "number_parse.h"
+#include <cfloat>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+namespace {
+constexpr double kPow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+constexpr uint64_t kMaxExactMantissa = uint64_t(1) << 53;
+constexpr int kMaxExactPow10 = 22;
+constexpr int kMaxMantissaDigits = 19;  // always fits in a uint64
+
+double parseSlow(std::string_view text) {
+    double value = 0.0;
+#ifdef __cpp_lib_to_chars
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (result.ec == std::errc::result_out_of_range) {
+        throw std::runtime_error("Invalid number format: number out of range");
+    }
+#else
+    // strtod needs a terminated copy; only reached for long or huge literals
+    std::string copy(text);
+    char* end = nullptr;
+    value = std::strtod(copy.c_str(), &end);
+    if (value == HUGE_VAL) {
+        throw std::runtime_error("Invalid number format: number out of range");
+    }
+#endif
+    return value;
+}
+} // namespace
+
+double parseDecimalLiteral(std::string_view text) {
+    uint64_t mantissa = 0;
+    int digits = 0;     // significant digits accumulated into mantissa
+    int exponent = 0;   // value = mantissa * 10^exponent
+    bool fraction = false;
+
+    for (char c : text) {
+        if (c == '.') {
+            fraction = true;
+            continue;
+        }
+        const unsigned d = static_cast<unsigned>(c - '0');
+        if (mantissa == 0 && d == 0) {
+            if (fraction) --exponent;  // leading zeros only shift the exponent
+            continue;
+        }
+        if (digits == kMaxMantissaDigits) return parseSlow(text);
+        mantissa = mantissa * 10 + d;
+        ++digits;
+        if (fraction) --exponent;
+    }
+
+    if (mantissa == 0) return 0.0;
+#if FLT_EVAL_METHOD == 0
+    // Both operands exact, so the single IEEE operation rounds correctly
+    if (mantissa <= kMaxExactMantissa && exponent >= -kMaxExactPow10 && exponent <= kMaxExactPow10) {
+        const double m = static_cast<double>(mantissa);
+        return exponent < 0 ? m / kPow10[-exponent] : m * kPow10[exponent];
+    }
+#endif
+    return parseSlow(text);
+}
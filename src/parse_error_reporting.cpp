@@ -18,7 +18,7 @@ std::string getLine(const std::string& source, int lineNumber) {
     return source.substr(lineStart, lineEnd - lineStart);
 }
 
-void printParseError(const ParseError& e, const std::string& source) {
+static void printDiagnostic(const ParseError& e, std::string_view lineStr) {
     const auto& L = e.loc;
     // Split e.what() by newlines to support multi-line diagnostics
     std::string what = e.what();
@@ -40,9 +40,8 @@ void printParseError(const ParseError& e, const std::string& source) {
                  L.file.c_str(), L.line, L.column, header);
 
     // Source preview with caret under the offending column
-    const auto lineStr = getLine(source, L.line);
     if (!lineStr.empty()) {
-        std::fprintf(stderr, "%s\n", lineStr.c_str());
+        std::fprintf(stderr, "%.*s\n", static_cast<int>(lineStr.size()), lineStr.data());
         std::string caret;
         for (int i = 1; i < L.column; ++i) caret.push_back(' ');
         caret.push_back('^');
@@ -58,3 +57,14 @@ void printParseError(const ParseError& e, const std::string& source) {
         }
     }
 }
+
+void printParseError(const ParseError& e, const std::string& source) {
+    printDiagnostic(e, getLine(source, e.loc.line));
+}
+
+void printParseError(const ParseError& e) {
+    const auto& sm = getSourceManager();
+    const SourceManager::Buffer* buffer =
+        e.packedLoc.isValid() ? sm.getBufferFor(e.packedLoc) : sm.getBuffer(e.loc.file);
+    printDiagnostic(e, buffer ? sm.getLineText(*buffer, e.loc.line) : std::string_view{});
+}
@@ -1,181 +1,231 @@
 #include "parser.h"
 #include "function_ast.h"
+#include "closure_resolution.h"
+#include <array>
+#include <cassert>
+#include <cstdint>
 #include <stdexcept>
 
-Parser::Parser(Lexer& lexer) : lexer(lexer), currentToken(TOK_EOF), previousToken(TOK_EOF) {
+namespace {
+// AIDEV-NOTE: Binary operator table indexed by token type (offset so the negative named
+// tokens fit), so each token parseBinOpRHS examines costs one bounds-checked load.
+// Precedence 0 = not a binary operator; higher binds tighter.
+struct BinOpInfo {
+    uint8_t precedence = 0;
+    bool rightAssoc = false;
+};
+
+constexpr int kMinTokenType = TOK_DEFAULT;  // most negative TokenType
+constexpr int kBinOpTableSize = 128 - kMinTokenType;
+
+constexpr std::array<BinOpInfo, kBinOpTableSize> makeBinOpTable() {
+    std::array<BinOpInfo, kBinOpTableSize> table{};
+    auto set = [&](int tok, uint8_t prec) { table[tok - kMinTokenType] = BinOpInfo{prec, false}; };
     // Comparison operators (lowest precedence)
-    binOpPrecedence[TOK_EQ] = 5;
-    binOpPrecedence[TOK_NEQ] = 5;
-    binOpPrecedence[TOK_LT] = 5;
-    binOpPrecedence[TOK_LTE] = 5;
-    binOpPrecedence[TOK_GT] = 5;
-    binOpPrecedence[TOK_GTE] = 5;
-    
+    set(TOK_EQ, 5);
+    set(TOK_NEQ, 5);
+    set(TOK_LT, 5);
+    set(TOK_LTE, 5);
+    set(TOK_GT, 5);
+    set(TOK_GTE, 5);
     // Arithmetic operators
-    binOpPrecedence['+'] = 10;
-    binOpPrecedence['-'] = 10;
-    binOpPrecedence['*'] = 40;
-    binOpPrecedence['/'] = 40;
-    
-    getNextToken();
+    set(TOK_PLUS, 10);
+    set(TOK_MINUS, 10);
+    set(TOK_MULTIPLY, 40);
+    set(TOK_DIVIDE, 40);
+    return table;
+}
+
+constexpr auto kBinOps = makeBinOpTable();
+
+inline BinOpInfo binOpInfo(int tokenType) {
+    unsigned index = static_cast<unsigned>(tokenType - kMinTokenType);
+    return index < kBinOps.size() ? kBinOps[index] : BinOpInfo{};
+}
+} // namespace
+
+Parser::Parser(Lexer& lexer)
+    : lexer(lexer), ring(kRingSize, Token(TOK_EOF)), context(std::make_unique<ASTContext>()) {
+    // The slot before the first token stands in for the previous token
+    head = 1;
+    lexed = 1;
+    fillTokens(0);
+}
+
+// Lex a batch so that ring index head + needed is valid, or throw the lexer error in its way
+void Parser::fillTokens(size_t needed) {
+    assert(needed <= kMaxLookahead);
+    // Keep head - 1 (the previous token) intact
+    while (lexed - head < kRingSize - 1 && !lexError) {
+        Token& slot = ring[lexed & (kRingSize - 1)];
+        if (sawEOF) {
+            slot = ring[(lexed - 1) & (kRingSize - 1)];  // the lexer is not called again
+        } else {
+            try {
+                slot = lexer.getNextToken();
+            } catch (...) {
+                lexError = std::current_exception();
+                break;
+            }
+            sawEOF = slot.type == TOK_EOF;
+        }
+        ++lexed;
+    }
+    if (head + needed >= lexed) std::rethrow_exception(lexError);
 }
 
 int Parser::getTokenPrecedence() {
-    auto it = binOpPrecedence.find(currentToken.type);
-    if (it == binOpPrecedence.end()) return -1;
-    
-    int tokPrec = it->second;
-    if (tokPrec <= 0) return -1;
-    return tokPrec;
+    int tokPrec = binOpInfo(currentToken().type).precedence;
+    return tokPrec > 0 ? tokPrec : -1;
 }
 
-std::unique_ptr<ExprAST> Parser::parseNumberExpr() {
-    auto result = std::make_unique<NumberExprAST>(currentToken.numValue, currentToken.range.start);
+ExprAST* Parser::parseNumberExpr() {
+    auto* result = make<NumberExprAST>(currentToken().numValue, currentToken().range.start);
     getNextToken();
-    return std::move(result);
+    return result;
 }
 
-std::unique_ptr<ExprAST> Parser::parseParenExpr() {
+ExprAST* Parser::parseParenExpr() {
     getNextToken(); // consume '('
     auto v = parseExpression();
     if (!v) return nullptr;
     
-    if (currentToken.type != TOK_RPAREN)
+    if (currentToken().type != TOK_RPAREN)
         errorHere("Expected ')'");
     
     getNextToken(); // consume ')'
     return v;
 }
 
-std::unique_ptr<ExprAST> Parser::parseIdentifierExpr() {
-    std::string idName = currentToken.value;
-    SourceLocation idLoc = currentToken.range.start;
+ExprAST* Parser::parseIdentifierExpr() {
+    std::string_view idName = context->intern(currentToken().value);
+    SourceLoc idLoc = currentToken().range.start;
     getNextToken();
-    return std::make_unique<VariableExprAST>(idName, idLoc);
+    return make<VariableExprAST>(idName, idLoc);
 }
 
-std::unique_ptr<ExprAST> Parser::parseStringLiteral() {
-    std::string strValue = currentToken.value;
+ExprAST* Parser::parseStringLiteral() {
+    std::string_view strValue = context->intern(currentToken().value);
     getNextToken();
-    return std::make_unique<StringLiteralAST>(strValue, currentToken.range.start);
+    return make<StringLiteralAST>(strValue, currentToken().range.start);
 }
 
-std::unique_ptr<ExprAST> Parser::parsePostfixExpr() {
+ExprAST* Parser::parsePostfixExpr() {
     auto expr = parsePrimary();
     if (!expr) return nullptr;
 
-    while (currentToken.type == TOK_LPAREN) {
-        expr = parseFunctionCall(std::move(expr));
+    while (currentToken().type == TOK_LPAREN) {
+        expr = parseFunctionCall(expr);
         if (!expr) return nullptr;
     }
 
     return expr;
 }
 
-std::unique_ptr<ExprAST> Parser::parseFunctionCall(std::unique_ptr<ExprAST> callee) {
-    SourceLocation callLoc = currentToken.range.start; // location of '('
+ExprAST* Parser::parseFunctionCall(ExprAST* callee) {
+    SourceLoc callLoc = currentToken().range.start; // location of '('
     getNextToken(); // consume '('
 
-    std::vector<std::unique_ptr<ExprAST>> args;
-    if (currentToken.type != TOK_RPAREN) {
-        auto arg = parseExpression();
+    const size_t argsMark = listScratch.size();
+    if (currentToken().type != TOK_RPAREN) {
+        auto* arg = parseExpression();
         if (!arg) return nullptr;
-        args.push_back(std::move(arg));
+        listScratch.push_back(arg);
 
-        while (currentToken.type == TOK_COMMA) {
+        while (currentToken().type == TOK_COMMA) {
             getNextToken(); // consume ','
-            auto arg = parseExpression();
+            auto* arg = parseExpression();
             if (!arg) return nullptr;
-            args.push_back(std::move(arg));
+            listScratch.push_back(arg);
         }
     }
 
-    if (currentToken.type != TOK_RPAREN)
+    if (currentToken().type != TOK_RPAREN)
         errorHere("Expected ')' after function call arguments");
     getNextToken(); // consume ')'
 
-    return std::make_unique<FunctionCallAST>(std::move(callee), std::move(args), callLoc);
+    return make<FunctionCallAST>(callee, takeList<ExprAST>(argsMark), callLoc);
 }
 
-std::unique_ptr<ExprAST> Parser::parseUnaryExpr() {
-    if (currentToken.type == TOK_MINUS) {
+ExprAST* Parser::parseUnaryExpr() {
+    if (currentToken().type == TOK_MINUS) {
         char op = '-';
-        SourceLocation opLoc = currentToken.range.start;
+        SourceLoc opLoc = currentToken().range.start;
         getNextToken(); // consume the unary operator
-        auto operand = parsePostfixExpr();
+        auto* operand = parsePostfixExpr();
         if (!operand) return nullptr;
-        return std::make_unique<UnaryExprAST>(op, std::move(operand), opLoc);
+        return make<UnaryExprAST>(op, operand, opLoc);
     }
 
     return parsePostfixExpr();
 }
 
-std::unique_ptr<ExprAST> Parser::parseFunctionLiteral() {
-    SourceLocation fnLoc = currentToken.range.start;
+ExprAST* Parser::parseFunctionLiteral() {
+    SourceLoc fnLoc = currentToken().range.start;
     getNextToken(); // consume 'fn'
 
-    if (currentToken.type != TOK_LPAREN)
+    if (currentToken().type != TOK_LPAREN)
         errorHere("Expected '(' after 'fn'");
     getNextToken(); // consume '('
 
     // Parse a single parameter: [mut] identifier
     auto parseOneParam = [&]() -> FunctionParameter {
         bool is_mutable = false;
-        if (currentToken.type == TOK_MUT) {
+        if (currentToken().type == TOK_MUT) {
             is_mutable = true;
             getNextToken(); // consume 'mut'
         }
-        if (currentToken.type != TOK_IDENTIFIER)
+        if (currentToken().type != TOK_IDENTIFIER)
             errorHere("Expected parameter name in function parameter list");
-        FunctionParameter p{currentToken.value, is_mutable, currentToken.range.start};
+        FunctionParameter p{context->intern(currentToken().value), is_mutable, currentToken().range.start};
         getNextToken(); // consume identifier
         return p;
     };
 
     std::vector<FunctionParameter> params;
-    if (currentToken.type != TOK_RPAREN) {
+    if (currentToken().type != TOK_RPAREN) {
         params.push_back(parseOneParam());
 
-        while (currentToken.type == TOK_COMMA) {
+        while (currentToken().type == TOK_COMMA) {
             getNextToken(); // consume ','
 
-            if (currentToken.type == TOK_RPAREN)
+            if (currentToken().type == TOK_RPAREN)
                 errorHere("Trailing comma in parameter list");
 
             params.push_back(parseOneParam());
         }
     }
 
-    if (currentToken.type != TOK_RPAREN)
+    if (currentToken().type != TOK_RPAREN)
         errorHere("Expected ')' after function parameters");
     getNextToken(); // consume ')'
 
     // Parse optional capture clause: mut(var1, var2, ...)
-    std::vector<CapturedVariable> captures;
-    if (currentToken.type == TOK_MUT)
+    ASTSpan<CapturedVariable> captures;
+    if (currentToken().type == TOK_MUT)
         captures = parseCaptureClause();
 
-    if (currentToken.type == TOK_ARROW) {
+    if (currentToken().type == TOK_ARROW) {
         getNextToken(); // consume '=>'
 
-        auto bodyExpr = parseExpression();
+        auto* bodyExpr = parseExpression();
         if (!bodyExpr) return nullptr;
 
-        return std::make_unique<FunctionLiteralAST>(
-            std::move(params),
-            std::move(captures),
-            std::move(bodyExpr),
+        return make<FunctionLiteralAST>(
+            context->copySpan(params),
+            captures,
+            bodyExpr,
             true,
             fnLoc
         );
-    } else if (currentToken.type == TOK_LBRACE) {
+    } else if (currentToken().type == TOK_LBRACE) {
         functionDepth++;
-        auto body = parseBlock();
+        auto* body = parseBlock();
         functionDepth--;
-        return std::make_unique<FunctionLiteralAST>(
-            std::move(params),
-            std::move(captures),
-            std::move(body),
+        return make<FunctionLiteralAST>(
+            context->copySpan(params),
+            captures,
+            body,
             false,
             fnLoc
         );
@@ -184,63 +234,63 @@ std::unique_ptr<ExprAST> Parser::parseFunctionLiteral() {
     }
 }
 
-std::vector<CapturedVariable> Parser::parseCaptureClause() {
-    // currentToken is 'mut'; next must be '(' to form a capture clause
+ASTSpan<CapturedVariable> Parser::parseCaptureClause() {
+    // currentToken() is 'mut'; next must be '(' to form a capture clause
     getNextToken(); // consume 'mut'
 
-    if (currentToken.type != TOK_LPAREN)
+    if (currentToken().type != TOK_LPAREN)
         errorHere("Expected '(' after 'mut' in capture clause");
     getNextToken(); // consume '('
 
     std::vector<CapturedVariable> captures;
-    if (currentToken.type != TOK_RPAREN) {
-        if (currentToken.type != TOK_IDENTIFIER)
+    if (currentToken().type != TOK_RPAREN) {
+        if (currentToken().type != TOK_IDENTIFIER)
             errorHere("Expected variable name in capture clause");
-        captures.push_back({currentToken.value, true, currentToken.range.start});
+        captures.push_back({context->intern(currentToken().value), true, currentToken().range.start});
         getNextToken(); // consume identifier
 
-        while (currentToken.type == TOK_COMMA) {
+        while (currentToken().type == TOK_COMMA) {
             getNextToken(); // consume ','
-            if (currentToken.type == TOK_RPAREN)
+            if (currentToken().type == TOK_RPAREN)
                 errorHere("Trailing comma in capture clause");
-            if (currentToken.type != TOK_IDENTIFIER)
+            if (currentToken().type != TOK_IDENTIFIER)
                 errorHere("Expected variable name in capture clause");
-            captures.push_back({currentToken.value, true, currentToken.range.start});
+            captures.push_back({context->intern(currentToken().value), true, currentToken().range.start});
             getNextToken(); // consume identifier
         }
     }
 
-    if (currentToken.type != TOK_RPAREN)
+    if (currentToken().type != TOK_RPAREN)
         errorHere("Expected ')' after capture clause");
     getNextToken(); // consume ')'
 
-    return captures;
+    return context->copySpan(captures);
 }
 
-std::unique_ptr<ASTNode> Parser::parseReturnStatement() {
-    SourceLocation retLoc = currentToken.range.start;
+ASTNode* Parser::parseReturnStatement() {
+    SourceLoc retLoc = currentToken().range.start;
     if (functionDepth == 0)
         errorHere("'return' outside of function body");
     getNextToken(); // consume 'return'
 
     // bare return (no value)
-    if (currentToken.type == TOK_SEMICOLON) {
+    if (currentToken().type == TOK_SEMICOLON) {
         getNextToken(); // consume ';'
-        return std::make_unique<ReturnStmtAST>(nullptr, retLoc);
+        return make<ReturnStmtAST>(nullptr, retLoc);
     }
 
-    auto value = parseExpression();
+    auto* value = parseExpression();
     if (!value) return nullptr;
 
-    if (currentToken.type != TOK_SEMICOLON)
-        errorAt("Expected ';' after return statement", previousToken.range.end);
+    if (currentToken().type != TOK_SEMICOLON)
+        errorAt("Expected ';' after return statement", previousToken().range.end);
     getNextToken(); // consume ';'
 
-    return std::make_unique<ReturnStmtAST>(std::move(value), retLoc);
+    return make<ReturnStmtAST>(value, retLoc);
 }
 
-std::unique_ptr<ExprAST> Parser::parsePrimary() {
-    switch (currentToken.type) {
+ExprAST* Parser::parsePrimary() {
+    switch (currentToken().type) {
         case TOK_IDENTIFIER:
             return parseIdentifierExpr();
         case TOK_NUMBER:
@@ -258,64 +308,79 @@ std::unique_ptr<ExprAST> Parser::parsePrimary() {
     }
 }
 
-std::unique_ptr<ExprAST> Parser::parseBinOpRHS(int exprPrec, std::unique_ptr<ExprAST> lhs) {
+ExprAST* Parser::parseBinOpRHS(int exprPrec, ExprAST* lhs) {
     while (true) {
         int tokPrec = getTokenPrecedence();
         
         if (tokPrec < exprPrec)
             return lhs;
         
-        int binOp = currentToken.type;
-        SourceLocation opLoc = currentToken.range.start;
+        int binOp = currentToken().type;
+        const bool rightAssoc = binOpInfo(binOp).rightAssoc;
+        SourceLoc opLoc = currentToken().range.start;
         getNextToken();
         
-        auto rhs = parseUnaryExpr();
+        auto* rhs = parseUnaryExpr();
         if (!rhs) return nullptr;
         
+        // Let a tighter operator (or the same one, if right-associative) take rhs first
         int nextPrec = getTokenPrecedence();
-        if (tokPrec < nextPrec) {
-            rhs = parseBinOpRHS(tokPrec + 1, std::move(rhs));
+        if (tokPrec < nextPrec || (rightAssoc && tokPrec == nextPrec)) {
+            rhs = parseBinOpRHS(rightAssoc ? tokPrec : tokPrec + 1, rhs);
             if (!rhs) return nullptr;
         }
         
-        lhs = std::make_unique<BinaryExprAST>(binOp, std::move(lhs), std::move(rhs), opLoc);
+        lhs = make<BinaryExprAST>(binOp, lhs, rhs, opLoc);
     }
 }
 
-std::unique_ptr<ExprAST> Parser::parseAssignment() {
-    auto lhs = parseUnaryExpr();
+ExprAST* Parser::parseAssignment() {
+    // Plain `name = value` is recognized with one token of lookahead, without building
+    // the name's VariableExprAST only to discard it
+    if (currentToken().type == TOK_IDENTIFIER && peekToken(1).type == TOK_ASSIGN) {
+        std::string_view varName = context->intern(currentToken().value);
+        SourceLoc nameLoc = currentToken().range.start;
+        getNextToken(); // consume identifier
+        getNextToken(); // consume '='
+
+        auto* rhs = parseExpression();
+        if (!rhs) return nullptr;
+
+        return make<AssignmentExprAST>(varName, rhs, nameLoc);
+    }
+
+    auto* lhs = parseUnaryExpr();
     if (!lhs) return nullptr;
     
-    // Check if this is an assignment
-    if (currentToken.type == TOK_ASSIGN) {
-        // lhs must be a variable for assignment
-        auto* varExpr = dynamic_cast<VariableExprAST*>(lhs.get());
+    // Other assignment targets: only a (parenthesized) variable is valid
+    if (currentToken().type == TOK_ASSIGN) {
+        auto* varExpr = dyn_cast<VariableExprAST>(lhs);
         if (!varExpr) {
             // Point to the start of the LHS (previous token)
-            errorAt("Invalid assignment target", previousToken.range.start);
+            errorAt("Invalid assignment target", previousToken().range.start);
         }
         
-        std::string varName = varExpr->getName();
-        // location of variable name is in previousToken (identifier) when '=' is current
-        SourceLocation nameLoc = previousToken.range.start;
+        std::string_view varName = varExpr->getName();
+        // location of variable name is in previousToken() (identifier) when '=' is current
+        SourceLoc nameLoc = previousToken().range.start;
         getNextToken(); // consume '='
         
-        auto rhs = parseExpression();
+        auto* rhs = parseExpression();
         if (!rhs) return nullptr;
         
-        return std::make_unique<AssignmentExprAST>(varName, std::move(rhs), nameLoc);
+        return make<AssignmentExprAST>(varName, rhs, nameLoc);
     }
     
     // Not an assignment, parse as regular expression
-    return parseBinOpRHS(0, std::move(lhs));
+    return parseBinOpRHS(0, lhs);
 }
 
-std::unique_ptr<ExprAST> Parser::parseExpression() {
+ExprAST* Parser::parseExpression() {
     return parseAssignment();
 }
 
-std::unique_ptr<ASTNode> Parser::parseStatement() {
-    switch (currentToken.type) {
+ASTNode* Parser::parseStatement() {
+    switch (currentToken().type) {
         case TOK_PRINT:
             return parsePrintStatement();
         case TOK_IF:
@@ -328,38 +393,38 @@ std::unique_ptr<ASTNode> Parser::parseStatement() {
             // Handle mutable variable declaration: mut x = value;
             getNextToken(); // consume 'mut'
             
-            if (currentToken.type != TOK_IDENTIFIER) {
+            if (currentToken().type != TOK_IDENTIFIER) {
                 errorHere("Expected variable name after 'mut'");
             }
             
-            std::string varName = currentToken.value;
-            SourceLocation nameLoc = currentToken.range.start;
+            std::string_view varName = context->intern(currentToken().value);
+            SourceLoc nameLoc = currentToken().range.start;
             getNextToken(); // consume identifier
             
-            if (currentToken.type != TOK_ASSIGN) {
+            if (currentToken().type != TOK_ASSIGN) {
                 errorHere("Expected '=' after variable name in mutable declaration");
             }
             getNextToken(); // consume '='
             
-            auto value = parseExpression();
+            auto* value = parseExpression();
             if (!value) return nullptr;
             
             // Semicolon is required
-            if (currentToken.type != TOK_SEMICOLON) {
-                errorAt("Expected ';' after mutable variable declaration", previousToken.range.end);
+            if (currentToken().type != TOK_SEMICOLON) {
+                errorAt("Expected ';' after mutable variable declaration", previousToken().range.end);
             }
             getNextToken(); // consume ';'
             
-            return std::make_unique<AssignmentExprAST>(varName, std::move(value), true, AssignmentType::DECLARATION, nameLoc);
+            return make<AssignmentExprAST>(varName, value, true, AssignmentType::DECLARATION, nameLoc);
         }
         default: {
-            auto expr = parseExpression();
+            auto* expr = parseExpression();
             if (!expr) return nullptr;
             
             // Semicolon is required for expression statements
-            if (currentToken.type != TOK_SEMICOLON) {
+            if (currentToken().type != TOK_SEMICOLON) {
                 // Point to where ';' should be: end of the previous token
-                errorAt("Expected ';' after expression statement", previousToken.range.end);
+                errorAt("Expected ';' after expression statement", previousToken().range.end);
             }
             getNextToken(); // consume ';'
             
@@ -368,134 +433,128 @@ std::unique_ptr<ASTNode> Parser::parseStatement() {
     }
 }
 
-std::unique_ptr<ASTNode> Parser::parsePrintStatement() {
-    SourceLocation printLoc = currentToken.range.start;
+ASTNode* Parser::parsePrintStatement() {
+    SourceLoc printLoc = currentToken().range.start;
     getNextToken(); // consume 'print'
     
-    auto firstExpr = parseExpression();
+    auto* firstExpr = parseExpression();
     if (!firstExpr) return nullptr;
     
     // Check if there are additional arguments (comma-separated)
-    std::vector<std::unique_ptr<ExprAST>> args;
-    while (currentToken.type == TOK_COMMA) {
+    const size_t argsMark = listScratch.size();
+    while (currentToken().type == TOK_COMMA) {
         getNextToken(); // consume ','
-        auto arg = parseExpression();
+        auto* arg = parseExpression();
         if (!arg) return nullptr;
-        args.push_back(std::move(arg));
+        listScratch.push_back(arg);
     }
     
-    if (currentToken.type != TOK_SEMICOLON) {
+    if (currentToken().type != TOK_SEMICOLON) {
         // Point to where ';' should be: end of the previous token (end of last expr)
-        errorAt("Expected ';' after print statement", previousToken.range.end);
+        errorAt("Expected ';' after print statement", previousToken().range.end);
     }
     getNextToken(); // consume ';'
     
-    if (args.empty()) {
-        return std::make_unique<PrintStmtAST>(std::move(firstExpr), printLoc);
-    } else {
-        return std::make_unique<PrintStmtAST>(std::move(firstExpr), std::move(args), printLoc);
-    }
+    return make<PrintStmtAST>(firstExpr, takeList<ExprAST>(argsMark), printLoc);
 }
 
-std::unique_ptr<ASTNode> Parser::parseIfStatement() {
-    SourceLocation ifLoc = currentToken.range.start;
+ASTNode* Parser::parseIfStatement() {
+    SourceLoc ifLoc = currentToken().range.start;
     getNextToken(); // consume 'if'
     
-    if (currentToken.type != TOK_LPAREN) {
+    if (currentToken().type != TOK_LPAREN) {
         errorHere("Expected '(' after 'if'");
     }
     getNextToken(); // consume '('
     
-    auto condition = parseExpression();
+    auto* condition = parseExpression();
     if (!condition) return nullptr;
     
-    if (currentToken.type != TOK_RPAREN) {
+    if (currentToken().type != TOK_RPAREN) {
         errorHere("Expected ')' after if condition");
     }
     getNextToken(); // consume ')'
     
-    auto thenBlock = parseBlock();
+    auto* thenBlock = parseBlock();
     if (!thenBlock) return nullptr;
     
-    std::unique_ptr<ASTNode> elseBlock = nullptr;
-    if (currentToken.type == TOK_ELSE) {
+    ASTNode* elseBlock = nullptr;
+    if (currentToken().type == TOK_ELSE) {
         getNextToken(); // consume 'else'
     elseBlock = parseBlock();
         if (!elseBlock) return nullptr;
     } else {
     errorHere("Expected 'else' after 'if' statement");
     }
-    return std::make_unique<IfStmtAST>(std::move(condition), 
-                                       std::move(thenBlock), 
-                                       std::move(elseBlock), ifLoc);
+    return make<IfStmtAST>(condition, thenBlock, elseBlock, ifLoc);
 }
 
-std::unique_ptr<ASTNode> Parser::parseWhileStatement() {
-    SourceLocation whileLoc = currentToken.range.start;
+ASTNode* Parser::parseWhileStatement() {
+    SourceLoc whileLoc = currentToken().range.start;
     getNextToken(); // consume 'while'
     
-    if (currentToken.type != TOK_LPAREN) {
+    if (currentToken().type != TOK_LPAREN) {
         errorHere("Expected '(' after 'while'");
     }
     getNextToken(); // consume '('
     
-    auto condition = parseExpression();
+    auto* condition = parseExpression();
     if (!condition) return nullptr;
     
-    if (currentToken.type != TOK_RPAREN) {
+    if (currentToken().type != TOK_RPAREN) {
         errorHere("Expected ')' after while condition");
     }
     getNextToken(); // consume ')'
     
-    auto body = parseBlock();
+    auto* body = parseBlock();
     if (!body) return nullptr;
     
-    return std::make_unique<WhileStmtAST>(std::move(condition), 
-                                          std::move(body), whileLoc);
+    return make<WhileStmtAST>(condition, body, whileLoc);
 }
 
-std::unique_ptr<ASTNode> Parser::parseBlock() {
-    if (currentToken.type != TOK_LBRACE) {
+ASTNode* Parser::parseBlock() {
+    if (currentToken().type != TOK_LBRACE) {
         errorHere("Expected '{'");
     }
     getNextToken(); // consume '{'
     
-    std::vector<std::unique_ptr<ASTNode>> statements;
+    const size_t statementsMark = listScratch.size();
     
-    while (currentToken.type != TOK_RBRACE && currentToken.type != TOK_EOF) {
-        auto stmt = parseStatement();
+    while (currentToken().type != TOK_RBRACE && currentToken().type != TOK_EOF) {
+        auto* stmt = parseStatement();
         if (stmt) {
-            statements.push_back(std::move(stmt));
+            listScratch.push_back(stmt);
         } else {
             errorHere("Failed to parse statement in block");
         }
     }
     
-    if (currentToken.type != TOK_RBRACE) {
+    if (currentToken().type != TOK_RBRACE) {
         errorHere("Expected '}'");
     }
     getNextToken(); // consume '}'
     
-    return std::make_unique<BlockAST>(std::move(statements));
+    return make<BlockAST>(takeList<ASTNode>(statementsMark));
 }
 
 std::unique_ptr<ProgramAST> Parser::parseProgram() {
-    std::vector<std::unique_ptr<ImportStmtAST>> imports;
-    std::vector<std::unique_ptr<ExportStmtAST>> exports;
-    std::vector<std::unique_ptr<ASTNode>> statements;
+    // Top-level lists interleave, so they collect on the side rather than in listScratch
+    std::vector<ImportStmtAST*> imports;
+    std::vector<ExportStmtAST*> exports;
+    std::vector<ASTNode*> statements;
     
-    while (currentToken.type != TOK_EOF) {
+    while (currentToken().type != TOK_EOF) {
         try {
-            if (currentToken.type == TOK_IMPORT) {
-                auto imp = parseImportStatement();
-                if (imp) imports.push_back(std::move(imp));
-            } else if (currentToken.type == TOK_EXPORT) {
-                auto exp = parseExportStatement();
-                if (exp) exports.push_back(std::move(exp));
+            if (currentToken().type == TOK_IMPORT) {
+                auto* imp = parseImportStatement();
+                if (imp) imports.push_back(imp);
+            } else if (currentToken().type == TOK_EXPORT) {
+                auto* exp = parseExportStatement();
+                if (exp) exports.push_back(exp);
             } else {
-                auto stmt = parseStatement();
+                auto* stmt = parseStatement();
                 if (stmt) {
-                    statements.push_back(std::move(stmt));
+                    statements.push_back(stmt);
                 } else {
                     throw std::runtime_error("Failed to parse statement");
                 }
@@ -503,85 +562,91 @@ std::unique_ptr<ProgramAST> Parser::parseProgram() {
         } catch (const ParseError&) {
             throw;
         } catch (const std::runtime_error& e) {
-            throw ParseError(std::string(e.what()), currentToken.range.start);
+            throw ParseError(std::string(e.what()), currentToken().range.start);
         }
     }
     
-    return std::make_unique<ProgramAST>(std::move(imports), std::move(exports), std::move(statements));
+    auto importSpan = context->copySpan(imports);
+    auto exportSpan = context->copySpan(exports);
+    auto statementSpan = context->copySpan(statements);
+    auto program = std::make_unique<ProgramAST>(std::move(context), importSpan, exportSpan, statementSpan);
+    resolveClosures(program.get(), program->getContext());
+    return program;
 }
-std::unique_ptr<ImportStmtAST> Parser::parseImportStatement() {
-    SourceLocation loc = currentToken.range.start;
+
+ImportStmtAST* Parser::parseImportStatement() {
+    SourceLoc loc = currentToken().range.start;
     getNextToken(); // consume 'import'
     
     ImportType importType;
     std::vector<ImportedSymbol> symbols;
-    std::string alias;
+    std::string_view alias;
     
-    if (currentToken.type == '*') {
+    if (currentToken().type == '*') {
         importType = ImportType::Namespace;
         getNextToken(); // consume '*'
-        if (currentToken.type != TOK_AS)
+        if (currentToken().type != TOK_AS)
             errorHere("Expected 'as' after '*'");
         getNextToken(); // consume 'as'
-        if (currentToken.type != TOK_IDENTIFIER)
+        if (currentToken().type != TOK_IDENTIFIER)
             errorHere("Expected identifier after 'as'");
-        alias = currentToken.value;
+        alias = context->intern(currentToken().value);
         getNextToken(); // consume identifier
-    } else if (currentToken.type == TOK_LBRACE) {
+    } else if (currentToken().type == TOK_LBRACE) {
         importType = ImportType::Named;
         getNextToken(); // consume '{'
         
-        while (currentToken.type != TOK_RBRACE && currentToken.type != TOK_EOF) {
-            if (currentToken.type != TOK_IDENTIFIER && currentToken.type != TOK_MUT)
+        while (currentToken().type != TOK_RBRACE && currentToken().type != TOK_EOF) {
+            if (currentToken().type != TOK_IDENTIFIER && currentToken().type != TOK_MUT)
                 errorHere("Expected identifier or 'mut' in import list");
                 
             // If mut, we might want to support it: "import { mut x }" but let's just parse identifier for now.
             // Oh, specs says: import { mut global_counter }
             bool is_mut = false;
-            if (currentToken.type == TOK_MUT) {
+            if (currentToken().type == TOK_MUT) {
                 is_mut = true;
                 getNextToken();
             }
             
-            if (currentToken.type != TOK_IDENTIFIER)
+            if (currentToken().type != TOK_IDENTIFIER)
                 errorHere("Expected identifier in import list");
             
-            std::string name = currentToken.value;
-            std::string symAlias;
+            std::string_view name = context->intern(currentToken().value);
+            std::string_view symAlias;
             getNextToken(); // consume identifier
             
-            if (currentToken.type == TOK_AS) {
+            if (currentToken().type == TOK_AS) {
                 getNextToken(); // consume 'as'
-                if (currentToken.type != TOK_IDENTIFIER)
+                if (currentToken().type != TOK_IDENTIFIER)
                     errorHere("Expected identifier after 'as'");
-                symAlias = currentToken.value;
+                symAlias = context->intern(currentToken().value);
                 getNextToken(); // consume identifier
             }
             
             // To simplify, ImportedSymbol doesn't have is_mut flag yet, but let's assume mut goes with name if we change ast.h.
             symbols.push_back({name, symAlias});
             
-            if (currentToken.type == TOK_COMMA) {
+            if (currentToken().type == TOK_COMMA) {
                 getNextToken(); // consume ','
-            } else if (currentToken.type != TOK_RBRACE) {
+            } else if (currentToken().type != TOK_RBRACE) {
                 errorHere("Expected ',' or '}' in import list");
             }
         }
         
-        if (currentToken.type != TOK_RBRACE)
+        if (currentToken().type != TOK_RBRACE)
             errorHere("Expected '}' after import list");
         getNextToken(); // consume '}'
-    } else if (currentToken.type == TOK_IDENTIFIER) {
+    } else if (currentToken().type == TOK_IDENTIFIER) {
         // Could be default import or default + named: import default_logger, { PI } from "math"
         // Let's just implement simple default import for now
         importType = ImportType::Default;
-        alias = currentToken.value;
+        alias = context->intern(currentToken().value);
         getNextToken(); // consume identifier
         
-        if (currentToken.type == TOK_COMMA) {
+        if (currentToken().type == TOK_COMMA) {
             // Mixed import: import default_logger, { PI }
             getNextToken(); // consume ','
-            if (currentToken.type != TOK_LBRACE)
+            if (currentToken().type != TOK_LBRACE)
                 errorHere("Expected '{' after ',' in mixed import");
             // For now, simplify and just say mixed imports might need more AST support
             errorHere("Mixed imports are not fully supported yet");
@@ -590,68 +655,68 @@ std::unique_ptr<ImportStmtAST> Parser::parseImportStatement() {
         errorHere("Expected '*', '{', or identifier after 'import'");
     }
     
-    if (currentToken.type != TOK_FROM)
+    if (currentToken().type != TOK_FROM)
         errorHere("Expected 'from' in import statement");
     getNextToken(); // consume 'from'
     
-    if (currentToken.type != TOK_STRING)
+    if (currentToken().type != TOK_STRING)
         errorHere("Expected string literal module path");
-    std::string moduleName = currentToken.value;
+    std::string_view moduleName = context->intern(currentToken().value);
     getNextToken(); // consume string
     
-    if (currentToken.type != TOK_SEMICOLON)
-        errorAt("Expected ';' after import statement", previousToken.range.end);
+    if (currentToken().type != TOK_SEMICOLON)
+        errorAt("Expected ';' after import statement", previousToken().range.end);
     getNextToken(); // consume ';'
     
-    return std::make_unique<ImportStmtAST>(moduleName, importType, std::move(symbols), alias, loc);
+    return make<ImportStmtAST>(moduleName, importType, context->copySpan(symbols), alias, loc);
 }
 
-std::unique_ptr<ExportStmtAST> Parser::parseExportStatement() {
-    SourceLocation loc = currentToken.range.start;
+ExportStmtAST* Parser::parseExportStatement() {
+    SourceLoc loc = currentToken().range.start;
     getNextToken(); // consume 'export'
     
-    if (currentToken.type == TOK_LBRACE) {
+    if (currentToken().type == TOK_LBRACE) {
         // export { a, b as c }
         getNextToken(); // consume '{'
         std::vector<ExportedSymbol> symbols;
-        while (currentToken.type != TOK_RBRACE && currentToken.type != TOK_EOF) {
-            if (currentToken.type != TOK_IDENTIFIER)
+        while (currentToken().type != TOK_RBRACE && currentToken().type != TOK_EOF) {
+            if (currentToken().type != TOK_IDENTIFIER)
                 errorHere("Expected identifier in export list");
-            std::string name = currentToken.value;
-            std::string alias;
+            std::string_view name = context->intern(currentToken().value);
+            std::string_view alias;
             getNextToken();
-            if (currentToken.type == TOK_AS) {
+            if (currentToken().type == TOK_AS) {
                 getNextToken();
-                if (currentToken.type != TOK_IDENTIFIER)
+                if (currentToken().type != TOK_IDENTIFIER)
                     errorHere("Expected identifier after 'as'");
-                alias = currentToken.value;
+                alias = context->intern(currentToken().value);
                 getNextToken();
             }
             symbols.push_back({name, alias});
-            if (currentToken.type == TOK_COMMA) {
+            if (currentToken().type == TOK_COMMA) {
                 getNextToken();
-            } else if (currentToken.type != TOK_RBRACE) {
+            } else if (currentToken().type != TOK_RBRACE) {
                 errorHere("Expected ',' or '}' in export list");
             }
         }
-        if (currentToken.type != TOK_RBRACE)
+        if (currentToken().type != TOK_RBRACE)
             errorHere("Expected '}'");
         getNextToken();
         
-        if (currentToken.type != TOK_SEMICOLON)
-            errorAt("Expected ';' after export list", previousToken.range.end);
+        if (currentToken().type != TOK_SEMICOLON)
+            errorAt("Expected ';' after export list", previousToken().range.end);
         getNextToken();
         
-        return std::make_unique<ExportStmtAST>(ExportType::Named, std::move(symbols), nullptr, loc);
-    } else if (currentToken.type == TOK_DEFAULT) {
+        return make<ExportStmtAST>(ExportType::Named, context->copySpan(symbols), nullptr, loc);
+    } else if (currentToken().type == TOK_DEFAULT) {
         getNextToken(); // consume 'default'
-        auto expr = parseExpression();
+        auto* expr = parseExpression();
         if (!expr) return nullptr;
-        if (currentToken.type != TOK_SEMICOLON)
-            errorAt("Expected ';' after default export", previousToken.range.end);
+        if (currentToken().type != TOK_SEMICOLON)
+            errorAt("Expected ';' after default export", previousToken().range.end);
         getNextToken();
-        return std::make_unique<ExportStmtAST>(ExportType::Default, std::vector<ExportedSymbol>{}, std::move(expr), loc);
-    } else if (currentToken.type == TOK_FN) {
+        return make<ExportStmtAST>(ExportType::Default, ASTSpan<ExportedSymbol>{}, expr, loc);
+    } else if (currentToken().type == TOK_FN) {
         // export fn foo() {}
         // Wait, parseStatement doesn't handle named functions currently?
         // Ah, `fn` usually returns a FunctionLiteralAST which is an expression.
@@ -662,8 +727,8 @@ std::unique_ptr<ExportStmtAST> Parser::parseExportStatement() {
     } else {
         // Try parsing assignment: export var = 1;
         // The rest of the line is a statement
-        auto stmt = parseStatement();
+        auto* stmt = parseStatement();
         if (!stmt) return nullptr;
-        return std::make_unique<ExportStmtAST>(ExportType::Assignment, std::vector<ExportedSymbol>{}, std::move(stmt), loc);
+        return make<ExportStmtAST>(ExportType::Assignment, ASTSpan<ExportedSymbol>{}, stmt, loc);
     }
 }
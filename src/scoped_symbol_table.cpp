@@ -0,0 +1,42 @@
+#include "scoped_symbol_table.h"
+#include "identifier_table.h"
+
+SymbolIdTable::SymbolIdTable() : slots(64) {}
+
+uint32_t SymbolIdTable::getOrCreate(std::string_view name) {
+    const uint64_t h = hashIdentifier(name);
+    const size_t mask = slots.size() - 1;
+    for (size_t i = static_cast<size_t>(h) & mask;; i = (i + 1) & mask) {
+        Slot& slot = slots[i];
+        if (slot.id == None) {
+            slot = Slot{h, static_cast<uint32_t>(spellings.size())};
+            spellings.emplace_back(name);
+            uint32_t id = slot.id;
+            if (spellings.size() * 4 > slots.size() * 3) grow();  // keep load factor under 3/4
+            return id;
+        }
+        if (slot.hash == h && spellings[slot.id] == name) return slot.id;
+    }
+}
+
+uint32_t SymbolIdTable::find(std::string_view name) const {
+    const uint64_t h = hashIdentifier(name);
+    const size_t mask = slots.size() - 1;
+    for (size_t i = static_cast<size_t>(h) & mask;; i = (i + 1) & mask) {
+        const Slot& slot = slots[i];
+        if (slot.id == None) return None;
+        if (slot.hash == h && spellings[slot.id] == name) return slot.id;
+    }
+}
+
+void SymbolIdTable::grow() {
+    std::vector<Slot> old(slots.size() * 2);
+    old.swap(slots);
+    const size_t mask = slots.size() - 1;
+    for (const Slot& slot : old) {
+        if (slot.id == None) continue;
+        size_t i = static_cast<size_t>(slot.hash) & mask;
+        while (slots[i].id != None) i = (i + 1) & mask;
+        slots[i] = slot;
+    }
+}
@@ -0,0 +1,154 @@
+#include "simd_scan.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define ARITH_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace simd_scan {
+namespace {
+
+inline bool isWhitespace(unsigned char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+inline bool isLineEnd(unsigned char c) { return c == '\n' || c == '\r' || c == '\0'; }
+inline bool isStringStop(unsigned char c) { return c == '"' || c == '\\' || isLineEnd(c); }
+
+size_t whitespaceScalar(const char* p, size_t n) {
+    size_t i = 0;
+    while (i < n && isWhitespace(static_cast<unsigned char>(p[i]))) ++i;
+    return i;
+}
+
+size_t lineEndScalar(const char* p, size_t n) {
+    size_t i = 0;
+    while (i < n && !isLineEnd(static_cast<unsigned char>(p[i]))) ++i;
+    return i;
+}
+
+size_t stringBodyScalar(const char* p, size_t n) {
+    size_t i = 0;
+    while (i < n && !isStringStop(static_cast<unsigned char>(p[i]))) ++i;
+    return i;
+}
+
+#ifdef ARITH_SIMD_X86
+// Each block helper returns a bitmask of the bytes that stop the scan.
+// Signed compares are fine for the \t..\r range: bytes >= 0x80 are negative and never match.
+inline unsigned stopMaskWhitespace16(__m128i v) {
+    __m128i space = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+    __m128i ctrl = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('\t' - 1)),
+                                 _mm_cmpgt_epi8(_mm_set1_epi8('\r' + 1), v));
+    return ~static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(space, ctrl))) & 0xFFFFu;
+}
+
+inline __m128i lineEndBytes16(__m128i v) {
+    return _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                                     _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))),
+                        _mm_cmpeq_epi8(v, _mm_setzero_si128()));
+}
+
+inline unsigned stopMaskLineEnd16(__m128i v) {
+    return static_cast<unsigned>(_mm_movemask_epi8(lineEndBytes16(v)));
+}
+
+inline unsigned stopMaskStringBody16(__m128i v) {
+    __m128i quoteOrSlash = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+                                        _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+    return static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(quoteOrSlash, lineEndBytes16(v))));
+}
+
+template <unsigned (*StopMask)(__m128i), size_t (*Tail)(const char*, size_t)>
+size_t scanSSE2(const char* p, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        unsigned mask = StopMask(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)));
+        if (mask) return i + static_cast<size_t>(__builtin_ctz(mask));
+    }
+    return i + Tail(p + i, n - i);
+}
+
+__attribute__((target("avx2"))) inline unsigned stopMaskWhitespace32(__m256i v) {
+    __m256i space = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+    __m256i ctrl = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('\t' - 1)),
+                                    _mm256_cmpgt_epi8(_mm256_set1_epi8('\r' + 1), v));
+    return ~static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(space, ctrl)));
+}
+
+__attribute__((target("avx2"))) inline __m256i lineEndBytes32(__m256i v) {
+    return _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+                                           _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))),
+                           _mm256_cmpeq_epi8(v, _mm256_setzero_si256()));
+}
+
+__attribute__((target("avx2"))) inline unsigned stopMaskLineEnd32(__m256i v) {
+    return static_cast<unsigned>(_mm256_movemask_epi8(lineEndBytes32(v)));
+}
+
+__attribute__((target("avx2"))) inline unsigned stopMaskStringBody32(__m256i v) {
+    __m256i quoteOrSlash = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')),
+                                           _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+    return static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(quoteOrSlash, lineEndBytes32(v))));
+}
+
+// 32-byte blocks, then the SSE2 scanner for the remainder
+template <unsigned (*StopMask)(__m256i), size_t (*Tail)(const char*, size_t)>
+__attribute__((target("avx2"))) size_t scanAVX2(const char* p, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        unsigned mask = StopMask(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)));
+        if (mask) return i + static_cast<size_t>(__builtin_ctz(mask));
+    }
+    return i + Tail(p + i, n - i);
+}
+
+const Scanners kSSE2 = {
+    scanSSE2<stopMaskWhitespace16, whitespaceScalar>,
+    scanSSE2<stopMaskLineEnd16, lineEndScalar>,
+    scanSSE2<stopMaskStringBody16, stringBodyScalar>,
+};
+
+const Scanners kAVX2 = {
+    scanAVX2<stopMaskWhitespace32, scanSSE2<stopMaskWhitespace16, whitespaceScalar>>,
+    scanAVX2<stopMaskLineEnd32, scanSSE2<stopMaskLineEnd16, lineEndScalar>>,
+    scanAVX2<stopMaskStringBody32, scanSSE2<stopMaskStringBody16, stringBodyScalar>>,
+};
+#endif
+
+const Scanners kScalar = {whitespaceScalar, lineEndScalar, stringBodyScalar};
+
+Level detectLevel() {
+#ifdef ARITH_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return Level::AVX2;
+    return Level::SSE2;  // baseline on x86-64
+#else
+    return Level::Scalar;
+#endif
+}
+
+} // namespace
+
+bool isSupported(Level level) {
+    return static_cast<int>(level) <= static_cast<int>(activeLevel());
+}
+
+const Scanners& getScanners(Level level) {
+#ifdef ARITH_SIMD_X86
+    if (level == Level::AVX2) return kAVX2;
+    if (level == Level::SSE2) return kSSE2;
+#else
+    (void)level;
+#endif
+    return kScalar;
+}
+
+Level activeLevel() {
+    static const Level level = detectLevel();
+    return level;
+}
+
+const Scanners& activeScanners() {
+    static const Scanners& scanners = getScanners(activeLevel());
+    return scanners;
+}
+
+} // namespace simd_scan
@@ -0,0 +1,177 @@
+#include "source_manager.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ARITH_HAVE_MMAP 1
+#endif
+
+struct SourceManager::Entry {
+    Buffer buffer;
+    std::string owned;            // in-memory or read() contents
+    void* mapped = nullptr;       // mmap'd file contents
+    size_t mappedSize = 0;
+    std::once_flag linesBuilt;
+    std::vector<uint32_t> lineStarts;  // offset of the first byte of each line
+
+    ~Entry() {
+#ifdef ARITH_HAVE_MMAP
+        if (mapped) munmap(mapped, mappedSize);
+#endif
+    }
+};
+
+SourceManager::SourceManager() = default;
+SourceManager::~SourceManager() = default;
+
+#ifdef ARITH_HAVE_MMAP
+// Map the whole file read-only; false if it can't be mapped (empty files, pipes, ...)
+static bool mapFile(const std::string& path, void*& data, size_t& size) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0;
+    if (ok) {
+        data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ok = data != MAP_FAILED;
+        if (ok) size = static_cast<size_t>(st.st_size);
+    }
+    close(fd);
+    return ok;
+}
+#endif
+
+const SourceManager::Buffer& SourceManager::registerEntry(std::unique_ptr<Entry> entry, bool dedupe) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (dedupe) {
+        // Another thread loaded the same file while this one was reading it
+        auto it = byName.find(entry->buffer.name);
+        if (it != byName.end()) return entries[it->second]->buffer;
+    }
+    const size_t span = entry->buffer.text.size() + 1;  // + end-of-file location
+    if (span > std::numeric_limits<uint32_t>::max() - nextBase) {
+        throw std::runtime_error("Source location space exhausted: " + entry->buffer.name);
+    }
+    entry->buffer.id = static_cast<FileID>(entries.size());
+    entry->buffer.base = nextBase;
+    nextBase += static_cast<uint32_t>(span);
+    byName[entry->buffer.name] = entry->buffer.id;
+    entries.push_back(std::move(entry));
+    return entries.back()->buffer;
+}
+
+const SourceManager::Buffer& SourceManager::loadFile(const std::string& path) {
+    if (const Buffer* loaded = getBuffer(path)) return *loaded;
+
+    auto entry = std::make_unique<Entry>();
+    entry->buffer.name = path;
+#ifdef ARITH_HAVE_MMAP
+    if (mapFile(path, entry->mapped, entry->mappedSize)) {
+        entry->buffer.text = std::string_view(static_cast<const char*>(entry->mapped), entry->mappedSize);
+    } else
+#endif
+    {
+        // Single sized read into one allocation
+        std::error_code ec;
+        if (std::filesystem::is_directory(path, ec)) {
+            throw std::runtime_error("Cannot read file: " + path + " is a directory");
+        }
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        std::streamoff size = file.is_open() ? static_cast<std::streamoff>(file.tellg()) : -1;
+        if (size < 0) {
+            throw std::runtime_error("Cannot open file: " + path);
+        }
+        entry->owned.resize(static_cast<size_t>(size));
+        file.seekg(0);
+        if (!file.read(entry->owned.data(), static_cast<std::streamsize>(entry->owned.size()))) {
+            throw std::runtime_error("Cannot read file: " + path);
+        }
+        entry->buffer.text = entry->owned;
+    }
+    return registerEntry(std::move(entry), /*dedupe=*/true);
+}
+
+const SourceManager::Buffer& SourceManager::addBuffer(const std::string& name, std::string contents) {
+    auto entry = std::make_unique<Entry>();
+    entry->buffer.name = name;
+    entry->owned = std::move(contents);
+    entry->buffer.text = entry->owned;
+    return registerEntry(std::move(entry));
+}
+
+const SourceManager::Buffer& SourceManager::addView(const std::string& name, std::string_view text) {
+    auto entry = std::make_unique<Entry>();
+    entry->buffer.name = name;
+    entry->buffer.text = text;
+    return registerEntry(std::move(entry));
+}
+
+const SourceManager::Buffer* SourceManager::getBuffer(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = byName.find(name);
+    return it != byName.end() ? &entries[it->second]->buffer : nullptr;
+}
+
+const SourceManager::Buffer* SourceManager::getBufferFor(SourceLoc loc) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!loc.isValid() || loc.raw >= nextBase) return nullptr;
+    // Last buffer whose base is <= loc
+    auto it = std::upper_bound(entries.begin(), entries.end(), loc.raw,
+        [](uint32_t raw, const std::unique_ptr<Entry>& e) { return raw < e->buffer.base; });
+    return &(*std::prev(it))->buffer;
+}
+
+const SourceManager::Entry& SourceManager::entryFor(const Buffer& buffer) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return *entries[buffer.id];
+}
+
+const std::vector<uint32_t>& SourceManager::getLineStarts(const Entry& entry) const {
+    auto& mutableEntry = const_cast<Entry&>(entry);
+    std::call_once(mutableEntry.linesBuilt, [&mutableEntry] {
+        // CRLF and lone CR each end one line, like LF
+        const std::string_view text = mutableEntry.buffer.text;
+        auto& starts = mutableEntry.lineStarts;
+        starts.push_back(0);
+        for (size_t i = 0; i < text.size(); ++i) {
+            const char c = text[i];
+            if (c == '\n' || (c == '\r' && (i + 1 >= text.size() || text[i + 1] != '\n'))) {
+                starts.push_back(static_cast<uint32_t>(i + 1));
+            }
+        }
+    });
+    return entry.lineStarts;
+}
+
+SourceLocation SourceManager::getPresumedLoc(SourceLoc loc) const {
+    const Buffer* buffer = getBufferFor(loc);
+    if (!buffer) return SourceLocation{};
+    const uint32_t offset = loc.raw - buffer->base;
+    const auto& starts = getLineStarts(entryFor(*buffer));
+    // Last line starting at or before offset
+    auto line = std::upper_bound(starts.begin(), starts.end(), offset) - 1;
+    return SourceLocation{buffer->name, static_cast<int>(line - starts.begin()) + 1,
+                          static_cast<int>(offset - *line) + 1};
+}
+
+std::string_view SourceManager::getLineText(const Buffer& buffer, int line) const {
+    const auto& starts = getLineStarts(entryFor(buffer));
+    if (line < 1 || static_cast<size_t>(line) > starts.size()) return {};
+    const size_t begin = starts[line - 1];
+    size_t end = static_cast<size_t>(line) < starts.size() ? starts[line] : buffer.text.size();
+    while (end > begin && (buffer.text[end - 1] == '\n' || buffer.text[end - 1] == '\r')) --end;
+    return buffer.text.substr(begin, end - begin);
+}
+
+SourceManager& getSourceManager() {
+    static SourceManager instance;
+    return instance;
+}
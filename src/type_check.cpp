@@ -1,16 +1,23 @@
 #include "type_check.h"
-#include "function_ast.h"
+#include "ast_visitor.h"
 #include "parser.h" // for ParseError and SourceLocation
+#include "scoped_symbol_table.h"
 #include <stdexcept>
-#include <map>
 #include <set>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace {
 enum class ValueType { Number, String, Function };
 
-// Combined type info returned from inferExprType (type + optional arity for functions)
+// "file:line:column" for diagnostic notes
+std::string formatLocation(SourceLoc loc) {
+    SourceLocation where = getSourceManager().getPresumedLoc(loc);
+    return where.file + ":" + std::to_string(where.line) + ":" + std::to_string(where.column);
+}
+
+// Combined type info returned from TypeChecker::infer (type + optional arity for functions)
 struct TypeInfo {
     ValueType type = ValueType::Number;
     int param_count = -1;  // only meaningful when type == Function
@@ -20,91 +27,102 @@ struct SymbolInfo {
     bool is_mutable = false;
     bool is_parameter = false;  // true for function parameters
     // Where this symbol was first declared/bound (for diagnostics)
-    SourceLocation declLoc{};
+    SourceLoc declLoc{};
     ValueType type = ValueType::Number;
     int param_count = -1;  // only meaningful when type == Function
 };
 
 class TypeEnv {
 public:
-    void enterScope() { scopes.emplace_back(); }
-    void exitScope() { if (!scopes.empty()) scopes.pop_back(); }
+    void enterScope() { symbols.enterScope(); }
+    void exitScope() { symbols.exitScope(); }
 
     // Returns ptr to symbol if found in any scope (innermost outward)
-    SymbolInfo* lookup(const std::string& name) {
-        for (int i = static_cast<int>(scopes.size()) - 1; i >= 0; --i) {
-            auto it = scopes[i].find(name);
-            if (it != scopes[i].end()) return &it->second;
-        }
-        return nullptr;
-    }
+    SymbolInfo* lookup(std::string_view name) { return symbols.lookup(name); }
 
     // Returns ptr to symbol if found in current scope
-    SymbolInfo* lookupCurrent(const std::string& name) {
-        if (scopes.empty()) return nullptr;
-        auto it = scopes.back().find(name);
-        if (it != scopes.back().end()) return &it->second;
-        return nullptr;
-    }
+    SymbolInfo* lookupCurrent(std::string_view name) { return symbols.lookupCurrent(name); }
 
     // Declare/overwrite in current scope (shadowing allowed)
-    void declare(const std::string& name, bool is_mutable, const SourceLocation& loc,
+    void declare(std::string_view name, bool is_mutable, SourceLoc loc,
                  ValueType ty = ValueType::Number, int paramCount = -1, bool isParam = false) {
-        if (scopes.empty()) scopes.emplace_back();
         SymbolInfo info;
         info.is_mutable = is_mutable;
         info.is_parameter = isParam;
         info.declLoc = loc;
         info.type = ty;
         info.param_count = paramCount;
-        scopes.back()[name] = info;
+        symbols.declare(name, info);
     }
 
 private:
-    std::vector<std::map<std::string, SymbolInfo>> scopes;
+    ScopedSymbolTable<SymbolInfo> symbols;
 };
 
+ValueType toValueType(StaticType t) {
+    if (t == StaticType::Number) return ValueType::Number;
+    if (t == StaticType::String) return ValueType::String;
+    return ValueType::Function;
+}
+
+StaticType toStaticType(ValueType t) {
+    if (t == ValueType::Number) return StaticType::Number;
+    if (t == ValueType::String) return StaticType::String;
+    return StaticType::Function;
+}
+
 const char* toTypeName(ValueType t) {
     if (t == ValueType::Number) return "number";
     if (t == ValueType::String) return "string";
     return "function";
 }
 
-void typeCheckNode(ASTNode* node, TypeEnv& env, const std::string& filename);
-
-// Infer expression type and validate subexpressions
-TypeInfo inferExprType(ExprAST* expr, TypeEnv& env, const std::string& filename) {
-    if (!expr) return TypeInfo{ValueType::Number};
+// AIDEV-NOTE: Expression visits compute the expression's type; statement visits check the
+// statement and return a dummy. check() is the statement-context entry point (assignments
+// declare or mutate bindings there), infer() the expression-context one.
+class TypeChecker : public ASTVisitor<TypeChecker, TypeInfo> {
+public:
+    void check(ASTNode* node) {
+        if (!node) return;
+        if (auto* assign = dyn_cast<AssignmentExprAST>(node)) {
+            checkAssignment(assign);
+        } else if (auto* expr = dyn_cast<ExprAST>(node)) {
+            infer(expr);
+        } else {
+            visit(node);
+        }
+    }
 
-    if (auto num = dynamic_cast<NumberExprAST*>(expr)) {
-        (void)num;
-        return TypeInfo{ValueType::Number};
+    // Infer expression type, validate subexpressions and record the result on the node for codegen
+    TypeInfo infer(ExprAST* expr) {
+        if (!expr) return TypeInfo{ValueType::Number};
+        TypeInfo info = visit(expr);
+        expr->setStaticType(toStaticType(info.type));
+        return info;
     }
 
-    if (auto var = dynamic_cast<VariableExprAST*>(expr)) {
+    TypeInfo visitNumber(NumberExprAST*) { return TypeInfo{ValueType::Number}; }
+    TypeInfo visitStringLiteral(StringLiteralAST*) { return TypeInfo{ValueType::String}; }
+
+    TypeInfo visitVariable(VariableExprAST* var) {
         auto* info = env.lookup(var->getName());
         if (!info) {
-            throw ParseError("cannot find value '" + var->getName() + "' in this scope", var->getNameLocation());
+            throw ParseError("cannot find value '" + std::string(var->getName()) + "' in this scope", var->getNameLocation());
         }
         return TypeInfo{info->type, info->param_count};
     }
 
-    if (auto str = dynamic_cast<StringLiteralAST*>(expr)) {
-        (void)str;
-        return TypeInfo{ValueType::String};
-    }
-
-    if (auto unary = dynamic_cast<UnaryExprAST*>(expr)) {
-        auto t = inferExprType(unary->getOperand(), env, filename);
+    TypeInfo visitUnary(UnaryExprAST* unary) {
+        auto t = infer(unary->getOperand());
         if (t.type == ValueType::String) {
             throw ParseError("String literal cannot be used in unary operation", unary->getOperatorLocation());
         }
         return TypeInfo{ValueType::Number};
     }
 
-    if (auto bin = dynamic_cast<BinaryExprAST*>(expr)) {
-        auto lt = inferExprType(bin->getLHS(), env, filename);
-        auto rt = inferExprType(bin->getRHS(), env, filename);
+    TypeInfo visitBinary(BinaryExprAST* bin) {
+        auto lt = infer(bin->getLHS());
+        auto rt = infer(bin->getRHS());
         if (lt.type == ValueType::String) {
             throw ParseError("String literal cannot be used in binary operation (left operand)", bin->getOperatorLocation());
         }
@@ -114,12 +132,15 @@ TypeInfo inferExprType(ExprAST* expr, TypeEnv& env, const std::string& filename)
         return TypeInfo{ValueType::Number};
     }
 
-    if (auto fnLit = dynamic_cast<FunctionLiteralAST*>(expr)) {
+    // An assignment nested in an expression is typed as a number and not checked further
+    TypeInfo visitAssignment(AssignmentExprAST*) { return TypeInfo{ValueType::Number}; }
+
+    TypeInfo visitFunctionLiteral(FunctionLiteralAST* fnLit) {
         // Check for duplicate parameter names
-        std::set<std::string> seenParams;
+        std::set<std::string_view> seenParams;
         for (const auto& p : fnLit->getParams()) {
             if (!seenParams.insert(p.name).second) {
-                throw ParseError("duplicate parameter name '" + p.name + "'", p.location);
+                throw ParseError("duplicate parameter name '" + std::string(p.name) + "'", p.location);
             }
         }
 
@@ -128,12 +149,12 @@ TypeInfo inferExprType(ExprAST* expr, TypeEnv& env, const std::string& filename)
             auto* info = env.lookup(cap.name);
             if (!info) {
                 throw ParseError(
-                    "captured variable '" + cap.name + "' is not declared in the enclosing scope",
+                    "captured variable '" + std::string(cap.name) + "' is not declared in the enclosing scope",
                     cap.location);
             }
             if (!info->is_mutable) {
                 throw ParseError(
-                    "captured variable '" + cap.name + "' must be declared mutable; consider 'mut " + cap.name + "'",
+                    "captured variable '" + std::string(cap.name) + "' must be declared mutable; consider 'mut " + std::string(cap.name) + "'",
                     cap.location);
             }
         }
@@ -143,15 +164,15 @@ TypeInfo inferExprType(ExprAST* expr, TypeEnv& env, const std::string& filename)
         for (const auto& p : fnLit->getParams()) {
             env.declare(p.name, p.is_mutable, p.location, ValueType::Number, -1, /*isParam=*/true);
         }
-        typeCheckNode(fnLit->getBody(), env, filename);
+        check(fnLit->getBody());
         env.exitScope();
 
         return TypeInfo{ValueType::Function, static_cast<int>(fnLit->getParams().size())};
     }
 
-    if (auto call = dynamic_cast<FunctionCallAST*>(expr)) {
+    TypeInfo visitFunctionCall(FunctionCallAST* call) {
         // Infer callee type and check arity if known
-        TypeInfo calleeInfo = inferExprType(call->getCallee(), env, filename);
+        TypeInfo calleeInfo = infer(call->getCallee());
         if (calleeInfo.type == ValueType::Function && calleeInfo.param_count >= 0) {
             int expected = calleeInfo.param_count;
             int actual = static_cast<int>(call->getArgs().size());
@@ -164,195 +185,194 @@ TypeInfo inferExprType(ExprAST* expr, TypeEnv& env, const std::string& filename)
         }
         // Type-check arguments
         for (const auto& arg : call->getArgs()) {
-            inferExprType(arg.get(), env, filename);
+            infer(arg);
         }
         return TypeInfo{ValueType::Number};
     }
 
-    return TypeInfo{ValueType::Number};
-}
-
-void typeCheckExpr(ExprAST* expr, TypeEnv& env, const std::string& filename) {
-    (void)inferExprType(expr, env, filename);
-}
-
-void typeCheckNode(ASTNode* node, TypeEnv& env, const std::string& filename) {
-    if (!node) return;
-
-    // Expression-only nodes
-    if (auto expr = dynamic_cast<ExprAST*>(node)) {
-        // Handle assignments specially
-        if (auto assign = dynamic_cast<AssignmentExprAST*>(expr)) {
-            const std::string& name = assign->getVarName();
-            bool isMutDecl = assign->isMutableDeclaration();
-
-            // Detect self-referential function literal (recursive function):
-            // if RHS is a fn literal that references the LHS name in its body,
-            // pre-declare name as Function in the current scope so the body can see it.
-            if (!isMutDecl && !env.lookupCurrent(name)) {
-                if (auto* fnLit = dynamic_cast<FunctionLiteralAST*>(assign->getValue())) {
-                    if (functionBodyReferencesVar(fnLit, name)) {
-                        int pc = static_cast<int>(fnLit->getParams().size());
-                        env.declare(name, /*is_mutable=*/false, assign->getNameLocation(),
-                                    ValueType::Function, pc);
-                        inferExprType(assign->getValue(), env, filename);
-                        return;  // declaration already in place; skip normal flow
-                    }
-                }
-            }
-
-            // First infer RHS expression type (validates subexpressions)
-            TypeInfo rhsInfo = inferExprType(assign->getValue(), env, filename);
-
-            if (isMutDecl) {
-                // Explicit mutable declaration always declares in current scope
-                env.declare(name, /*is_mutable=*/true, assign->getNameLocation(),
-                            rhsInfo.type, rhsInfo.param_count);
-            } else {
-                // No 'mut' keyword: check existing bindings
-                if (auto* cur = env.lookupCurrent(name)) {
-                    if (cur->is_mutable) {
-                        // Mutation allowed, but type must match
-                        if (cur->type != rhsInfo.type) {
-                            std::string msg = "mismatched types";
-                            if (!cur->declLoc.file.empty()) {
-                                msg += std::string("\n") +
-                                       "note: expected due to first assignment: " + cur->declLoc.file + ":" +
-                                       std::to_string(cur->declLoc.line) + ":" + std::to_string(cur->declLoc.column);
-                            }
-                            msg += std::string("\n") + "help: expected " + toTypeName(cur->type) + ", found " + toTypeName(rhsInfo.type);
-                            throw ParseError(msg, assign->getNameLocation());
-                        }
-                        cur->param_count = rhsInfo.param_count;
-                    } else {
-                        // Reassignment to an immutable variable in the same scope
-                        const auto& firstLoc = cur->declLoc;
-                        std::string msg = "Cannot reassign to immutable variable '" + name + "'";
-                        if (!firstLoc.file.empty()) {
-                            msg += std::string("\n") +
-                                   "note: first assignment here: " + firstLoc.file + ":" +
-                                   std::to_string(firstLoc.line) + ":" + std::to_string(firstLoc.column);
-                        }
-                        msg += std::string("\n") + "help: consider making this binding mutable: 'mut " + name + "'";
-                        throw ParseError(msg, assign->getNameLocation());
-                    }
-                } else {
-                    // Not in current scope — check nearest outer binding
-                    if (auto* nearest = env.lookup(name)) {
-                        if (nearest->is_mutable) {
-                            // Cross-scope mutation allowed — enforce type consistency
-                            if (nearest->type != rhsInfo.type) {
-                                std::string msg = "mismatched types";
-                                if (!nearest->declLoc.file.empty()) {
-                                    msg += std::string("\n") +
-                                           "note: expected due to first assignment: " + nearest->declLoc.file + ":" +
-                                           std::to_string(nearest->declLoc.line) + ":" + std::to_string(nearest->declLoc.column);
-                                }
-                                msg += std::string("\n") + "help: expected " + toTypeName(nearest->type) + ", found " + toTypeName(rhsInfo.type);
-                                throw ParseError(msg, assign->getNameLocation());
-                            }
-                            nearest->param_count = rhsInfo.param_count;
-                        } else if (nearest->is_parameter) {
-                            // Reassigning an immutable parameter is an error
-                            const auto& firstLoc = nearest->declLoc;
-                            std::string msg = "Cannot reassign to immutable parameter '" + name + "'";
-                            if (!firstLoc.file.empty()) {
-                                msg += std::string("\n") +
-                                       "note: parameter declared here: " + firstLoc.file + ":" +
-                                       std::to_string(firstLoc.line) + ":" + std::to_string(firstLoc.column);
-                            }
-                            msg += std::string("\n") + "help: consider declaring the parameter as mutable: 'mut " + name + "'";
-                            throw ParseError(msg, assign->getNameLocation());
-                        } else {
-                            // Shadow with new immutable declaration in current scope
-                            env.declare(name, /*is_mutable=*/false, assign->getNameLocation(),
-                                        rhsInfo.type, rhsInfo.param_count);
-                        }
-                    } else {
-                        // New immutable declaration in current scope
-                        env.declare(name, /*is_mutable=*/false, assign->getNameLocation(),
-                                    rhsInfo.type, rhsInfo.param_count);
-                    }
-                }
-            }
-            return;
-        }
-
-        // All other expressions
-        typeCheckExpr(expr, env, filename);
-        return;
-    }
-
-    // Print statement
-    if (auto print = dynamic_cast<PrintStmtAST*>(node)) {
-        typeCheckExpr(print->getFormatExpr(), env, filename);
+    TypeInfo visitPrint(PrintStmtAST* print) {
+        infer(print->getFormatExpr());
         for (const auto& arg : print->getArgs()) {
-            typeCheckExpr(arg.get(), env, filename);
+            infer(arg);
         }
-        return;
+        return {};
     }
 
     // If statement (blocks handle scoping)
-    if (auto ifs = dynamic_cast<IfStmtAST*>(node)) {
-        typeCheckExpr(ifs->getCondition(), env, filename);
+    TypeInfo visitIf(IfStmtAST* ifs) {
+        infer(ifs->getCondition());
         // then
         env.enterScope();
-        typeCheckNode(ifs->getThenStmt(), env, filename);
+        check(ifs->getThenStmt());
         env.exitScope();
         // else
         env.enterScope();
-        typeCheckNode(ifs->getElseStmt(), env, filename);
+        check(ifs->getElseStmt());
         env.exitScope();
-        return;
+        return {};
     }
 
-    // While statement
-    if (auto wh = dynamic_cast<WhileStmtAST*>(node)) {
-        typeCheckExpr(wh->getCondition(), env, filename);
+    TypeInfo visitWhile(WhileStmtAST* wh) {
+        infer(wh->getCondition());
         env.enterScope();
-        typeCheckNode(wh->getBody(), env, filename);
+        check(wh->getBody());
         env.exitScope();
-        return;
+        return {};
     }
 
     // Return statement: validate the return expression if present
-    if (auto ret = dynamic_cast<ReturnStmtAST*>(node)) {
+    TypeInfo visitReturn(ReturnStmtAST* ret) {
         if (ret->hasValue()) {
-            typeCheckExpr(ret->getValue(), env, filename);
+            infer(ret->getValue());
         }
-        return;
+        return {};
     }
 
     // Block: own scope
-    if (auto block = dynamic_cast<BlockAST*>(node)) {
+    TypeInfo visitBlock(BlockAST* block) {
         env.enterScope();
         for (const auto& stmt : block->getStatements()) {
-            typeCheckNode(stmt.get(), env, filename);
+            check(stmt);
         }
         env.exitScope();
-        return;
+        return {};
     }
 
     // Program: global scope
-    // Program: global scope
-    if (auto program = dynamic_cast<ProgramAST*>(node)) {
+    TypeInfo visitProgram(ProgramAST* program) {
+        env.enterScope();
+        checkModuleBody(program);
+        env.exitScope();
+        return {};
+    }
+
+    void checkModule(ProgramAST* module, const std::vector<ModuleBinding>& imports,
+                     std::vector<ModuleBinding>& exports) {
         env.enterScope();
+        for (const auto& imp : imports) {
+            env.declare(imp.name, false, imp.loc, toValueType(imp.type), imp.paramCount);
+        }
+        checkModuleBody(module);
+        for (auto& exp : exports) {
+            auto* info = env.lookupCurrent(exp.name);
+            if (!info) {
+                throw ParseError("cannot find value '" + std::string(exp.name) + "' in this scope", exp.loc);
+            }
+            exp.type = toStaticType(info->type);
+            exp.paramCount = info->param_count;
+        }
+        env.exitScope();
+    }
+
+private:
+    TypeEnv env;
+
+    void checkModuleBody(ProgramAST* program) {
         for (const auto& exp : program->getExports()) {
             if (exp->getDeclaration()) {
-                typeCheckNode(exp->getDeclaration(), env, filename);
+                check(exp->getDeclaration());
             }
         }
         for (const auto& stmt : program->getStatements()) {
-            typeCheckNode(stmt.get(), env, filename);
+            check(stmt);
         }
-        env.exitScope();
-        return;
     }
-}
+
+    void checkAssignment(AssignmentExprAST* assign) {
+        std::string_view name = assign->getVarName();
+        bool isMutDecl = assign->isMutableDeclaration();
+
+        // Detect self-referential function literal (recursive function):
+        // if RHS is a fn literal that references the LHS name in its body,
+        // pre-declare name as Function in the current scope so the body can see it.
+        if (!isMutDecl && !env.lookupCurrent(name)) {
+            if (auto* fnLit = dyn_cast<FunctionLiteralAST>(assign->getValue())) {
+                if (fnLit->isSelfReferential()) {
+                    int pc = static_cast<int>(fnLit->getParams().size());
+                    env.declare(name, /*is_mutable=*/false, assign->getNameLocation(),
+                                ValueType::Function, pc);
+                    infer(assign->getValue());
+                    return;  // declaration already in place; skip normal flow
+                }
+            }
+        }
+
+        // First infer RHS expression type (validates subexpressions)
+        TypeInfo rhsInfo = infer(assign->getValue());
+
+        if (isMutDecl) {
+            // Explicit mutable declaration always declares in current scope
+            env.declare(name, /*is_mutable=*/true, assign->getNameLocation(),
+                        rhsInfo.type, rhsInfo.param_count);
+        } else {
+            // No 'mut' keyword: check existing bindings
+            if (auto* cur = env.lookupCurrent(name)) {
+                if (cur->is_mutable) {
+                    // Mutation allowed, but type must match
+                    if (cur->type != rhsInfo.type) {
+                        std::string msg = "mismatched types";
+                        if (cur->declLoc.isValid()) {
+                            msg += std::string("\n") + "note: expected due to first assignment: " + formatLocation(cur->declLoc);
+                        }
+                        msg += std::string("\n") + "help: expected " + toTypeName(cur->type) + ", found " + toTypeName(rhsInfo.type);
+                        throw ParseError(msg, assign->getNameLocation());
+                    }
+                    cur->param_count = rhsInfo.param_count;
+                } else {
+                    // Reassignment to an immutable variable in the same scope
+                    SourceLoc firstLoc = cur->declLoc;
+                    std::string msg = "Cannot reassign to immutable variable '" + std::string(name) + "'";
+                    if (firstLoc.isValid()) {
+                        msg += std::string("\n") + "note: first assignment here: " + formatLocation(firstLoc);
+                    }
+                    msg += std::string("\n") + "help: consider making this binding mutable: 'mut " + std::string(name) + "'";
+                    throw ParseError(msg, assign->getNameLocation());
+                }
+            } else {
+                // Not in current scope — check nearest outer binding
+                if (auto* nearest = env.lookup(name)) {
+                    if (nearest->is_mutable) {
+                        // Cross-scope mutation allowed — enforce type consistency
+                        if (nearest->type != rhsInfo.type) {
+                            std::string msg = "mismatched types";
+                            if (nearest->declLoc.isValid()) {
+                                msg += std::string("\n") + "note: expected due to first assignment: " + formatLocation(nearest->declLoc);
+                            }
+                            msg += std::string("\n") + "help: expected " + toTypeName(nearest->type) + ", found " + toTypeName(rhsInfo.type);
+                            throw ParseError(msg, assign->getNameLocation());
+                        }
+                        nearest->param_count = rhsInfo.param_count;
+                    } else if (nearest->is_parameter) {
+                        // Reassigning an immutable parameter is an error
+                        SourceLoc firstLoc = nearest->declLoc;
+                        std::string msg = "Cannot reassign to immutable parameter '" + std::string(name) + "'";
+                        if (firstLoc.isValid()) {
+                            msg += std::string("\n") + "note: parameter declared here: " + formatLocation(firstLoc);
+                        }
+                        msg += std::string("\n") + "help: consider declaring the parameter as mutable: 'mut " + std::string(name) + "'";
+                        throw ParseError(msg, assign->getNameLocation());
+                    } else {
+                        // Shadow with new immutable declaration in current scope
+                        env.declare(name, /*is_mutable=*/false, assign->getNameLocation(),
+                                    rhsInfo.type, rhsInfo.param_count);
+                    }
+                } else {
+                    // New immutable declaration in current scope
+                    env.declare(name, /*is_mutable=*/false, assign->getNameLocation(),
+                                rhsInfo.type, rhsInfo.param_count);
+                }
+            }
+        }
+    }
+};
 } // namespace
 
 
-void typeCheck(ASTNode* node, const std::string& filename) {
-    TypeEnv env;
-    typeCheckNode(node, env, filename);
+void typeCheck(ASTNode* node, const std::string& /*filename*/) {
+    TypeChecker().check(node);
+}
+
+void typeCheckModule(ProgramAST* module, const std::vector<ModuleBinding>& imports,
+                     std::vector<ModuleBinding>& exports) {
+    TypeChecker().checkModule(module, imports, exports);
 }
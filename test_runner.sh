@@ -3,6 +3,9 @@
 # ArithLang 테스트 러너
 # .k 파일의 // EXPECTED: 주석에서 예상 결과를 읽어와서 실제 실행 결과와 비교
 
+# 추가 컴파일 옵션은 ARITHC_FLAGS 환경변수로 전달 (예: ARITHC_FLAGS="-O2" ./test_runner.sh)
+# ARITHC_JIT를 지정하면 lli 대신 arithc의 JIT으로 실행 (예: ARITHC_JIT="--run --lazy" ./test_runner.sh)
+
 # 색상 정의
 GREEN='\033[0;32m'
 RED='\033[0;31m'
@@ -41,7 +44,7 @@ run_test() {
     
     # 컴파일(표준에러 캡처)
     local compile_stderr
-    compile_stderr=$(./build/arithc -o "$temp_ll" "$k_file" 2>&1 1>/dev/null)
+    compile_stderr=$(./build/arithc $ARITHC_FLAGS -o "$temp_ll" "$k_file" 2>&1 1>/dev/null)
     local compile_exit=$?
     
     if [ $compile_exit -ne 0 ]; then
@@ -77,7 +80,12 @@ run_test() {
     fi
     
     # 실행 및 결과 캡처
-    local actual=$(lli "$temp_ll" 2>/dev/null)
+    local actual
+    if [ -n "$ARITHC_JIT" ]; then
+        actual=$(./build/arithc $ARITHC_FLAGS $ARITHC_JIT "$k_file" 2>/dev/null)
+    else
+        actual=$(lli "$temp_ll" 2>/dev/null)
+    fi
     local exit_code=$?
     
     # 임시 파일 정리
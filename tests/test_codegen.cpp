@@ -3,14 +3,18 @@
 #include "parser.h"
 #include "ast.h"
 #include "codegen.h"
+#include "jit.h"
+#include "type_check.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/Support/FileSystem.h"
 
 void initializeCodeGen(const std::string& moduleName, const std::string& sourceFile = "");
 CodeGen& getCodeGen();
 
 class CodeGenTest : public ::testing::Test {
 protected:
+    ASTContext ast;  // owns hand-built nodes
     void SetUp() override {
     }
     
@@ -20,7 +24,7 @@ protected:
 
 TEST_F(CodeGenTest, NumberExpressionCodegen) {
     initializeCodeGen("test_module_num");
-    auto numExpr = std::make_unique<NumberExprAST>(42.0);
+    auto numExpr = ast.create<NumberExprAST>(42.0);
     
     auto func = llvm::Function::Create(
         llvm::FunctionType::get(llvm::Type::getDoubleTy(getCodeGen().getContext()), false),
@@ -44,9 +48,9 @@ TEST_F(CodeGenTest, NumberExpressionCodegen) {
 
 TEST_F(CodeGenTest, BinaryExpressionAddCodegen) {
     initializeCodeGen("test_module_add");
-    auto left = std::make_unique<NumberExprAST>(10.0);
-    auto right = std::make_unique<NumberExprAST>(5.0);
-    auto binExpr = std::make_unique<BinaryExprAST>('+', std::move(left), std::move(right));
+    auto left = ast.create<NumberExprAST>(10.0);
+    auto right = ast.create<NumberExprAST>(5.0);
+    auto binExpr = ast.create<BinaryExprAST>('+', left, right);
     
     auto func = llvm::Function::Create(
         llvm::FunctionType::get(llvm::Type::getDoubleTy(getCodeGen().getContext()), false),
@@ -68,9 +72,9 @@ TEST_F(CodeGenTest, BinaryExpressionAddCodegen) {
 
 TEST_F(CodeGenTest, BinaryExpressionSubCodegen) {
     initializeCodeGen("test_module_sub");
-    auto left = std::make_unique<NumberExprAST>(10.0);
-    auto right = std::make_unique<NumberExprAST>(3.0);
-    auto binExpr = std::make_unique<BinaryExprAST>('-', std::move(left), std::move(right));
+    auto left = ast.create<NumberExprAST>(10.0);
+    auto right = ast.create<NumberExprAST>(3.0);
+    auto binExpr = ast.create<BinaryExprAST>('-', left, right);
     
     auto func = llvm::Function::Create(
         llvm::FunctionType::get(llvm::Type::getDoubleTy(getCodeGen().getContext()), false),
@@ -91,9 +95,9 @@ TEST_F(CodeGenTest, BinaryExpressionSubCodegen) {
 
 TEST_F(CodeGenTest, BinaryExpressionMulCodegen) {
     initializeCodeGen("test_module_mul");
-    auto left = std::make_unique<NumberExprAST>(4.0);
-    auto right = std::make_unique<NumberExprAST>(5.0);
-    auto binExpr = std::make_unique<BinaryExprAST>('*', std::move(left), std::move(right));
+    auto left = ast.create<NumberExprAST>(4.0);
+    auto right = ast.create<NumberExprAST>(5.0);
+    auto binExpr = ast.create<BinaryExprAST>('*', left, right);
     
     auto func = llvm::Function::Create(
         llvm::FunctionType::get(llvm::Type::getDoubleTy(getCodeGen().getContext()), false),
@@ -114,9 +118,9 @@ TEST_F(CodeGenTest, BinaryExpressionMulCodegen) {
 
 TEST_F(CodeGenTest, BinaryExpressionDivCodegen) {
     initializeCodeGen("test_module_div");
-    auto left = std::make_unique<NumberExprAST>(20.0);
-    auto right = std::make_unique<NumberExprAST>(4.0);
-    auto binExpr = std::make_unique<BinaryExprAST>('/', std::move(left), std::move(right));
+    auto left = ast.create<NumberExprAST>(20.0);
+    auto right = ast.create<NumberExprAST>(4.0);
+    auto binExpr = ast.create<BinaryExprAST>('/', left, right);
     
     auto func = llvm::Function::Create(
         llvm::FunctionType::get(llvm::Type::getDoubleTy(getCodeGen().getContext()), false),
@@ -137,8 +141,8 @@ TEST_F(CodeGenTest, BinaryExpressionDivCodegen) {
 
 TEST_F(CodeGenTest, VariableAssignmentAndAccess) {
     initializeCodeGen("test_module_var");
-    auto assignExpr = std::make_unique<AssignmentExprAST>("x", std::make_unique<NumberExprAST>(42.0));
-    auto varExpr = std::make_unique<VariableExprAST>("x");
+    auto assignExpr = ast.create<AssignmentExprAST>("x", ast.create<NumberExprAST>(42.0));
+    auto varExpr = ast.create<VariableExprAST>("x");
     
     auto func = llvm::Function::Create(
         llvm::FunctionType::get(llvm::Type::getDoubleTy(getCodeGen().getContext()), false),
@@ -177,9 +181,9 @@ TEST_F(CodeGenTest, ComparisonOperators) {
     };
     
     for (const auto& testCase : testCases) {
-        auto left = std::make_unique<NumberExprAST>(testCase.left);
-        auto right = std::make_unique<NumberExprAST>(testCase.right);
-        auto binExpr = std::make_unique<BinaryExprAST>(testCase.op, std::move(left), std::move(right));
+        auto left = ast.create<NumberExprAST>(testCase.left);
+        auto right = ast.create<NumberExprAST>(testCase.right);
+        auto binExpr = ast.create<BinaryExprAST>(testCase.op, left, right);
         
         auto func = llvm::Function::Create(
             llvm::FunctionType::get(llvm::Type::getDoubleTy(getCodeGen().getContext()), false),
@@ -201,7 +205,7 @@ TEST_F(CodeGenTest, ComparisonOperators) {
 
 TEST_F(CodeGenTest, PrintStatementCodegen) {
     initializeCodeGen("test_module_print");
-    auto printStmt = std::make_unique<PrintStmtAST>(std::make_unique<NumberExprAST>(123.0));
+    auto printStmt = ast.create<PrintStmtAST>(ast.create<NumberExprAST>(123.0));
     
     auto func = llvm::Function::Create(
         llvm::FunctionType::get(llvm::Type::getDoubleTy(getCodeGen().getContext()), false),
@@ -220,14 +224,14 @@ TEST_F(CodeGenTest, PrintStatementCodegen) {
 
 TEST_F(CodeGenTest, IfStatementCodegen) {
     initializeCodeGen("test_module_if");
-    auto condition = std::make_unique<BinaryExprAST>('>', 
-        std::make_unique<NumberExprAST>(5.0), 
-        std::make_unique<NumberExprAST>(3.0));
+    auto condition = ast.create<BinaryExprAST>('>', 
+        ast.create<NumberExprAST>(5.0), 
+        ast.create<NumberExprAST>(3.0));
     
-    auto thenStmt = std::make_unique<AssignmentExprAST>("result", std::make_unique<NumberExprAST>(1.0));
-    auto elseStmt = std::make_unique<AssignmentExprAST>("result", std::make_unique<NumberExprAST>(0.0));
+    auto thenStmt = ast.create<AssignmentExprAST>("result", ast.create<NumberExprAST>(1.0));
+    auto elseStmt = ast.create<AssignmentExprAST>("result", ast.create<NumberExprAST>(0.0));
     
-    auto ifStmt = std::make_unique<IfStmtAST>(std::move(condition), std::move(thenStmt), std::move(elseStmt));
+    auto ifStmt = ast.create<IfStmtAST>(condition, thenStmt, elseStmt);
     
     auto func = llvm::Function::Create(
         llvm::FunctionType::get(llvm::Type::getDoubleTy(getCodeGen().getContext()), false),
@@ -249,10 +253,10 @@ TEST_F(CodeGenTest, WhileStatementCodegen) {
     initializeCodeGen("test_module_while");
     
     // Create a simple while(0) loop that should never execute
-    auto condition = std::make_unique<NumberExprAST>(0.0);  // false condition
-    auto body = std::make_unique<AssignmentExprAST>("x", std::make_unique<NumberExprAST>(1.0));
+    auto condition = ast.create<NumberExprAST>(0.0);  // false condition
+    auto body = ast.create<AssignmentExprAST>("x", ast.create<NumberExprAST>(1.0));
     
-    auto whileStmt = std::make_unique<WhileStmtAST>(std::move(condition), std::move(body));
+    auto whileStmt = ast.create<WhileStmtAST>(condition, body);
     
     auto func = llvm::Function::Create(
         llvm::FunctionType::get(llvm::Type::getDoubleTy(getCodeGen().getContext()), false),
@@ -274,15 +278,15 @@ TEST_F(CodeGenTest, WhileStatementCodegen) {
 TEST_F(CodeGenTest, BlockStatementCodegen) {
     initializeCodeGen("test_module_block");
     
-    std::vector<std::unique_ptr<ASTNode>> stmts;
-    stmts.push_back(std::make_unique<AssignmentExprAST>("x", std::make_unique<NumberExprAST>(10.0)));
-    stmts.push_back(std::make_unique<AssignmentExprAST>("y", std::make_unique<NumberExprAST>(5.0)));
-    stmts.push_back(std::make_unique<AssignmentExprAST>("result", 
-        std::make_unique<BinaryExprAST>('+', 
-            std::make_unique<VariableExprAST>("x"), 
-            std::make_unique<VariableExprAST>("y"))));
+    std::vector<ASTNode*> stmts;
+    stmts.push_back(ast.create<AssignmentExprAST>("x", ast.create<NumberExprAST>(10.0)));
+    stmts.push_back(ast.create<AssignmentExprAST>("y", ast.create<NumberExprAST>(5.0)));
+    stmts.push_back(ast.create<AssignmentExprAST>("result", 
+        ast.create<BinaryExprAST>('+', 
+            ast.create<VariableExprAST>("x"), 
+            ast.create<VariableExprAST>("y"))));
     
-    auto block = std::make_unique<BlockAST>(std::move(stmts));
+    auto block = ast.create<BlockAST>(ast.copySpan(stmts));
     
     auto func = llvm::Function::Create(
         llvm::FunctionType::get(llvm::Type::getDoubleTy(getCodeGen().getContext()), false),
@@ -301,6 +305,386 @@ TEST_F(CodeGenTest, BlockStatementCodegen) {
     // IR generation successful
 }
 
+TEST_F(CodeGenTest, OptimizePromotesAllocasToRegisters) {
+    initializeCodeGen("test_module_opt");
+    
+    std::vector<ASTNode*> stmts;
+    stmts.push_back(ast.create<AssignmentExprAST>("x", ast.create<NumberExprAST>(10.0)));
+    stmts.push_back(ast.create<AssignmentExprAST>("y",
+        ast.create<BinaryExprAST>('*',
+            ast.create<VariableExprAST>("x"),
+            ast.create<NumberExprAST>(2.0))));
+    auto block = ast.create<BlockAST>(ast.copySpan(stmts));
+    
+    auto func = llvm::Function::Create(
+        llvm::FunctionType::get(llvm::Type::getDoubleTy(getCodeGen().getContext()), false),
+        llvm::Function::ExternalLinkage, "test_func", &getCodeGen().getModule());
+    
+    auto entry = llvm::BasicBlock::Create(getCodeGen().getContext(), "entry", func);
+    getCodeGen().getBuilder().SetInsertPoint(entry);
+    
+    auto value = block->codegen();
+    ASSERT_NE(value, nullptr);
+    getCodeGen().getBuilder().CreateRet(value);
+    ASSERT_FALSE(llvm::verifyFunction(*func, &llvm::errs()));
+    
+    getCodeGen().optimize(2);
+    
+    // After -O2 the variables live in registers and the result folds to a constant
+    for (auto& inst : func->getEntryBlock()) {
+        EXPECT_FALSE(llvm::isa<llvm::AllocaInst>(inst));
+    }
+    auto* ret = llvm::dyn_cast<llvm::ReturnInst>(func->getEntryBlock().getTerminator());
+    ASSERT_NE(ret, nullptr);
+    auto* constant = llvm::dyn_cast<llvm::ConstantFP>(ret->getReturnValue());
+    ASSERT_NE(constant, nullptr);
+    EXPECT_DOUBLE_EQ(constant->getValueAPF().convertToDouble(), 20.0);
+}
+
+TEST_F(CodeGenTest, OptimizeRejectsInvalidLevel) {
+    initializeCodeGen("test_module_opt_invalid");
+    EXPECT_THROW(getCodeGen().optimize(4), std::runtime_error);
+}
+
+TEST_F(CodeGenTest, WriteObjectFileEmitsNativeObject) {
+    initializeCodeGen("test_module_obj");
+    
+    auto func = llvm::Function::Create(
+        llvm::FunctionType::get(llvm::Type::getDoubleTy(getCodeGen().getContext()), false),
+        llvm::Function::ExternalLinkage, "test_func", &getCodeGen().getModule());
+    auto entry = llvm::BasicBlock::Create(getCodeGen().getContext(), "entry", func);
+    getCodeGen().getBuilder().SetInsertPoint(entry);
+    
+    auto binExpr = ast.create<BinaryExprAST>('+',
+        ast.create<NumberExprAST>(1.0), ast.create<NumberExprAST>(2.0));
+    getCodeGen().getBuilder().CreateRet(binExpr->codegen());
+    
+    llvm::SmallString<128> objPath;
+    ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("test_codegen", "o", objPath));
+    getCodeGen().writeObjectFile(std::string(objPath));
+    
+    uint64_t size = 0;
+    ASSERT_FALSE(llvm::sys::fs::file_size(objPath, size));
+    EXPECT_GT(size, 0u);
+    llvm::sys::fs::remove(objPath);
+}
+
+TEST_F(CodeGenTest, SetTargetCPUAfterTargetMachineCreatedThrows) {
+    initializeCodeGen("test_module_cpu");
+    getCodeGen().setTargetCPU("native");
+    ASSERT_NE(getCodeGen().getTargetMachine(), nullptr);
+    EXPECT_THROW(getCodeGen().setTargetCPU("generic"), std::runtime_error);
+}
+
+static void buildMainReturning(ASTContext& ast, int exitCode) {
+    auto& cg = getCodeGen();
+    auto* mainFunc = llvm::Function::Create(
+        llvm::FunctionType::get(llvm::Type::getInt32Ty(cg.getContext()), false),
+        llvm::Function::ExternalLinkage, "main", &cg.getModule());
+    auto* entry = llvm::BasicBlock::Create(cg.getContext(), "entry", mainFunc);
+    cg.getBuilder().SetInsertPoint(entry);
+    
+    // x = exitCode - 1; return x + 1 (goes through a variable to exercise allocas)
+    auto assign = ast.create<AssignmentExprAST>("x", ast.create<NumberExprAST>(exitCode - 1.0));
+    ASSERT_NE(assign->codegen(), nullptr);
+    auto sum = ast.create<BinaryExprAST>('+',
+        ast.create<VariableExprAST>("x"), ast.create<NumberExprAST>(1.0));
+    auto* result = cg.getBuilder().CreateFPToSI(sum->codegen(), llvm::Type::getInt32Ty(cg.getContext()));
+    cg.getBuilder().CreateRet(result);
+    ASSERT_FALSE(llvm::verifyFunction(*mainFunc, &llvm::errs()));
+}
+
+TEST_F(CodeGenTest, RunWithJITCallsMain) {
+    initializeCodeGen("test_module_jit");
+    buildMainReturning(ast, 42);
+    EXPECT_EQ(runWithJIT(getCodeGen()), 42);
+}
+
+TEST_F(CodeGenTest, RunWithLazyJITCallsMain) {
+    initializeCodeGen("test_module_lazy_jit");
+    buildMainReturning(ast, 7);
+    EXPECT_EQ(runWithJIT(getCodeGen(), /*lazy=*/true), 7);
+}
+
+// Parse, type-check and generate a whole program into a fresh module's i32 main()
+static llvm::Function* compileProgram(const std::string& source, const std::string& moduleName) {
+    initializeCodeGen(moduleName);
+    auto& cg = getCodeGen();
+    auto* mainFunc = llvm::Function::Create(
+        llvm::FunctionType::get(llvm::Type::getInt32Ty(cg.getContext()), false),
+        llvm::Function::ExternalLinkage, "main", &cg.getModule());
+    cg.getBuilder().SetInsertPoint(llvm::BasicBlock::Create(cg.getContext(), "entry", mainFunc));
+    
+    Lexer lexer(source, "test.k");
+    Parser parser(lexer);
+    auto program = parser.parseProgram();
+    typeCheck(program.get(), "test.k");
+    if (!program->codegen()) return nullptr;
+    cg.getBuilder().CreateRet(llvm::ConstantInt::get(llvm::Type::getInt32Ty(cg.getContext()), 0));
+    return mainFunc;
+}
+
+// Collect calls to functions named __fn_* in f: direct ones and indirect ones
+static void countClosureCalls(llvm::Function* f, int& direct, int& indirect) {
+    direct = indirect = 0;
+    for (auto& bb : *f) {
+        for (auto& inst : bb) {
+            auto* call = llvm::dyn_cast<llvm::CallInst>(&inst);
+            if (!call) continue;
+            if (auto* callee = call->getCalledFunction()) {
+                if (callee->getName().substr(0, 5) == "__fn_") ++direct;
+            } else {
+                ++indirect;
+            }
+        }
+    }
+}
+
+// First closure body (__fn_N) emitted into the current module; N is global across modules
+static llvm::Function* firstClosureFunction() {
+    for (auto& f : getCodeGen().getModule()) {
+        if (f.getName().substr(0, 5) == "__fn_" && !f.isDeclaration()) return &f;
+    }
+    return nullptr;
+}
+
+TEST_F(CodeGenTest, KnownFunctionBindingIsCalledDirectly) {
+    auto* mainFunc = compileProgram("square = fn(x) => x * x; r = square(5);", "test_module_direct");
+    ASSERT_NE(mainFunc, nullptr);
+    ASSERT_FALSE(llvm::verifyModule(getCodeGen().getModule(), &llvm::errs()));
+    
+    int direct = 0, indirect = 0;
+    countClosureCalls(mainFunc, direct, indirect);
+    EXPECT_EQ(direct, 1);
+    EXPECT_EQ(indirect, 0);
+}
+
+TEST_F(CodeGenTest, RecursiveCallIsDirect) {
+    compileProgram("fact = fn(n) { mut r = 1; if (n > 1) { r = n * fact(n - 1); } else { } return r; };"
+                   "x = fact(5);", "test_module_direct_rec");
+    ASSERT_FALSE(llvm::verifyModule(getCodeGen().getModule(), &llvm::errs()));
+    
+    auto* fn = firstClosureFunction();
+    ASSERT_NE(fn, nullptr);
+    int direct = 0, indirect = 0;
+    countClosureCalls(fn, direct, indirect);
+    EXPECT_EQ(direct, 1);
+    EXPECT_EQ(indirect, 0);
+}
+
+static int countCallsTo(llvm::Function* fn, const std::string& callee) {
+    int count = 0;
+    for (auto& bb : *fn) {
+        for (auto& inst : bb) {
+            if (auto* call = llvm::dyn_cast<llvm::CallInst>(&inst)) {
+                auto* target = call->getCalledFunction();
+                if (target && target->getName() == callee) ++count;
+            }
+        }
+    }
+    return count;
+}
+
+TEST_F(CodeGenTest, RecursiveFunctionDoesNotAllocatePerCall) {
+    compileProgram("fact = fn(n) { mut r = 1; if (n > 1) { r = n * fact(n - 1); } else { } return r; };"
+                   "x = fact(5);", "test_module_rec_noalloc");
+    ASSERT_FALSE(llvm::verifyModule(getCodeGen().getModule(), &llvm::errs()));
+
+    auto* fn = firstClosureFunction();
+    ASSERT_NE(fn, nullptr);
+    EXPECT_EQ(countCallsTo(fn, "malloc"), 0);
+    EXPECT_EQ(countCallsTo(getCodeGen().getModule().getFunction("main"), "malloc"), 0);
+}
+
+TEST_F(CodeGenTest, RecursiveClosureWithCapturesDoesNotAllocatePerCall) {
+    compileProgram("k = 2; f = fn(n) { mut r = 0; if (n > 0) { r = k + f(n - 1); } else { } return r; };"
+                   "x = f(3);", "test_module_rec_capture_noalloc");
+    ASSERT_FALSE(llvm::verifyModule(getCodeGen().getModule(), &llvm::errs()));
+
+    auto* fn = firstClosureFunction();
+    ASSERT_NE(fn, nullptr);
+    EXPECT_EQ(countCallsTo(fn, "malloc"), 0);
+}
+
+TEST_F(CodeGenTest, FunctionParameterCallStaysIndirect) {
+    compileProgram("apply = fn(f, x) => f(x); sq = fn(x) => x * x; r = apply(sq, 5);",
+                   "test_module_indirect");
+    ASSERT_FALSE(llvm::verifyModule(getCodeGen().getModule(), &llvm::errs()));
+    
+    auto* applyFn = firstClosureFunction();
+    ASSERT_NE(applyFn, nullptr);
+    int direct = 0, indirect = 0;
+    countClosureCalls(applyFn, direct, indirect);
+    EXPECT_EQ(direct, 0);
+    EXPECT_EQ(indirect, 1);
+}
+
+TEST_F(CodeGenTest, ClosureCreationUsesArena) {
+    // f is returned through a parameter, so its closure may outlive main's frame
+    compileProgram("id = fn(g) => g; k = 3; f = fn(x) => x + k; h = id(f); y = h(1);",
+                   "test_module_arena_alloc");
+    ASSERT_FALSE(llvm::verifyModule(getCodeGen().getModule(), &llvm::errs()));
+
+    auto* mainFn = getCodeGen().getModule().getFunction("main");
+    ASSERT_NE(mainFn, nullptr);
+    EXPECT_EQ(countCallsTo(mainFn, "malloc"), 0);
+    EXPECT_EQ(countCallsTo(mainFn, "__arith_arena_alloc"), 2);  // env + bundle
+}
+
+TEST_F(CodeGenTest, LoopReleasesIterationLocalClosures) {
+    // f is captured by g, so it is heap-allocated, but neither outlives the iteration
+    compileProgram("mut i = 0; mut s = 0;"
+                   "while (i < 3) { f = fn(x) => x + i; g = fn(y) => f(y) * 2; s = s + g(1); i = i + 1; }",
+                   "test_module_arena_release");
+    ASSERT_FALSE(llvm::verifyModule(getCodeGen().getModule(), &llvm::errs()));
+
+    auto* mainFn = getCodeGen().getModule().getFunction("main");
+    EXPECT_EQ(countCallsTo(mainFn, "__arith_arena_mark"), 1);
+    EXPECT_EQ(countCallsTo(mainFn, "__arith_arena_release"), 1);
+}
+
+TEST_F(CodeGenTest, LoopKeepsClosuresThatOutliveIteration) {
+    compileProgram("mut i = 0; mut g = fn(x) => x;"
+                   "while (i < 3) { g = fn(x) => x + i; i = i + 1; }"
+                   "y = g(1);",
+                   "test_module_arena_escape");
+    ASSERT_FALSE(llvm::verifyModule(getCodeGen().getModule(), &llvm::errs()));
+
+    auto* mainFn = getCodeGen().getModule().getFunction("main");
+    EXPECT_EQ(countCallsTo(mainFn, "__arith_arena_release"), 0);
+}
+
+TEST_F(CodeGenTest, LoopCallingOuterFunctionKeepsClosures) {
+    compileProgram("apply = fn(f, x) => f(x); mut i = 0; mut s = 0;"
+                   "while (i < 3) { s = s + apply(fn(x) => x * 2, i); i = i + 1; }",
+                   "test_module_arena_outer_call");
+    ASSERT_FALSE(llvm::verifyModule(getCodeGen().getModule(), &llvm::errs()));
+
+    auto* mainFn = getCodeGen().getModule().getFunction("main");
+    EXPECT_EQ(countCallsTo(mainFn, "__arith_arena_release"), 0);
+}
+
+static int countAllocasNamed(llvm::Function* fn, const std::string& prefix) {
+    int count = 0;
+    for (auto& inst : fn->getEntryBlock()) {
+        if (llvm::isa<llvm::AllocaInst>(inst) && inst.getName().str().rfind(prefix, 0) == 0) ++count;
+    }
+    return count;
+}
+
+TEST_F(CodeGenTest, NonEscapingClosureLivesOnStack) {
+    compileProgram("k = 3; f = fn(x) => x + k; y = f(1);", "test_module_stack_closure");
+    ASSERT_FALSE(llvm::verifyModule(getCodeGen().getModule(), &llvm::errs()));
+
+    auto* mainFn = getCodeGen().getModule().getFunction("main");
+    EXPECT_EQ(countCallsTo(mainFn, "__arith_arena_alloc"), 0);
+    EXPECT_EQ(countAllocasNamed(mainFn, "env_mem"), 1);
+    EXPECT_EQ(countAllocasNamed(mainFn, "closure_bundle"), 1);
+}
+
+TEST_F(CodeGenTest, NonEscapingMutableCaptureCellLivesOnStack) {
+    compileProgram("mut c = 0; inc = fn() mut(c) { c = c + 1; return c; }; a = inc(); b = inc();",
+                   "test_module_stack_cell");
+    ASSERT_FALSE(llvm::verifyModule(getCodeGen().getModule(), &llvm::errs()));
+
+    auto* mainFn = getCodeGen().getModule().getFunction("main");
+    EXPECT_EQ(countCallsTo(mainFn, "__arith_arena_alloc"), 0);
+    EXPECT_EQ(countAllocasNamed(mainFn, "c_mut_cell"), 1);
+}
+
+TEST_F(CodeGenTest, ClosureCapturedByAnotherClosureEscapes) {
+    compileProgram("k = 3; f = fn(x) => x + k; g = fn(y) => f(y); z = g(1);",
+                   "test_module_captured_escapes");
+    ASSERT_FALSE(llvm::verifyModule(getCodeGen().getModule(), &llvm::errs()));
+
+    // f's env and bundle come from the arena; g itself stays on the stack
+    auto* mainFn = getCodeGen().getModule().getFunction("main");
+    EXPECT_EQ(countCallsTo(mainFn, "__arith_arena_alloc"), 2);
+    EXPECT_EQ(countAllocasNamed(mainFn, "env_mem"), 1);
+}
+
+TEST_F(CodeGenTest, ClosurePassedToCallingParameterLivesOnStack) {
+    compileProgram("apply = fn(f, x) => f(x); k = 2; scale = fn(x) => x * k; r = apply(scale, 5);",
+                   "test_module_stack_arg");
+    ASSERT_FALSE(llvm::verifyModule(getCodeGen().getModule(), &llvm::errs()));
+
+    auto* mainFn = getCodeGen().getModule().getFunction("main");
+    EXPECT_EQ(countCallsTo(mainFn, "__arith_arena_alloc"), 0);
+}
+
+TEST_F(CodeGenTest, MutableCaptureIsAccessedThroughCell) {
+    compileProgram("mut a = 1; mut b = 2; f = fn() mut(a, b) { a = a + 1; return a; }; x = f();",
+                   "test_module_capture_cell");
+    ASSERT_FALSE(llvm::verifyModule(getCodeGen().getModule(), &llvm::errs()));
+
+    // No local copies of the captures, and only the cell that is written gets a store
+    auto* fn = firstClosureFunction();
+    ASSERT_NE(fn, nullptr);
+    EXPECT_EQ(countAllocasNamed(fn, "a"), 0);
+    EXPECT_EQ(countAllocasNamed(fn, "b"), 0);
+    int stores = 0;
+    for (auto& bb : *fn) {
+        for (auto& inst : bb) {
+            if (llvm::isa<llvm::StoreInst>(inst)) ++stores;
+        }
+    }
+    EXPECT_EQ(stores, 1);
+}
+
+TEST_F(CodeGenTest, FunctionTypedVariableCallSkipsBundleDecoding) {
+    compileProgram("mut g = fn(x) => x + 1; g = fn(x) => x * 2; y = g(3);", "test_module_closure_slot");
+    ASSERT_FALSE(llvm::verifyModule(getCodeGen().getModule(), &llvm::errs()));
+
+    // g lives in a { fn, env, bundle } slot: the call reads fn/env from it, never from the bundle
+    auto* mainFn = getCodeGen().getModule().getFunction("main");
+    EXPECT_EQ(countAllocasNamed(mainFn, "g"), 1);
+    int bundleLoads = 0;
+    for (auto& bb : *mainFn) {
+        for (auto& inst : bb) {
+            if (auto* load = llvm::dyn_cast<llvm::LoadInst>(&inst)) {
+                if (!llvm::isa<llvm::AllocaInst>(load->getPointerOperand())) ++bundleLoads;
+            }
+        }
+    }
+    EXPECT_EQ(bundleLoads, 0);
+    auto* slot = llvm::cast<llvm::AllocaInst>(getCodeGen().getVariable("g"));
+    EXPECT_TRUE(slot->getAllocatedType()->isStructTy());
+}
+
+static int countAllocas(llvm::Function* fn) {
+    int count = 0;
+    for (auto& inst : fn->getEntryBlock()) {
+        if (llvm::isa<llvm::AllocaInst>(inst)) ++count;
+    }
+    return count;
+}
+
+TEST_F(CodeGenTest, ShadowingBindingReusesSlot) {
+    compileProgram("mut x = 1; mut x = x + 1; mut x = x * 3; print x;", "test_module_slot_shadow");
+    ASSERT_FALSE(llvm::verifyModule(getCodeGen().getModule(), &llvm::errs()));
+    EXPECT_EQ(countAllocas(getCodeGen().getModule().getFunction("main")), 1);
+}
+
+TEST_F(CodeGenTest, DisjointScopesShareSlots) {
+    compileProgram("mut s = 0; if (s < 1) { a = 1; b = a + 1; s = b; } else { c = 2; s = c; }"
+                   "while (s < 10) { d = s * 2; s = d; }", "test_module_slot_scopes");
+    ASSERT_FALSE(llvm::verifyModule(getCodeGen().getModule(), &llvm::errs()));
+    // s plus the two slots the then-branch needs; else and the loop body reuse them
+    EXPECT_EQ(countAllocas(getCodeGen().getModule().getFunction("main")), 3);
+}
+
+TEST_F(CodeGenTest, LiveOuterBindingKeepsItsSlot) {
+    initializeCodeGen("test_module_slot_live");
+    auto& cg = getCodeGen();
+    auto* outer = cg.declareVariable("x", false);
+    cg.enterScope();
+    auto* inner = cg.declareVariable("y", false);
+    EXPECT_NE(inner, outer);
+    cg.exitScope();
+    EXPECT_EQ(cg.declareVariable("z", false), inner);
+    EXPECT_EQ(cg.getVariable("x"), outer);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -36,6 +36,28 @@ TEST(ErrorDisplayTest, MultipleLines) {
     EXPECT_THAT(output, HasSubstr("  ^"));
 }
 
+TEST(ErrorDisplayTest, SnippetFromSourceManager) {
+    Lexer lexer("x = 1;\r\ny = ;\nz = 3;", "managed.k");
+    // Report at the second ';' (line 2, after a CRLF)
+    Token tok = lexer.getNextToken();
+    int semicolons = 0;
+    while (!(tok.type == TOK_SEMICOLON && ++semicolons == 2)) tok = lexer.getNextToken();
+    ParseError error("Expected expression", tok.range.start);
+    testing::internal::CaptureStderr();
+    printParseError(error);
+    std::string output = testing::internal::GetCapturedStderr();
+    EXPECT_THAT(output, HasSubstr("managed.k:2:5: error: Expected expression"));
+    EXPECT_THAT(output, HasSubstr("y = ;\n    ^"));
+}
+
+TEST(ErrorDisplayTest, UnknownFileHasNoSnippet) {
+    ParseError error("module 'main' not found", SourceLocation{"never_loaded.k", 1, 1});
+    testing::internal::CaptureStderr();
+    printParseError(error);
+    std::string output = testing::internal::GetCapturedStderr();
+    EXPECT_EQ(output, "never_loaded.k:1:1: error: module 'main' not found\n");
+}
+
 // getLine helper tests
 TEST(GetLineTest, FirstLine) {
     std::string source = "line1\nline2\nline3";
@@ -9,17 +9,17 @@ class FunctionParserTest : public ::testing::Test {};
 
 // Helper: parse input, assert program with one statement, return the statement.
 static ASTNode* parseOneStatement(const std::string& input,
-                                  std::unique_ptr<ASTNode>& programOwner) {
+                                  std::unique_ptr<ProgramAST>& programOwner) {
     Lexer lexer(input);
     Parser parser(lexer);
     programOwner = parser.parseProgram();
     auto* prog = dynamic_cast<ProgramAST*>(programOwner.get());
     if (!prog || prog->getStatements().size() != 1) return nullptr;
-    return prog->getStatements()[0].get();
+    return prog->getStatements()[0];
 }
 
 TEST_F(FunctionParserTest, ExpressionFunctionNoParams) {
-    std::unique_ptr<ASTNode> owner;
+    std::unique_ptr<ProgramAST> owner;
     auto* stmt = parseOneStatement("f = fn() => 42;", owner);
     ASSERT_NE(stmt, nullptr);
 
@@ -35,7 +35,7 @@ TEST_F(FunctionParserTest, ExpressionFunctionNoParams) {
 }
 
 TEST_F(FunctionParserTest, ExpressionFunctionOneParam) {
-    std::unique_ptr<ASTNode> owner;
+    std::unique_ptr<ProgramAST> owner;
     auto* stmt = parseOneStatement("double = fn(x) => x + x;", owner);
     ASSERT_NE(stmt, nullptr);
 
@@ -51,7 +51,7 @@ TEST_F(FunctionParserTest, ExpressionFunctionOneParam) {
 }
 
 TEST_F(FunctionParserTest, ExpressionFunctionMultipleParams) {
-    std::unique_ptr<ASTNode> owner;
+    std::unique_ptr<ProgramAST> owner;
     auto* stmt = parseOneStatement("add = fn(x, y) => x + y;", owner);
     ASSERT_NE(stmt, nullptr);
 
@@ -70,7 +70,7 @@ TEST_F(FunctionParserTest, ExpressionFunctionMultipleParams) {
 }
 
 TEST_F(FunctionParserTest, ExpressionFunctionThreeParams) {
-    std::unique_ptr<ASTNode> owner;
+    std::unique_ptr<ProgramAST> owner;
     auto* stmt = parseOneStatement("f = fn(a, b, c) => a + b + c;", owner);
     ASSERT_NE(stmt, nullptr);
 
@@ -111,7 +111,7 @@ TEST_F(FunctionParserTest, MissingParenIsParseError) {
 }
 
 TEST_F(FunctionParserTest, CaptureListIsEmpty) {
-    std::unique_ptr<ASTNode> owner;
+    std::unique_ptr<ProgramAST> owner;
     auto* stmt = parseOneStatement("f = fn(x) => x;", owner);
     ASSERT_NE(stmt, nullptr);
     auto* assign = dynamic_cast<AssignmentExprAST*>(stmt);
@@ -124,7 +124,7 @@ TEST_F(FunctionParserTest, CaptureListIsEmpty) {
 // ---- Block-style function literal tests (US-004) ----
 
 TEST_F(FunctionParserTest, BlockFunctionIsNotExpressionFunction) {
-    std::unique_ptr<ASTNode> owner;
+    std::unique_ptr<ProgramAST> owner;
     auto* stmt = parseOneStatement("f = fn(x) { y = x * 2; };", owner);
     ASSERT_NE(stmt, nullptr);
 
@@ -140,7 +140,7 @@ TEST_F(FunctionParserTest, BlockFunctionIsNotExpressionFunction) {
 }
 
 TEST_F(FunctionParserTest, BlockFunctionBodyIsBlock) {
-    std::unique_ptr<ASTNode> owner;
+    std::unique_ptr<ProgramAST> owner;
     auto* stmt = parseOneStatement("f = fn(x) { y = x * 2; };", owner);
     ASSERT_NE(stmt, nullptr);
 
@@ -155,7 +155,7 @@ TEST_F(FunctionParserTest, BlockFunctionBodyIsBlock) {
 }
 
 TEST_F(FunctionParserTest, BlockFunctionWithReturnStatement) {
-    std::unique_ptr<ASTNode> owner;
+    std::unique_ptr<ProgramAST> owner;
     auto* stmt = parseOneStatement("f = fn(x) { return x * 2; };", owner);
     ASSERT_NE(stmt, nullptr);
 
@@ -169,13 +169,13 @@ TEST_F(FunctionParserTest, BlockFunctionWithReturnStatement) {
     ASSERT_NE(block, nullptr);
     ASSERT_EQ(block->getStatements().size(), 1u);
 
-    auto* ret = dynamic_cast<ReturnStmtAST*>(block->getStatements()[0].get());
+    auto* ret = dynamic_cast<ReturnStmtAST*>(block->getStatements()[0]);
     ASSERT_NE(ret, nullptr);
     EXPECT_TRUE(ret->hasValue());
 }
 
 TEST_F(FunctionParserTest, BlockFunctionMultipleStatements) {
-    std::unique_ptr<ASTNode> owner;
+    std::unique_ptr<ProgramAST> owner;
     auto* stmt = parseOneStatement("f = fn(x, y) { a = x + y; return a; };", owner);
     ASSERT_NE(stmt, nullptr);
 
@@ -188,13 +188,13 @@ TEST_F(FunctionParserTest, BlockFunctionMultipleStatements) {
     ASSERT_NE(block, nullptr);
     EXPECT_EQ(block->getStatements().size(), 2u);
 
-    auto* ret = dynamic_cast<ReturnStmtAST*>(block->getStatements()[1].get());
+    auto* ret = dynamic_cast<ReturnStmtAST*>(block->getStatements()[1]);
     ASSERT_NE(ret, nullptr);
     EXPECT_TRUE(ret->hasValue());
 }
 
 TEST_F(FunctionParserTest, BlockFunctionNoParams) {
-    std::unique_ptr<ASTNode> owner;
+    std::unique_ptr<ProgramAST> owner;
     auto* stmt = parseOneStatement("f = fn() { return 42; };", owner);
     ASSERT_NE(stmt, nullptr);
 
@@ -221,7 +221,7 @@ TEST_F(FunctionParserTest, MissingBraceOrArrowAfterParamsIsError) {
 // ---- Mutable parameter declaration tests (US-005) ----
 
 TEST_F(FunctionParserTest, AllImmutableParams) {
-    std::unique_ptr<ASTNode> owner;
+    std::unique_ptr<ProgramAST> owner;
     auto* stmt = parseOneStatement("f = fn(x, y) => x + y;", owner);
     ASSERT_NE(stmt, nullptr);
 
@@ -235,7 +235,7 @@ TEST_F(FunctionParserTest, AllImmutableParams) {
 }
 
 TEST_F(FunctionParserTest, AllMutableParams) {
-    std::unique_ptr<ASTNode> owner;
+    std::unique_ptr<ProgramAST> owner;
     auto* stmt = parseOneStatement("f = fn(mut x, mut y) => x + y;", owner);
     ASSERT_NE(stmt, nullptr);
 
@@ -251,7 +251,7 @@ TEST_F(FunctionParserTest, AllMutableParams) {
 }
 
 TEST_F(FunctionParserTest, MixedMutableImmutableParams) {
-    std::unique_ptr<ASTNode> owner;
+    std::unique_ptr<ProgramAST> owner;
     auto* stmt = parseOneStatement("f = fn(x, mut y) => x + y;", owner);
     ASSERT_NE(stmt, nullptr);
 
@@ -267,7 +267,7 @@ TEST_F(FunctionParserTest, MixedMutableImmutableParams) {
 }
 
 TEST_F(FunctionParserTest, SingleMutableParam) {
-    std::unique_ptr<ASTNode> owner;
+    std::unique_ptr<ProgramAST> owner;
     auto* stmt = parseOneStatement("f = fn(mut n) => n;", owner);
     ASSERT_NE(stmt, nullptr);
 
@@ -283,7 +283,7 @@ TEST_F(FunctionParserTest, SingleMutableParam) {
 // ---- Capture clause tests (US-006) ----
 
 TEST_F(FunctionParserTest, NoCaptureClauseGivesEmptyCaptures) {
-    std::unique_ptr<ASTNode> owner;
+    std::unique_ptr<ProgramAST> owner;
     auto* stmt = parseOneStatement("f = fn() { return 1; };", owner);
     ASSERT_NE(stmt, nullptr);
     auto* assign = dynamic_cast<AssignmentExprAST*>(stmt);
@@ -294,7 +294,7 @@ TEST_F(FunctionParserTest, NoCaptureClauseGivesEmptyCaptures) {
 }
 
 TEST_F(FunctionParserTest, SingleCaptureClause) {
-    std::unique_ptr<ASTNode> owner;
+    std::unique_ptr<ProgramAST> owner;
     auto* stmt = parseOneStatement("f = fn() mut(counter) { return counter; };", owner);
     ASSERT_NE(stmt, nullptr);
     auto* assign = dynamic_cast<AssignmentExprAST*>(stmt);
@@ -307,7 +307,7 @@ TEST_F(FunctionParserTest, SingleCaptureClause) {
 }
 
 TEST_F(FunctionParserTest, MultipleCaptureClause) {
-    std::unique_ptr<ASTNode> owner;
+    std::unique_ptr<ProgramAST> owner;
     auto* stmt = parseOneStatement("f = fn() mut(a, b, c) { return a; };", owner);
     ASSERT_NE(stmt, nullptr);
     auto* assign = dynamic_cast<AssignmentExprAST*>(stmt);
@@ -326,7 +326,7 @@ TEST_F(FunctionParserTest, MultipleCaptureClause) {
 // ---- Function call expression tests (US-007) ----
 
 TEST_F(FunctionParserTest, FunctionCallZeroArgs) {
-    std::unique_ptr<ASTNode> owner;
+    std::unique_ptr<ProgramAST> owner;
     auto* stmt = parseOneStatement("result = f();", owner);
     ASSERT_NE(stmt, nullptr);
 
@@ -343,7 +343,7 @@ TEST_F(FunctionParserTest, FunctionCallZeroArgs) {
 }
 
 TEST_F(FunctionParserTest, FunctionCallOneArg) {
-    std::unique_ptr<ASTNode> owner;
+    std::unique_ptr<ProgramAST> owner;
     auto* stmt = parseOneStatement("result = f(42);", owner);
     ASSERT_NE(stmt, nullptr);
 
@@ -360,7 +360,7 @@ TEST_F(FunctionParserTest, FunctionCallOneArg) {
 }
 
 TEST_F(FunctionParserTest, FunctionCallMultipleArgs) {
-    std::unique_ptr<ASTNode> owner;
+    std::unique_ptr<ProgramAST> owner;
     auto* stmt = parseOneStatement("result = f(1, 2, 3);", owner);
     ASSERT_NE(stmt, nullptr);
 
@@ -377,7 +377,7 @@ TEST_F(FunctionParserTest, FunctionCallMultipleArgs) {
 }
 
 TEST_F(FunctionParserTest, FunctionCallNested) {
-    std::unique_ptr<ASTNode> owner;
+    std::unique_ptr<ProgramAST> owner;
     auto* stmt = parseOneStatement("result = f(g(x));", owner);
     ASSERT_NE(stmt, nullptr);
 
@@ -392,7 +392,7 @@ TEST_F(FunctionParserTest, FunctionCallNested) {
     ASSERT_NE(outerCallee, nullptr);
     EXPECT_EQ(outerCallee->getName(), "f");
 
-    auto* innerCall = dynamic_cast<FunctionCallAST*>(outerCall->getArgs()[0].get());
+    auto* innerCall = dynamic_cast<FunctionCallAST*>(outerCall->getArgs()[0]);
     ASSERT_NE(innerCall, nullptr);
     ASSERT_EQ(innerCall->getArgs().size(), 1u);
 
@@ -401,10 +401,55 @@ TEST_F(FunctionParserTest, FunctionCallNested) {
     EXPECT_EQ(innerCallee->getName(), "g");
 }
 
+// ---- Closure resolution ----
+
+static std::vector<std::string_view> freeVarsOf(const FunctionLiteralAST* fnLit) {
+    return {fnLit->getFreeVars().begin(), fnLit->getFreeVars().end()};
+}
+
+TEST_F(FunctionParserTest, FreeVarsExcludeParamsCapturesAndLocals) {
+    std::unique_ptr<ProgramAST> owner;
+    auto* stmt = parseOneStatement(
+        "f = fn(a) mut(m) { t = a + b; m = t * c + b; return fn(x) => x + d; };", owner);
+    ASSERT_NE(stmt, nullptr);
+    auto* fnLit = dynamic_cast<FunctionLiteralAST*>(dynamic_cast<AssignmentExprAST*>(stmt)->getValue());
+    ASSERT_NE(fnLit, nullptr);
+    // First-use order, no duplicates; the nested literal's own reads stay with it
+    EXPECT_EQ(freeVarsOf(fnLit), (std::vector<std::string_view>{"b", "c"}));
+    EXPECT_FALSE(fnLit->isSelfReferential());
+
+    auto* block = dynamic_cast<BlockAST*>(fnLit->getBody());
+    auto* ret = dynamic_cast<ReturnStmtAST*>(block->getStatements()[2]);
+    auto* inner = dynamic_cast<FunctionLiteralAST*>(ret->getValue());
+    ASSERT_NE(inner, nullptr);
+    EXPECT_EQ(freeVarsOf(inner), (std::vector<std::string_view>{"d"}));
+}
+
+TEST_F(FunctionParserTest, SelfReferenceIsResolvedOnTheLiteral) {
+    std::unique_ptr<ProgramAST> owner;
+    auto* stmt = parseOneStatement("fact = fn(n) => n * fact(n - 1);", owner);
+    ASSERT_NE(stmt, nullptr);
+    auto* fnLit = dynamic_cast<FunctionLiteralAST*>(dynamic_cast<AssignmentExprAST*>(stmt)->getValue());
+    ASSERT_NE(fnLit, nullptr);
+    EXPECT_TRUE(fnLit->isSelfReferential());
+    EXPECT_EQ(fnLit->getSelfName(), "fact");
+
+    // A mutable binding is not a self reference; neither is a nested literal reading the name
+    stmt = parseOneStatement("mut g = fn(n) => g(n);", owner);
+    ASSERT_NE(stmt, nullptr);
+    fnLit = dynamic_cast<FunctionLiteralAST*>(dynamic_cast<AssignmentExprAST*>(stmt)->getValue());
+    EXPECT_FALSE(fnLit->isSelfReferential());
+    stmt = parseOneStatement("h = fn() => fn() => h;", owner);
+    ASSERT_NE(stmt, nullptr);
+    fnLit = dynamic_cast<FunctionLiteralAST*>(dynamic_cast<AssignmentExprAST*>(stmt)->getValue());
+    EXPECT_FALSE(fnLit->isSelfReferential());
+    EXPECT_TRUE(fnLit->getFreeVars().empty());
+}
+
 // ---- Type-checking tests (US-008) ----
 
 // Helper: parse a multi-statement program
-static std::unique_ptr<ASTNode> parseProgram(const std::string& input) {
+static std::unique_ptr<ProgramAST> parseProgram(const std::string& input) {
     Lexer lexer(input);
     Parser parser(lexer);
     return parser.parseProgram();
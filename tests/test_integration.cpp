@@ -2,6 +2,21 @@
 #include "lexer.h"
 #include "parser.h"
 #include "ast.h"
+#include "codegen.h"
+#include "module_cache.h"
+#include "module_compiler.h"
+#include "module_resolver.h"
+#include "function_ast.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/raw_ostream.h"
+#include <filesystem>
+#include <fstream>
+
+void initializeCodeGen(const std::string& moduleName, const std::string& sourceFile = "");
+CodeGen& getCodeGen();
 
 class IntegrationTest : public ::testing::Test {
 protected:
@@ -105,6 +120,292 @@ TEST_F(IntegrationTest, FactorialProgram) {
     EXPECT_GE(programAST->getStatements().size(), 4); // Should have at least 4 statements
 }
 
+// Module files are written to a fresh temporary directory per test
+class ModuleResolverTest : public ::testing::Test {
+protected:
+    std::filesystem::path dir;
+
+    void SetUp() override {
+        const auto* info = ::testing::UnitTest::GetInstance()->current_test_info();
+        dir = std::filesystem::temp_directory_path() / ("arith_modules_" + std::string(info->name()));
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+    }
+    void TearDown() override { std::filesystem::remove_all(dir); }
+
+    std::string write(const std::string& name, const std::string& text) {
+        auto path = dir / (name + ".k");
+        std::ofstream(path) << text;
+        return path.string();
+    }
+
+    static std::vector<std::string> assignedNames(const ProgramAST& program) {
+        std::vector<std::string> names;
+        for (auto* stmt : program.getStatements()) {
+            if (auto* assign = dyn_cast<AssignmentExprAST>(stmt)) names.emplace_back(assign->getVarName());
+        }
+        return names;
+    }
+};
+
+TEST_F(ModuleResolverTest, ManyModulesLoadInDependencyOrder) {
+    // main imports lib0..lib19, and every lib imports base: a wide fan-out with a shared leaf
+    write("base", "export b = 1;\nbaseLoaded = b;");
+    std::string mainText;
+    std::vector<std::string> expected{"baseLoaded"};
+    for (int i = 0; i < 20; ++i) {
+        std::string n = std::to_string(i);
+        write("lib" + n, "import { b } from \"base\";\nexport v" + n + " = b + " + n + ";\nlib" + n + " = v" + n + ";");
+        mainText += "import { v" + n + " } from \"lib" + n + "\";\n";
+        expected.push_back("lib" + n);
+    }
+    mainText += "total = v0 + v19;";
+    expected.push_back("total");
+
+    ModuleResolver resolver;
+    resolver.setMaxHelperThreads(4);
+    auto program = resolver.resolve(write("main", mainText));
+    ASSERT_NE(program, nullptr);
+    EXPECT_EQ(assignedNames(*program), expected);
+}
+
+TEST_F(ModuleResolverTest, CircularImportIsReported) {
+    write("a", "import { y } from \"b\";\nexport x = 1;");
+    write("b", "import { x } from \"a\";\nexport y = 2;");
+    std::string mainFile = write("main", "import { x } from \"a\";\nprint x;");
+
+    ModuleResolver resolver;
+    resolver.setMaxHelperThreads(4);
+    try {
+        resolver.resolve(mainFile);
+        FAIL() << "expected a circular dependency error";
+    } catch (const ParseError& e) {
+        EXPECT_NE(std::string(e.what()).find("circular dependency detected"), std::string::npos);
+        EXPECT_EQ(e.loc.line, 1);  // the import in b that closes the cycle
+        EXPECT_NE(e.loc.file.find("b.k"), std::string::npos);
+    }
+}
+
+TEST_F(ModuleResolverTest, MissingModuleIsReportedAtImportSite) {
+    write("lib", "export x = 1;");
+    std::string mainFile = write("main", "import { x } from \"lib\";\nimport { y } from \"nope\";\nprint x;");
+
+    ModuleResolver resolver;
+    resolver.setMaxHelperThreads(4);
+    try {
+        resolver.resolve(mainFile);
+        FAIL() << "expected a missing module error";
+    } catch (const ParseError& e) {
+        EXPECT_STREQ(e.what(), "module 'nope' not found");
+        EXPECT_EQ(e.loc.line, 2);
+    }
+}
+
+TEST_F(ModuleResolverTest, UnreadableModuleIsNotReportedAsMissing) {
+    std::filesystem::create_directory(dir / "lib.k");  // exists, but cannot be read as a file
+    std::string mainFile = write("main", "import { x } from \"lib\";\nprint x;");
+
+    ModuleResolver resolver;
+    try {
+        resolver.resolve(mainFile);
+        FAIL() << "expected a load error";
+    } catch (const ParseError& e) {
+        EXPECT_NE(std::string(e.what()).find("cannot load module 'lib': Cannot read file"), std::string::npos) << e.what();
+        EXPECT_EQ(e.loc.line, 1);
+    }
+}
+
+TEST_F(ModuleResolverTest, CacheIsReusedAndInvalidatedByContent) {
+    write("lib", "export x = 1;\nlibValue = x;");
+    std::string mainFile = write("main", "import { x } from \"lib\";\ntotal = x + 1;");
+    ModuleCache cache((dir / "cache").string());
+
+    for (int run = 0; run < 2; ++run) {
+        ModuleResolver resolver;
+        resolver.setCache(&cache);
+        auto program = resolver.resolve(mainFile);
+        EXPECT_EQ(assignedNames(*program), (std::vector<std::string>{"libValue", "total"}));
+    }
+    size_t entries = 0;
+    for (const auto& e : std::filesystem::directory_iterator(dir / "cache")) entries += e.path().extension() == ".kmc";
+    EXPECT_EQ(entries, 2u);
+
+    // An edited module is parsed again, not served from its old entry
+    write("lib", "export x = 1;\nchanged = x;");
+    ModuleResolver resolver;
+    resolver.setCache(&cache);
+    auto program = resolver.resolve(mainFile);
+    EXPECT_EQ(assignedNames(*program), (std::vector<std::string>{"changed", "total"}));
+}
+
+// Compile mainFile and its imports as arithc does; the result is getCodeGen().getModule()
+static void compileModules(const std::string& mainFile, unsigned optLevel = 0) {
+    initializeCodeGen("main", mainFile);
+    CodeGen& cg = getCodeGen();
+    auto* mainFn = llvm::Function::Create(llvm::FunctionType::get(cg.getBuilder().getInt32Ty(), false),
+                                          llvm::Function::ExternalLinkage, "main", cg.getModule());
+    cg.getBuilder().SetInsertPoint(llvm::BasicBlock::Create(cg.getContext(), "entry", mainFn));
+
+    ModuleResolver resolver;
+    auto modules = resolver.resolveModules(mainFile);
+    ModuleCompiler compiler(cg, optLevel);
+    for (size_t i = 0; i + 1 < modules.size(); ++i) compiler.compileLibrary(*modules[i]);
+    compiler.compileEntry(*modules.back());
+    cg.getBuilder().CreateRet(cg.getBuilder().getInt32(0));
+    if (optLevel > 0) cg.optimize(optLevel);
+    compiler.link();
+}
+
+// The global value whose name ends with suffix (symbols are prefixed with the module's path)
+static llvm::GlobalValue* findSymbol(llvm::Module& module, const std::string& suffix) {
+    for (auto& value : module.global_values()) {
+        std::string name = value.getName().str();
+        if (name.size() >= suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0) {
+            return &value;
+        }
+    }
+    return nullptr;
+}
+
+TEST_F(ModuleResolverTest, ModulesAreCompiledSeparatelyAndLinked) {
+    write("lib", "hidden = 2;\nscale = fn(x) => x * hidden;\nexport twice = fn(x) => x * 2;\nexport { scale };");
+    std::string mainFile = write("main", "import { scale, twice as doubled } from \"lib\";\n"
+                                         "hidden = 5;\nprint scale(doubled(hidden));");
+    compileModules(mainFile);
+    llvm::Module& module = getCodeGen().getModule();
+    ASSERT_FALSE(llvm::verifyModule(module, &llvm::errs()));
+
+    // lib's top-level code became an init function that main runs before its own code
+    auto* init = llvm::dyn_cast_or_null<llvm::Function>(findSymbol(module, "lib..init"));
+    ASSERT_NE(init, nullptr);
+    EXPECT_FALSE(init->isDeclaration());
+    llvm::CallInst* firstCall = nullptr;
+    for (auto& inst : module.getFunction("main")->getEntryBlock()) {
+        if ((firstCall = llvm::dyn_cast<llvm::CallInst>(&inst))) break;
+    }
+    ASSERT_NE(firstCall, nullptr);
+    EXPECT_EQ(firstCall->getCalledFunction(), init);
+
+    // Exports are globals; the capture-free one is also a function main calls directly. After
+    // linking only main is still external.
+    for (const char* name : {"lib.scale", "lib.twice"}) {
+        auto* global = findSymbol(module, name);
+        ASSERT_NE(global, nullptr) << name;
+        EXPECT_TRUE(global->hasLocalLinkage()) << name;
+    }
+    EXPECT_EQ(findSymbol(module, "lib.hidden"), nullptr);
+    auto* twice = llvm::dyn_cast_or_null<llvm::Function>(findSymbol(module, "lib.twice.fn"));
+    ASSERT_NE(twice, nullptr);
+    EXPECT_TRUE(twice->hasLocalLinkage());
+    EXPECT_FALSE(twice->isDeclaration());
+    EXPECT_FALSE(twice->users().empty());
+    EXPECT_TRUE(init->hasLocalLinkage());
+    EXPECT_TRUE(module.getFunction("main")->hasExternalLinkage());
+}
+
+TEST_F(ModuleResolverTest, LinkedProgramIsOptimizedAcrossModules) {
+    write("lib", "export twice = fn(x) => x * 2;\nexport base = 20;");
+    compileModules(write("main", "import { twice, base } from \"lib\";\nprint twice(base) + 2;"), 2);
+    llvm::Module& module = getCodeGen().getModule();
+    ASSERT_FALSE(llvm::verifyModule(module, &llvm::errs()));
+
+    // The init function was inlined into main, the export globals folded away, and the call
+    // through the import evaluated at compile time
+    EXPECT_EQ(findSymbol(module, "lib..init"), nullptr);
+    EXPECT_EQ(findSymbol(module, "lib.twice"), nullptr);
+    EXPECT_EQ(findSymbol(module, "lib.base"), nullptr);
+    bool printsConstant = false;
+    for (auto& inst : llvm::instructions(*module.getFunction("main"))) {
+        auto* call = llvm::dyn_cast<llvm::CallInst>(&inst);
+        if (!call || !call->getCalledFunction() || call->getCalledFunction()->getName() != "printf") continue;
+        auto* value = llvm::dyn_cast<llvm::ConstantFP>(call->getArgOperand(1));
+        printsConstant = value && value->isExactlyValue(42.0);
+    }
+    EXPECT_TRUE(printsConstant);
+}
+
+TEST_F(ModuleResolverTest, OnlyExportedNamesAreVisibleToImporters) {
+    write("lib", "hidden = 2;\nshown = hidden;\nexport { shown };");
+    try {
+        compileModules(write("main", "import { shown } from \"lib\";\nprint hidden;"));
+        FAIL() << "expected an unknown name error";
+    } catch (const ParseError& e) {
+        EXPECT_STREQ(e.what(), "cannot find value 'hidden' in this scope");
+        EXPECT_EQ(e.loc.line, 2);
+    }
+    try {
+        compileModules(write("other", "import { hidden } from \"lib\";"));
+        FAIL() << "expected a not exported error";
+    } catch (const ParseError& e) {
+        EXPECT_STREQ(e.what(), "'hidden' is not exported by module 'lib'");
+    }
+}
+
+static const char* kCacheRoundTripSource =
+    "import { PI as pi, square } from \"math\";\n"
+    "export limit = 10;\n"
+    "mut n = 0;\n"
+    "counter = fn(step) mut(n) { n = n + step; return n; };\n"
+    "fact = fn(k) { r = 1; if (k > 1) { r = k * fact(k - 1); } else { } return r; };\n"
+    "while (n < limit) { counter(1); }\n"
+    "if (-n == 0) { print \"zero\\n\"; } else { print \"%d %s\\n\", n, \"done\"; }\n";
+
+TEST(ModuleCacheTest, RoundTripPreservesTree) {
+    const auto& buffer = getSourceManager().addBuffer("cache_roundtrip.k", kCacheRoundTripSource);
+    Lexer lexer(buffer);
+    Parser parser(lexer);
+    auto program = parser.parseProgram();
+
+    std::string data = serializeModule(*program, buffer);
+    ASSERT_FALSE(data.empty());
+    auto loaded = deserializeModule(data, buffer);
+    ASSERT_NE(loaded, nullptr);
+    EXPECT_EQ(serializeModule(*loaded, buffer), data);
+
+    // Locations come back in the same buffer, closure annotations without a re-walk
+    ASSERT_EQ(loaded->getStatements().size(), program->getStatements().size());
+    auto* original = cast<AssignmentExprAST>(program->getStatements()[1]);
+    auto* copy = cast<AssignmentExprAST>(loaded->getStatements()[1]);
+    EXPECT_EQ(copy->getNameLocation().raw, original->getNameLocation().raw);
+    auto* fact = cast<FunctionLiteralAST>(cast<AssignmentExprAST>(loaded->getStatements()[2])->getValue());
+    EXPECT_EQ(fact->getSelfName(), "fact");
+    EXPECT_EQ(loaded->getImports()[0]->getSymbols()[0].alias, "pi");
+}
+
+TEST(ModuleCacheTest, RejectsStaleOrDamagedEntries) {
+    const auto& buffer = getSourceManager().addBuffer("cache_damaged.k", kCacheRoundTripSource);
+    Lexer lexer(buffer);
+    Parser parser(lexer);
+    auto program = parser.parseProgram();
+    std::string data = serializeModule(*program, buffer);
+
+    // Same length, different contents
+    std::string edited = kCacheRoundTripSource;
+    edited[edited.find("10")] = '2';
+    const auto& other = getSourceManager().addBuffer("cache_damaged.k", edited);
+    EXPECT_EQ(deserializeModule(data, other), nullptr);
+
+    for (size_t len = 0; len < data.size(); ++len) {
+        EXPECT_EQ(deserializeModule(std::string_view(data.data(), len), buffer), nullptr) << "truncated to " << len;
+    }
+    EXPECT_EQ(deserializeModule(data + "x", buffer), nullptr);
+}
+
+TEST(ModuleCacheTest, RejectsEntryWithAnyByteChanged) {
+    const auto& buffer = getSourceManager().addBuffer("cache_flipped.k", kCacheRoundTripSource);
+    Lexer lexer(buffer);
+    Parser parser(lexer);
+    auto program = parser.parseProgram();
+    std::string data = serializeModule(*program, buffer);
+
+    // Covers the tree after the header too, e.g. a changed number literal that still decodes
+    for (size_t i = 0; i < data.size(); ++i) {
+        std::string damaged = data;
+        damaged[i] = static_cast<char>(damaged[i] ^ 0x01);
+        EXPECT_EQ(deserializeModule(damaged, buffer), nullptr) << "byte " << i << " flipped";
+    }
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -6,6 +6,8 @@
 
 using ::testing::HasSubstr;
 
+static SourceLocation presumed(SourceLoc loc) { return getSourceManager().getPresumedLoc(loc); }
+
 // 3.1 Parser Integration Tests
 TEST(ParserIntegrationTest, MissingSemicolonError) {
     std::string source = "print 42";
@@ -68,16 +70,16 @@ TEST(EdgeCaseTest, EmptyFile) {
     Lexer lexer("", "test.k");
     Token token = lexer.getNextToken();
     EXPECT_EQ(token.type, TOK_EOF);
-    EXPECT_EQ(token.range.start.line, 1);
-    EXPECT_EQ(token.range.start.column, 1);
+    EXPECT_EQ(presumed(token.range.start).line, 1);
+    EXPECT_EQ(presumed(token.range.start).column, 1);
 }
 
 TEST(EdgeCaseTest, OnlyWhitespace) {
     Lexer lexer("   \t\n  ", "test.k");
     Token token = lexer.getNextToken();
     EXPECT_EQ(token.type, TOK_EOF);
-    EXPECT_EQ(token.range.start.line, 2);
-    EXPECT_EQ(token.range.start.column, 3);
+    EXPECT_EQ(presumed(token.range.start).line, 2);
+    EXPECT_EQ(presumed(token.range.start).column, 3);
 }
 
 TEST(EdgeCaseTest, VeryLongLine) {
@@ -96,19 +98,19 @@ TEST(EdgeCaseTest, UnicodeCharacters) {
     Lexer lexer(source, "test.k");
     Token token1 = lexer.getNextToken(); // identifier
     EXPECT_EQ(token1.type, TOK_IDENTIFIER);
-    EXPECT_EQ(token1.range.start.column, 1);
+    EXPECT_EQ(presumed(token1.range.start).column, 1);
     Token token2 = lexer.getNextToken(); // '='
     EXPECT_EQ(token2.type, TOK_ASSIGN);
-    EXPECT_EQ(token2.range.start.column, 8); // byte-based: 6 bytes + space
+    EXPECT_EQ(presumed(token2.range.start).column, 8); // byte-based: 6 bytes + space
 }
 
 TEST(EdgeCaseTest, CarriageReturn) {
     Lexer lexer("x\r\ny", "test.k");
     Token token1 = lexer.getNextToken();
-    EXPECT_EQ(token1.range.start.line, 1);
+    EXPECT_EQ(presumed(token1.range.start).line, 1);
     Token token2 = lexer.getNextToken();
-    EXPECT_EQ(token2.range.start.line, 2);
-    EXPECT_EQ(token2.range.start.column, 1);
+    EXPECT_EQ(presumed(token2.range.start).line, 2);
+    EXPECT_EQ(presumed(token2.range.start).column, 1);
 }
 
 // 3.4 Backward Compatibility Tests
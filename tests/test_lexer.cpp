@@ -1,5 +1,13 @@
 #include <gtest/gtest.h>
 #include "lexer.h"
+#include "source_manager.h"
+#include "simd_scan.h"
+#include "number_parse.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
 
 // Comment Processing Tests
 class CommentTest : public ::testing::Test {
@@ -333,6 +341,243 @@ TEST_F(LexerEdgeCaseTest, IncompleteComment) {
     EXPECT_EQ(token5.type, TOK_EOF);
 }
 
+// Zero-copy token values
+class LexerSliceTest : public ::testing::Test {
+protected:
+    void SetUp() override {}
+    void TearDown() override {}
+};
+
+static bool pointsInto(std::string_view slice, std::string_view buffer) {
+    return slice.data() >= buffer.data() && slice.data() + slice.size() <= buffer.data() + buffer.size();
+}
+
+TEST_F(LexerSliceTest, TokenValuesAreSlicesOfInput) {
+    const auto& buffer = getSourceManager().addBuffer("slices.k", "total = 12.5 + \"plain\";");
+    std::string_view input = buffer.text;
+    Lexer lexer(buffer);
+
+    Token ident = lexer.getNextToken();
+    EXPECT_EQ(ident.value, "total");
+    EXPECT_TRUE(pointsInto(ident.value, input));
+
+    Token assign = lexer.getNextToken();
+    EXPECT_EQ(assign.value, "=");
+
+    Token number = lexer.getNextToken();
+    EXPECT_EQ(number.value, "12.5");
+    EXPECT_DOUBLE_EQ(number.numValue, 12.5);
+    EXPECT_TRUE(pointsInto(number.value, input));
+
+    lexer.getNextToken();  // +
+    Token str = lexer.getNextToken();
+    EXPECT_EQ(str.type, TOK_STRING);
+    EXPECT_EQ(str.value, "plain");
+    EXPECT_TRUE(pointsInto(str.value, input));
+}
+
+TEST_F(LexerSliceTest, EscapedStringIsDecodedOutOfLine) {
+    const auto& buffer = getSourceManager().addBuffer("escapes.k", "\"a\\tb\\\"c\" \"d\\n\"");
+    std::string_view input = buffer.text;
+    Lexer lexer(buffer);
+
+    Token first = lexer.getNextToken();
+    EXPECT_EQ(first.value, "a\tb\"c");
+    EXPECT_FALSE(pointsInto(first.value, input));
+
+    // Earlier decoded values stay valid while later literals are lexed
+    Token second = lexer.getNextToken();
+    EXPECT_EQ(second.value, "d\n");
+    EXPECT_EQ(first.value, "a\tb\"c");
+}
+
+TEST_F(LexerSliceTest, LexesSourceManagerBuffer) {
+    const std::string path = ::testing::TempDir() + "lexer_slice_test.k";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "x = 1;\n";
+    }
+    SourceManager sources;
+    const auto& buffer = sources.loadFile(path);
+    EXPECT_EQ(&sources.loadFile(path), &buffer);  // loaded once
+    EXPECT_EQ(buffer.text, "x = 1;\n");
+
+    Lexer lexer(buffer);
+    Token ident = lexer.getNextToken();
+    EXPECT_EQ(ident.value, "x");
+    EXPECT_EQ(ident.value.data(), buffer.text.data());
+    std::remove(path.c_str());
+
+    EXPECT_THROW(sources.loadFile(path + ".missing"), std::runtime_error);
+}
+
+TEST_F(LexerSliceTest, TextIsCopiedSoLocationsOutliveIt) {
+    SourceLoc loc;
+    {
+        std::string text = "first = 1;\nsecond = 2;";
+        Lexer lexer(text, "copied.k");
+        lexer.getNextToken();
+        lexer.getNextToken();
+        lexer.getNextToken();
+        lexer.getNextToken();  // ;
+        loc = lexer.getNextToken().range.start;
+        text.assign(text.size(), '#');
+    }
+    // The diagnostic path resolves the location after the caller's string is gone
+    SourceLocation where = getSourceManager().getPresumedLoc(loc);
+    EXPECT_EQ(where.file, "copied.k");
+    EXPECT_EQ(where.line, 2);
+    const auto* buffer = getSourceManager().getBufferFor(loc);
+    ASSERT_NE(buffer, nullptr);
+    EXPECT_EQ(getSourceManager().getLineText(*buffer, 2), "second = 2;");
+}
+
+// Keyword table and identifier interning
+class LexerKeywordTest : public ::testing::Test {
+protected:
+    void SetUp() override {}
+    void TearDown() override {}
+};
+
+TEST_F(LexerKeywordTest, AllKeywordsRecognized) {
+    std::string input = "print if else while mut fn return import export from as default";
+    Lexer lexer(input);
+    const TokenType expected[] = {TOK_PRINT, TOK_IF, TOK_ELSE, TOK_WHILE, TOK_MUT, TOK_FN, TOK_RETURN,
+                                  TOK_IMPORT, TOK_EXPORT, TOK_FROM, TOK_AS, TOK_DEFAULT};
+    for (TokenType type : expected) {
+        EXPECT_EQ(lexer.getNextToken().type, type);
+    }
+    EXPECT_EQ(lexer.getNextToken().type, TOK_EOF);
+}
+
+TEST_F(LexerKeywordTest, NearMissesAreIdentifiers) {
+    std::string input = "prints i iff els mutable f fm returns imports exports fro a ass defaults Print _if";
+    Lexer lexer(input);
+    for (Token tok = lexer.getNextToken(); tok.type != TOK_EOF; tok = lexer.getNextToken()) {
+        EXPECT_EQ(tok.type, TOK_IDENTIFIER) << tok.value;
+    }
+}
+
+TEST_F(LexerKeywordTest, IdentifiersAreInterned) {
+    std::string input = "count = count + total; total = count;";
+    Lexer lexer(input);
+    std::vector<Token> idents;
+    for (Token tok = lexer.getNextToken(); tok.type != TOK_EOF; tok = lexer.getNextToken()) {
+        if (tok.type == TOK_IDENTIFIER) idents.push_back(tok);
+    }
+    ASSERT_EQ(idents.size(), 5u);
+    EXPECT_EQ(idents[0].value.data(), idents[1].value.data());
+    EXPECT_EQ(idents[0].value.data(), idents[4].value.data());
+    EXPECT_EQ(idents[2].value.data(), idents[3].value.data());
+    EXPECT_NE(idents[0].value.data(), idents[2].value.data());
+    EXPECT_EQ(lexer.getIdentifierTable().size(), 2u);
+}
+
+TEST_F(LexerKeywordTest, IdentifierTableGrows) {
+    std::vector<std::string> names;
+    for (int i = 0; i < 5000; ++i) names.push_back("name" + std::to_string(i));
+    IdentifierTable table;
+    for (const auto& n : names) table.intern(n);
+    EXPECT_EQ(table.size(), names.size());
+    for (const auto& n : names) {
+        std::string copy = n;
+        EXPECT_EQ(table.intern(copy).data(), n.data());
+    }
+}
+
+TEST_F(LexerKeywordTest, HashIdentifierIsFnv1a64) {
+    EXPECT_EQ(hashIdentifier(""), 0xcbf29ce484222325ull);
+    EXPECT_EQ(hashIdentifier("a"), 0xaf63dc4c8601ec8cull);
+    EXPECT_EQ(hashIdentifier("foobar"), 0x85944171f73967e8ull);
+}
+
+// Vectorized scanners agree with the scalar ones at every supported level
+class SimdScanTest : public ::testing::Test {
+protected:
+    void SetUp() override {}
+    void TearDown() override {}
+};
+
+TEST_F(SimdScanTest, LevelsMatchScalarOnRandomInput) {
+    using namespace simd_scan;
+    const char alphabet[] = {' ', '\t', '\n', '\r', '\v', '\f', '"', '\\', '\0', 'a', '/', '\x80', '\xff', '8', '\x0e'};
+    unsigned seed = 12345;
+    auto next = [&seed] { seed = seed * 1103515245u + 12345u; return seed >> 16; };
+    const Scanners& scalar = getScanners(Level::Scalar);
+    for (Level level : {Level::SSE2, Level::AVX2}) {
+        if (!isSupported(level)) continue;
+        const Scanners& simd = getScanners(level);
+        for (int trial = 0; trial < 2000; ++trial) {
+            // Mostly-uniform runs so stop bytes land in every lane of a block
+            std::string buf(next() % 100, ' ');
+            char fill = alphabet[next() % sizeof(alphabet)];
+            for (auto& c : buf) c = (next() % 8) ? fill : alphabet[next() % sizeof(alphabet)];
+            for (size_t off = 0; off < std::min<size_t>(buf.size(), 3); ++off) {
+                const char* p = buf.data() + off;
+                size_t n = buf.size() - off;
+                ASSERT_EQ(simd.whitespace(p, n), scalar.whitespace(p, n));
+                ASSERT_EQ(simd.lineEnd(p, n), scalar.lineEnd(p, n));
+                ASSERT_EQ(simd.stringBody(p, n), scalar.stringBody(p, n));
+            }
+        }
+    }
+}
+
+TEST_F(SimdScanTest, LongRunsAcrossBlocks) {
+    std::string input = std::string(70, ' ') + "// " + std::string(90, 'c') + "\r\n" +
+                        std::string(33, '\t') + "\"" + std::string(40, 's') + "\\n" +
+                        std::string(20, 't') + "\" x";
+    Lexer lexer(input);
+    Token str = lexer.getNextToken();
+    ASSERT_EQ(str.type, TOK_STRING);
+    EXPECT_EQ(str.value, std::string(40, 's') + "\n" + std::string(20, 't'));
+    Token ident = lexer.getNextToken();
+    EXPECT_EQ(ident.value, "x");
+    EXPECT_EQ(lexer.getNextToken().type, TOK_EOF);
+}
+
+// Numeric literals are parsed in place and must round exactly like strtod
+class NumberParseTest : public ::testing::Test {
+protected:
+    void SetUp() override {}
+    void TearDown() override {}
+};
+
+TEST_F(NumberParseTest, MatchesStrtodOnRandomLiterals) {
+    unsigned seed = 4242;
+    auto next = [&seed] { seed = seed * 1103515245u + 12345u; return seed >> 16; };
+    for (int trial = 0; trial < 20000; ++trial) {
+        // Short literals hit the fast path; long ones and big exponents the fallback
+        std::string text(next() % 4 == 0 ? next() % 4 : 0, '0');
+        size_t intDigits = 1 + next() % (trial % 3 == 0 ? 30 : 10);
+        for (size_t i = 0; i < intDigits; ++i) text += static_cast<char>('0' + next() % 10);
+        if (next() % 2) {
+            text += '.';
+            size_t fracDigits = 1 + next() % (trial % 5 == 0 ? 40 : 8);
+            for (size_t i = 0; i < fracDigits; ++i) text += static_cast<char>('0' + next() % 10);
+        }
+        double expected = std::strtod(text.c_str(), nullptr);
+        ASSERT_EQ(parseDecimalLiteral(text), expected) << text;
+    }
+}
+
+TEST_F(NumberParseTest, ExactBoundaries) {
+    EXPECT_EQ(parseDecimalLiteral("9007199254740993"), 9007199254740992.0);  // 2^53 + 1 rounds to even
+    EXPECT_EQ(parseDecimalLiteral("0.000000000000000000000001"), 1e-24);
+    EXPECT_EQ(parseDecimalLiteral("1000000000000000000000000"), 1e24);
+    EXPECT_EQ(parseDecimalLiteral("0.1"), 0.1);
+    EXPECT_EQ(parseDecimalLiteral("000.000"), 0.0);
+}
+
+TEST_F(NumberParseTest, OutOfRangeThrows) {
+    EXPECT_THROW(parseDecimalLiteral("1" + std::string(400, '0')), std::runtime_error);
+    std::string input = "x = 1" + std::string(400, '0') + ";";
+    Lexer lexer(input);
+    lexer.getNextToken();
+    lexer.getNextToken();
+    EXPECT_THROW(lexer.getNextToken(), std::runtime_error);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -4,8 +4,11 @@
 #include "../include/codegen.h"
 #include "../include/type_check.h"
 #include "../include/ast.h"
+#include "../include/scoped_symbol_table.h"
 #include <memory>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 void initializeCodeGen(const std::string& moduleName, const std::string& sourceFile = "");
 CodeGen& getCodeGen();
@@ -21,7 +24,7 @@ protected:
     }
     
     // Helper to parse program and get assignment AST
-    std::unique_ptr<ASTNode> parseProgram(const std::string& input) {
+    std::unique_ptr<ProgramAST> parseProgram(const std::string& input) {
         Lexer lexer(input, "test.k");
         Parser parser(lexer);
         return parser.parseProgram();
@@ -31,7 +34,7 @@ protected:
     AssignmentExprAST* getFirstAssignment(ASTNode* program) {
         auto* prog = dynamic_cast<ProgramAST*>(program);
         if (!prog || prog->getStatements().empty()) return nullptr;
-        return dynamic_cast<AssignmentExprAST*>(prog->getStatements()[0].get());
+        return dynamic_cast<AssignmentExprAST*>(prog->getStatements()[0]);
     }
 };
 
@@ -217,6 +220,51 @@ TEST_F(MutabilityCodeGenTests, VariableShadowing) {
     EXPECT_TRUE(codegen.isCurrentSymbolMutable("x"));
 }
 
+// Scoped symbol table shared by CodeGen and the type checker
+class ScopedSymbolTableTests : public MutabilityTest {};
+
+TEST_F(ScopedSymbolTableTests, ExitRestoresShadowedBindings) {
+    ScopedSymbolTable<int> table;
+    table.declare("x", 1);
+    table.enterScope();
+    table.declare("x", 2);
+    table.declare("x", 3);  // same-scope redeclaration replaces in place
+    table.declare(std::string("y"), 4);  // names may be temporaries
+    EXPECT_EQ(*table.lookup("x"), 3);
+    EXPECT_NE(table.lookupCurrent("y"), nullptr);
+
+    std::vector<int> discarded;
+    table.exitScope([&](const int& v) { discarded.push_back(v); });
+    EXPECT_EQ(discarded, (std::vector<int>{4, 3}));
+    EXPECT_EQ(*table.lookup("x"), 1);
+    EXPECT_EQ(table.lookup("y"), nullptr);
+    EXPECT_EQ(table.lookup("never"), nullptr);
+
+    // Exiting the global scope clears it
+    table.exitScope();
+    EXPECT_EQ(table.lookup("x"), nullptr);
+    EXPECT_EQ(table.currentDepth(), 0u);
+}
+
+TEST_F(ScopedSymbolTableTests, DeepScopesAndStablePointers) {
+    ScopedSymbolTable<int> table;
+    table.declare("outer", -1);
+    int* outer = table.lookup("outer");
+    for (int depth = 1; depth <= 200; ++depth) {
+        table.enterScope();
+        table.declare("v" + std::to_string(depth), depth);
+        table.declare("shared", depth);
+    }
+    EXPECT_EQ(table.lookup("outer"), outer);  // many later declarations did not move it
+    EXPECT_EQ(table.lookupCurrent("outer"), nullptr);
+    EXPECT_EQ(*table.lookup("v7"), 7);
+    EXPECT_EQ(*table.lookupCurrent("shared"), 200);
+    for (int depth = 200; depth > 100; --depth) table.exitScope();
+    EXPECT_EQ(*table.lookup("shared"), 100);
+    EXPECT_EQ(table.lookup("v150"), nullptr);
+    EXPECT_EQ(table.currentDepth(), 100u);
+}
+
 // Test Category 5: MutabilityIntegrationTests - end-to-end behavior
 class MutabilityIntegrationTests : public MutabilityTest {};
 
@@ -2,6 +2,10 @@
 #include "lexer.h"
 #include "parser.h"
 #include "ast.h"
+#include "function_ast.h"
+#include "ast_visitor.h"
+#include <map>
+#include <string>
 
 class SyntaxTest : public ::testing::Test {
 protected:
@@ -54,6 +58,37 @@ TEST_F(SyntaxTest, ComplexExpression) {
     EXPECT_EQ(programAST->getStatements().size(), 2);
 }
 
+// Fully parenthesized rendering of an arithmetic tree
+static std::string render(ExprAST* e) {
+    if (auto* v = dynamic_cast<VariableExprAST*>(e)) return std::string(v->getName());
+    auto* bin = dynamic_cast<BinaryExprAST*>(e);
+    if (!bin) return "?";
+    std::string op;
+    switch (bin->getOperator()) {
+        case TOK_EQ: op = "=="; break;
+        case TOK_NEQ: op = "!="; break;
+        case TOK_LTE: op = "<="; break;
+        case TOK_GTE: op = ">="; break;
+        default: op = std::string(1, bin->getOperator());
+    }
+    return "(" + render(bin->getLHS()) + " " + op + " " + render(bin->getRHS()) + ")";
+}
+
+TEST_F(SyntaxTest, BinaryOperatorPrecedenceAndAssociativity) {
+    std::string input = "r = a - b - c * d / e + f < g == h; s = p >= q != t <= u;";
+    Lexer lexer(input);
+    Parser parser(lexer);
+    auto program = parser.parseProgram();
+    ASSERT_EQ(program->getStatements().size(), 2u);
+
+    auto* r = dynamic_cast<AssignmentExprAST*>(program->getStatements()[0]);
+    auto* s = dynamic_cast<AssignmentExprAST*>(program->getStatements()[1]);
+    ASSERT_NE(r, nullptr);
+    ASSERT_NE(s, nullptr);
+    EXPECT_EQ(render(r->getValue()), "(((((a - b) - ((c * d) / e)) + f) < g) == h)");
+    EXPECT_EQ(render(s->getValue()), "(((p >= q) != t) <= u)");
+}
+
 // Parser Edge Case Tests
 class ParserEdgeCaseTest : public ::testing::Test {
 protected:
@@ -234,6 +269,45 @@ TEST_F(ParserEdgeCaseTest, MaximumNestingDepth) {
     EXPECT_EQ(programAST->getStatements().size(), 1);
 }
 
+TEST_F(ParserEdgeCaseTest, LexErrorsSurfaceInSourceOrder) {
+    // The parser lexes ahead in batches; a lexer error further on must not pre-empt an
+    // earlier syntax error, and must still be reported once parsing reaches it
+    std::string badSyntaxFirst = "x = ; y = 1.2.3;";
+    Lexer lexer1(badSyntaxFirst);
+    Parser parser1(lexer1);
+    try {
+        parser1.parseProgram();
+        FAIL() << "expected a parse error";
+    } catch (const ParseError& e) {
+        EXPECT_STREQ(e.what(), "Unknown token when expecting an expression");
+    }
+
+    std::string badNumberLater = "x = 1; y = 2; z = 1.2.3;";
+    Lexer lexer2(badNumberLater);
+    Parser parser2(lexer2);
+    try {
+        parser2.parseProgram();
+        FAIL() << "expected a lexer error";
+    } catch (const ParseError& e) {
+        EXPECT_NE(std::string(e.what()).find("multiple decimal points"), std::string::npos);
+    }
+}
+
+TEST_F(ParserEdgeCaseTest, ProgramLongerThanLookaheadWindow) {
+    std::string input;
+    for (int i = 0; i < 300; ++i) input += "v" + std::to_string(i) + " = (v + " + std::to_string(i) + ") * 2;\n";
+    Lexer lexer(input);
+    Parser parser(lexer);
+    auto program = parser.parseProgram();
+    ASSERT_EQ(program->getStatements().size(), 300u);
+    auto* last = dynamic_cast<AssignmentExprAST*>(program->getStatements()[299]);
+    ASSERT_NE(last, nullptr);
+    EXPECT_EQ(last->getVarName(), "v299");
+    SourceLocation where = getSourceManager().getPresumedLoc(last->getNameLocation());
+    EXPECT_EQ(where.line, 300);
+    EXPECT_EQ(where.column, 1);
+}
+
 // Unary Minus Tests
 class UnaryMinusTest : public ::testing::Test {
 protected:
@@ -254,7 +328,7 @@ TEST_F(UnaryMinusTest, BasicUnaryMinus) {
     EXPECT_EQ(programAST->getStatements().size(), 1);
     
     // Check that the statement is a PrintStmtAST
-    auto* printStmt = dynamic_cast<PrintStmtAST*>(programAST->getStatements()[0].get());
+    auto* printStmt = dynamic_cast<PrintStmtAST*>(programAST->getStatements()[0]);
     ASSERT_NE(printStmt, nullptr);
     
     // Check that the expression is a UnaryExprAST
@@ -281,7 +355,7 @@ TEST_F(UnaryMinusTest, UnaryMinusAssignment) {
     EXPECT_EQ(programAST->getStatements().size(), 1);
     
     // Check that the statement is an AssignmentExprAST
-    auto* assignExpr = dynamic_cast<AssignmentExprAST*>(programAST->getStatements()[0].get());
+    auto* assignExpr = dynamic_cast<AssignmentExprAST*>(programAST->getStatements()[0]);
     ASSERT_NE(assignExpr, nullptr);
     EXPECT_EQ(assignExpr->getVarName(), "x");
     
@@ -304,7 +378,7 @@ TEST_F(UnaryMinusTest, UnaryMinusVariable) {
     EXPECT_EQ(programAST->getStatements().size(), 1);
     
     // Check that the statement is an AssignmentExprAST
-    auto* assignExpr = dynamic_cast<AssignmentExprAST*>(programAST->getStatements()[0].get());
+    auto* assignExpr = dynamic_cast<AssignmentExprAST*>(programAST->getStatements()[0]);
     ASSERT_NE(assignExpr, nullptr);
     
     // Check that the value is a UnaryExprAST with a variable operand
@@ -331,7 +405,7 @@ TEST_F(UnaryMinusTest, UnaryMinusParentheses) {
     EXPECT_EQ(programAST->getStatements().size(), 1);
     
     // Check that the statement is an AssignmentExprAST
-    auto* assignExpr = dynamic_cast<AssignmentExprAST*>(programAST->getStatements()[0].get());
+    auto* assignExpr = dynamic_cast<AssignmentExprAST*>(programAST->getStatements()[0]);
     ASSERT_NE(assignExpr, nullptr);
     
     // Check that the value is a UnaryExprAST
@@ -358,7 +432,7 @@ TEST_F(UnaryMinusTest, DoubleUnaryMinus) {
     EXPECT_EQ(programAST->getStatements().size(), 1);
     
     // Check that the statement is an AssignmentExprAST
-    auto* assignExpr = dynamic_cast<AssignmentExprAST*>(programAST->getStatements()[0].get());
+    auto* assignExpr = dynamic_cast<AssignmentExprAST*>(programAST->getStatements()[0]);
     ASSERT_NE(assignExpr, nullptr);
     
     // Check that the value is a UnaryExprAST (outer minus)
@@ -390,7 +464,7 @@ TEST_F(UnaryMinusTest, UnaryMinusInBinaryExpression) {
     EXPECT_EQ(programAST->getStatements().size(), 1);
     
     // Check that the statement is an AssignmentExprAST
-    auto* assignExpr = dynamic_cast<AssignmentExprAST*>(programAST->getStatements()[0].get());
+    auto* assignExpr = dynamic_cast<AssignmentExprAST*>(programAST->getStatements()[0]);
     ASSERT_NE(assignExpr, nullptr);
     
     // Check that the value is a BinaryExprAST
@@ -409,6 +483,163 @@ TEST_F(UnaryMinusTest, UnaryMinusInBinaryExpression) {
     EXPECT_DOUBLE_EQ(numberExpr->getValue(), 3.0);
 }
 
+// The whole tree lives in the program's ASTContext
+class ASTContextTest : public ::testing::Test {
+protected:
+    void SetUp() override {}
+    void TearDown() override {}
+};
+
+TEST_F(ASTContextTest, NamesAreInternedIntoTheArena) {
+    std::string input = "total = total + 1; print \"a\\tb\"; f = fn(total) => total;";
+    Lexer lexer(input);
+    Parser parser(lexer);
+    auto program = parser.parseProgram();
+    ASSERT_EQ(program->getStatements().size(), 3u);
+
+    auto* first = dynamic_cast<AssignmentExprAST*>(program->getStatements()[0]);
+    auto* read = dynamic_cast<VariableExprAST*>(dynamic_cast<BinaryExprAST*>(first->getValue())->getLHS());
+    auto* fn = dynamic_cast<FunctionLiteralAST*>(
+        dynamic_cast<AssignmentExprAST*>(program->getStatements()[2])->getValue());
+    ASSERT_NE(read, nullptr);
+    ASSERT_NE(fn, nullptr);
+    // Equal names share one arena copy, not the source text
+    EXPECT_EQ(first->getVarName().data(), read->getName().data());
+    EXPECT_EQ(fn->getParams()[0].name.data(), first->getVarName().data());
+    EXPECT_FALSE(first->getVarName().data() >= input.data() &&
+                 first->getVarName().data() < input.data() + input.size());
+
+    // Decoded string literals outlive the lexer that produced them
+    auto* print = dynamic_cast<PrintStmtAST*>(program->getStatements()[1]);
+    auto* str = dynamic_cast<StringLiteralAST*>(print->getFormatExpr());
+    ASSERT_NE(str, nullptr);
+    EXPECT_EQ(str->getValue(), "a\tb");
+}
+
+TEST_F(ASTContextTest, LargeProgramUsesFewSlabs) {
+    std::string input;
+    for (int i = 0; i < 2000; ++i) {
+        input += "v" + std::to_string(i % 50) + " = (a + " + std::to_string(i) + ") * b;\n";
+    }
+    Lexer lexer(input);
+    Parser parser(lexer);
+    auto program = parser.parseProgram();
+    ASSERT_EQ(program->getStatements().size(), 2000u);
+    const ASTContext& ctx = program->getContext();
+    EXPECT_GT(ctx.getBytesAllocated(), 2000u * sizeof(BinaryExprAST));
+    EXPECT_LT(ctx.getSlabCount(), 16u);
+}
+
+TEST_F(ASTContextTest, SpansAndOversizedAllocations) {
+    ASTContext ctx;
+    std::vector<ExprAST*> args;
+    for (int i = 0; i < 3; ++i) args.push_back(ctx.create<NumberExprAST>(i));
+    auto* call = ctx.create<FunctionCallAST>(ctx.create<VariableExprAST>(ctx.intern("f")),
+                                             ctx.copySpan(args), SourceLoc{});
+    ASSERT_EQ(call->getArgs().size(), 3u);
+    EXPECT_DOUBLE_EQ(dynamic_cast<NumberExprAST*>(call->getArgs()[2])->getValue(), 2.0);
+    EXPECT_TRUE(ctx.copySpan(std::vector<ExprAST*>{}).empty());
+
+    // Bigger than any slab: gets a dedicated one, and later small allocations still work
+    void* big = ctx.allocate(1 << 22, 16);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(big) % 16, 0u);
+    EXPECT_EQ(ctx.intern("f").data(), dynamic_cast<VariableExprAST*>(call->getCallee())->getName().data());
+    EXPECT_EQ(ctx.intern(""), "");
+}
+
+TEST_F(ASTContextTest, AbsorbKeepsNodesAlive) {
+    auto other = std::make_unique<ASTContext>();
+    auto* num = other->create<NumberExprAST>(7.0);
+    std::string_view name = other->intern("kept");
+    ASTContext ctx;
+    ctx.absorb(*other);
+    other.reset();
+    EXPECT_DOUBLE_EQ(num->getValue(), 7.0);
+    EXPECT_EQ(name, "kept");
+    EXPECT_GE(ctx.getSlabCount(), 1u);
+}
+
+class ASTVisitorTest : public ::testing::Test {
+protected:
+    void SetUp() override {}
+    void TearDown() override {}
+};
+
+namespace {
+// Counts every node kind reached; optionally stops at fn literals
+struct KindCounter : RecursiveASTVisitor<KindCounter> {
+    std::map<NodeKind, int> counts;
+    bool enterFunctions = true;
+
+    void traverse(ASTNode* node) {
+        if (node) ++counts[node->getKind()];
+        RecursiveASTVisitor::traverse(node);
+    }
+    bool visitFunctionLiteral(FunctionLiteralAST*) { return enterFunctions; }
+};
+
+// Expressions report "expr", statements fall through to visitNode
+struct Describer : ASTVisitor<Describer, std::string> {
+    std::string visitNumber(NumberExprAST*) { return "number"; }
+    std::string visitExpr(ExprAST*) { return "expr"; }
+    std::string visitNode(ASTNode*) { return "node"; }
+};
+} // namespace
+
+TEST_F(ASTVisitorTest, RecursiveVisitorReachesEveryNode) {
+    std::string input =
+        "mut i = 0; while (i < 3) { i = i + 1; } if (-i) { print \"%d\", i; } else { } "
+        "f = fn(a) { g = fn() => a; return g(); }; print f(1);";
+    Lexer lexer(input);
+    Parser parser(lexer);
+    auto program = parser.parseProgram();
+
+    KindCounter all;
+    all.traverse(program.get());
+    EXPECT_EQ(all.counts[NodeKind::Program], 1);
+    EXPECT_EQ(all.counts[NodeKind::While], 1);
+    EXPECT_EQ(all.counts[NodeKind::If], 1);
+    EXPECT_EQ(all.counts[NodeKind::Unary], 1);
+    EXPECT_EQ(all.counts[NodeKind::StringLiteral], 1);
+    EXPECT_EQ(all.counts[NodeKind::FunctionLiteral], 2);
+    EXPECT_EQ(all.counts[NodeKind::FunctionCall], 2);
+    EXPECT_EQ(all.counts[NodeKind::Return], 1);
+    EXPECT_EQ(all.counts[NodeKind::Assignment], 4);
+
+    // Pruning at fn literals skips the bodies (and the literal nested inside)
+    KindCounter top;
+    top.enterFunctions = false;
+    top.traverse(program.get());
+    EXPECT_EQ(top.counts[NodeKind::FunctionLiteral], 1);
+    EXPECT_EQ(top.counts[NodeKind::Return], 0);
+    EXPECT_EQ(top.counts[NodeKind::Assignment], 3);
+}
+
+TEST_F(ASTVisitorTest, DispatchFallsBackByCategory) {
+    ASTContext ctx;
+    auto* num = ctx.create<NumberExprAST>(1.0);
+    auto* var = ctx.create<VariableExprAST>(ctx.intern("x"));
+    auto* block = ctx.create<BlockAST>(ASTSpan<ASTNode*>{});
+    Describer d;
+    EXPECT_EQ(d.visit(num), "number");
+    EXPECT_EQ(d.visit(var), "expr");
+    EXPECT_EQ(d.visit(block), "node");
+}
+
+TEST_F(ASTVisitorTest, KindCastsCheckTheTag) {
+    ASTContext ctx;
+    ASTNode* num = ctx.create<NumberExprAST>(2.0);
+    ASTNode* block = ctx.create<BlockAST>(ASTSpan<ASTNode*>{});
+    EXPECT_TRUE(isa<NumberExprAST>(num));
+    EXPECT_TRUE(isa<ExprAST>(num));
+    EXPECT_FALSE(isa<ExprAST>(block));
+    EXPECT_EQ(dyn_cast<VariableExprAST>(num), nullptr);
+    EXPECT_EQ(dyn_cast<NumberExprAST>(static_cast<ASTNode*>(nullptr)), nullptr);
+    EXPECT_FALSE(isa<BlockAST>(static_cast<ASTNode*>(nullptr)));
+    EXPECT_DOUBLE_EQ(cast<NumberExprAST>(num)->getValue(), 2.0);
+    EXPECT_EQ(cast<BlockAST>(block)->getKind(), NodeKind::Block);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
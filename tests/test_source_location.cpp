@@ -2,9 +2,12 @@
 #include <gmock/gmock.h>
 #include "lexer.h"
 #include "parser.h"
+#include "source_manager.h"
 
 using ::testing::HasSubstr;
 
+static SourceLocation presumed(SourceLoc loc) { return getSourceManager().getPresumedLoc(loc); }
+
 // 1.1 SourceLocation Basic Tests
 TEST(SourceLocationTest, DefaultConstruction) {
     SourceLocation loc;
@@ -20,36 +23,66 @@ TEST(SourceLocationTest, CustomConstruction) {
     EXPECT_EQ(loc.column, 10);
 }
 
-// 1.2 SourceRange Tests
-TEST(SourceRangeTest, SingleCharacterToken) {
-    SourceLocation start{"test.k", 1, 5};
-    SourceLocation end{"test.k", 1, 6};
-    SourceRange range{start, end};
-    EXPECT_EQ(range.start.column, 5);
-    EXPECT_EQ(range.end.column, 6);
-    EXPECT_EQ(range.end.column - range.start.column, 1);
+// 1.2 Packed SourceLoc Tests
+TEST(SourceLocTest, DefaultIsInvalid) {
+    SourceLoc loc;
+    EXPECT_FALSE(loc.isValid());
+    EXPECT_EQ(presumed(loc).file, "");
+    EXPECT_EQ(sizeof(SourceLoc), 4u);
+}
+
+TEST(SourceLocTest, PackedOffsetsExpandToLineAndColumn) {
+    SourceManager sm;
+    const auto& buf = sm.addBuffer("a.k", "ab\ncd\r\nef\rg");
+    EXPECT_EQ(sm.getPresumedLoc(buf.getLoc(1)).column, 2);
+    SourceLocation c = sm.getPresumedLoc(buf.getLoc(3));
+    EXPECT_EQ(c.file, "a.k");
+    EXPECT_EQ(c.line, 2);
+    EXPECT_EQ(c.column, 1);
+    EXPECT_EQ(sm.getPresumedLoc(buf.getLoc(7)).line, 3);   // CRLF is one line break
+    EXPECT_EQ(sm.getPresumedLoc(buf.getLoc(10)).line, 4);  // lone CR too
+    EXPECT_EQ(sm.getPresumedLoc(buf.getLoc(11)).column, 2);  // end of file
+}
+
+TEST(SourceLocTest, FileIsRecoveredFromLocation) {
+    SourceManager sm;
+    const auto& a = sm.addBuffer("a.k", "x = 1;");
+    const auto& b = sm.addBuffer("b.k", "y = 2;");
+    EXPECT_NE(a.id, b.id);
+    EXPECT_EQ(sm.getBufferFor(a.getLoc(6)), &a);
+    EXPECT_EQ(sm.getBufferFor(b.getLoc(0)), &b);
+    EXPECT_EQ(sm.getPresumedLoc(b.getLoc(4)).file, "b.k");
+    EXPECT_EQ(sm.getBuffer("a.k"), &a);
 }
 
-TEST(SourceRangeTest, MultiCharacterToken) {
-    SourceLocation start{"test.k", 1, 10};
-    SourceLocation end{"test.k", 1, 15};  // 5-character token
-    SourceRange range{start, end};
-    EXPECT_EQ(range.end.column - range.start.column, 5);
+TEST(SourceLocTest, LineTextComesFromLineIndex) {
+    SourceManager sm;
+    const auto& buf = sm.addBuffer("a.k", "one\r\ntwo\n\nfour");
+    EXPECT_EQ(sm.getLineText(buf, 1), "one");
+    EXPECT_EQ(sm.getLineText(buf, 2), "two");
+    EXPECT_EQ(sm.getLineText(buf, 3), "");
+    EXPECT_EQ(sm.getLineText(buf, 4), "four");
+    EXPECT_EQ(sm.getLineText(buf, 0), "");
+    EXPECT_EQ(sm.getLineText(buf, 5), "");
+    EXPECT_EQ(sm.getPresumedLoc(buf.getLoc(11)).line, 4);
 }
 
 // 1.3 Token Range Tests
 TEST(TokenTest, WithSourceRange) {
-    SourceRange range{{"test.k", 1, 5}, {"test.k", 1, 7}};
+    SourceManager sm;
+    const auto& buf = sm.addBuffer("test.k", "    42");
+    SourceRange range{buf.getLoc(4), buf.getLoc(6)};
     Token token(TOK_NUMBER, "42", 42.0, range);
-    EXPECT_EQ(token.range.start.line, 1);
-    EXPECT_EQ(token.range.start.column, 5);
-    EXPECT_EQ(token.range.end.column, 7);
+    EXPECT_EQ(sm.getPresumedLoc(token.range.start).line, 1);
+    EXPECT_EQ(sm.getPresumedLoc(token.range.start).column, 5);
+    EXPECT_EQ(sm.getPresumedLoc(token.range.end).column, 7);
 }
 
 TEST(TokenTest, DefaultRange) {
     Token token(TOK_PLUS, "+");
-    EXPECT_EQ(token.range.start.line, 1);
-    EXPECT_EQ(token.range.start.column, 1);
+    EXPECT_FALSE(token.range.start.isValid());
+    EXPECT_EQ(presumed(token.range.start).line, 1);
+    EXPECT_EQ(presumed(token.range.start).column, 1);
 }
 
 // 1.4 Lexer Location Tracking Tests
@@ -57,45 +90,45 @@ TEST(LexerLocationTest, BasicLocationTracking) {
     Lexer lexer("42", "test.k");
     Token token = lexer.getNextToken();
     EXPECT_EQ(token.type, TOK_NUMBER);
-    EXPECT_EQ(token.range.start.file, "test.k");
-    EXPECT_EQ(token.range.start.line, 1);
-    EXPECT_EQ(token.range.start.column, 1);
-    EXPECT_EQ(token.range.end.column, 3);
+    EXPECT_EQ(presumed(token.range.start).file, "test.k");
+    EXPECT_EQ(presumed(token.range.start).line, 1);
+    EXPECT_EQ(presumed(token.range.start).column, 1);
+    EXPECT_EQ(presumed(token.range.end).column, 3);
 }
 
 TEST(LexerLocationTest, MultipleTokensOnSameLine) {
     Lexer lexer("x + 42", "test.k");
     Token token1 = lexer.getNextToken();
     EXPECT_EQ(token1.type, TOK_IDENTIFIER);
-    EXPECT_EQ(token1.range.start.column, 1);
-    EXPECT_EQ(token1.range.end.column, 2);
+    EXPECT_EQ(presumed(token1.range.start).column, 1);
+    EXPECT_EQ(presumed(token1.range.end).column, 2);
     Token token2 = lexer.getNextToken();
     EXPECT_EQ(token2.type, TOK_PLUS);
-    EXPECT_EQ(token2.range.start.column, 3);
-    EXPECT_EQ(token2.range.end.column, 4);
+    EXPECT_EQ(presumed(token2.range.start).column, 3);
+    EXPECT_EQ(presumed(token2.range.end).column, 4);
     Token token3 = lexer.getNextToken();
     EXPECT_EQ(token3.type, TOK_NUMBER);
-    EXPECT_EQ(token3.range.start.column, 5);
-    EXPECT_EQ(token3.range.end.column, 7);
+    EXPECT_EQ(presumed(token3.range.start).column, 5);
+    EXPECT_EQ(presumed(token3.range.end).column, 7);
 }
 
 TEST(LexerLocationTest, NewlineHandling) {
     Lexer lexer("x\ny", "test.k");
     Token token1 = lexer.getNextToken();
-    EXPECT_EQ(token1.range.start.line, 1);
-    EXPECT_EQ(token1.range.start.column, 1);
+    EXPECT_EQ(presumed(token1.range.start).line, 1);
+    EXPECT_EQ(presumed(token1.range.start).column, 1);
     Token token2 = lexer.getNextToken();
-    EXPECT_EQ(token2.range.start.line, 2);
-    EXPECT_EQ(token2.range.start.column, 1);
+    EXPECT_EQ(presumed(token2.range.start).line, 2);
+    EXPECT_EQ(presumed(token2.range.start).column, 1);
 }
 
 TEST(LexerLocationTest, TabHandling) {
     Lexer lexer("x\ty", "test.k");
     Token token1 = lexer.getNextToken();
-    EXPECT_EQ(token1.range.start.column, 1);
+    EXPECT_EQ(presumed(token1.range.start).column, 1);
     Token token2 = lexer.getNextToken();
     // tab counts as 1 column; 'y' starts after 1 tab and one char => column 3
-    EXPECT_EQ(token2.range.start.column, 3);
+    EXPECT_EQ(presumed(token2.range.start).column, 3);
 }
 
 TEST(LexerLocationTest, MultiCharacterOperators) {
@@ -103,16 +136,16 @@ TEST(LexerLocationTest, MultiCharacterOperators) {
     lexer.getNextToken(); // 'x'
     Token token = lexer.getNextToken(); // '>='
     EXPECT_EQ(token.type, TOK_GTE);
-    EXPECT_EQ(token.range.start.column, 3);
-    EXPECT_EQ(token.range.end.column, 5);
+    EXPECT_EQ(presumed(token.range.start).column, 3);
+    EXPECT_EQ(presumed(token.range.end).column, 5);
 }
 
 TEST(LexerLocationTest, StringLiteralWithEscapes) {
     Lexer lexer("\"hello\\nworld\"", "test.k");
     Token token = lexer.getNextToken();
     EXPECT_EQ(token.type, TOK_STRING);
-    EXPECT_EQ(token.range.start.column, 1);
-    EXPECT_EQ(token.range.end.column, 15);
+    EXPECT_EQ(presumed(token.range.start).column, 1);
+    EXPECT_EQ(presumed(token.range.end).column, 15);
 }
 
 TEST(LexerLocationTest, EOFToken) {
@@ -120,8 +153,8 @@ TEST(LexerLocationTest, EOFToken) {
     lexer.getNextToken();
     Token eofToken = lexer.getNextToken();
     EXPECT_EQ(eofToken.type, TOK_EOF);
-    EXPECT_EQ(eofToken.range.start.column, 2);
-    EXPECT_EQ(eofToken.range.start.column, eofToken.range.end.column);
+    EXPECT_EQ(presumed(eofToken.range.start).column, 2);
+    EXPECT_EQ(presumed(eofToken.range.start).column, presumed(eofToken.range.end).column);
 }
 
 // 1.5 ParseError Exception Tests